@@ -44,6 +44,7 @@
 #include "apu.h"
 #include "soundux.h"
 #include "cpuexec.h"
+#include "apumem.h"
 
 /* For note-triggered SPC dump support */
 //#include "snapshot.h"
@@ -417,8 +418,13 @@ void S9xDeinitAPU ()
 
 EXTERN_C uint8 APUROM [64];
 
+// Whether the SPC700 is held in the IPL ROM by S9xAPUFastUpload
+static bool8 IPLHeld = FALSE;
+
 void S9xResetAPU ()
 {
+    IPLHeld = FALSE;
+
 //    Settings.APUEnabled = Settings.NextAPUEnabled;
 
     memset (IAPU.RAM, Settings.APURAMInitialValue, 0x10000);
@@ -1127,6 +1133,104 @@ void S9xSetAPUTimer (uint16 Address, uint8 byte)
     }
 }
 
+/* The points of the IPL ROM where it waits for the CPU */
+#define IPL_WAIT_START	0xffcf	// For $cc on port 0
+#define IPL_WAIT_ZERO	0xffd6	// For 0 on port 0, before the first byte
+#define IPL_WAIT_BYTE	0xffda	// For the index of the next byte on port 0
+
+/* Takes the new block address and command from the ports, as the IPL ROM
+ * does at $ffef: a zero command jumps to the address. */
+static void IPLCommand ()
+{
+    IAPU.DirectPage [0] = IAPU.RAM [0xf6];
+    IAPU.DirectPage [1] = IAPU.RAM [0xf7];
+    APU.OutPorts [0] = IAPU.RAM [0xf4];
+    IAPU.YA.B.A = IAPU.YA.B.Y = IAPU.X = IAPU.RAM [0xf5];
+    IAPU._Zero = IAPU.X;
+
+    if (IAPU.X)
+    {
+	IAPU.PC = IAPU.RAM + IPL_WAIT_ZERO;
+	return;
+    }
+
+    IAPU.PC = IAPU.RAM + (IAPU.DirectPage [0] | (IAPU.DirectPage [1] << 8));
+    IPLHeld = FALSE;
+    CPU.APU_APUExecuting = Settings.APUEnabled;
+    CPU.APU_Cycles = CPU.Cycles;
+}
+
+/* High level emulation of the IPL ROM upload protocol, for
+ * Settings.APUFastUpload. Called after the APU has caught up with a CPU
+ * read of its ports.
+ * Once the SPC700 is found waiting in the IPL ROM, it is stopped, and the
+ * commands and bytes the CPU has posted are handled here, as soon as the
+ * CPU looks for the answer. So every byte costs the CPU one pass of its
+ * upload loop instead of a wait for the SPC700. The SPC700 registers, its
+ * direct page and port 0 are kept as the IPL ROM would leave them at the
+ * same wait, so it can take over again at any time, e.g. after a snapshot
+ * is loaded. It is started at the uploaded code when the CPU jumps there. */
+void S9xAPUFastUpload ()
+{
+    if (!IPLHeld)
+    {
+	uint32 pc = IAPU.PC - IAPU.RAM;
+
+	if (!CPU.APU_APUExecuting || !APU.ShowROM ||
+	    (pc != IPL_WAIT_START && pc != IPL_WAIT_ZERO && pc != IPL_WAIT_BYTE))
+	    return;
+	IPLHeld = TRUE;
+	CPU.APU_APUExecuting = FALSE;
+    }
+    else
+    if (CPU.APU_APUExecuting)
+    {
+	// Restarted from outside; it goes on from the wait it was left at
+	IPLHeld = FALSE;
+	return;
+    }
+
+    while (IPLHeld)
+    {
+	uint8 port0 = IAPU.RAM [0xf4];
+
+	switch (IAPU.PC - IAPU.RAM)
+	{
+	case IPL_WAIT_START:
+	    if (port0 != 0xcc)
+		return;
+	    IPLCommand ();
+	    break;
+
+	case IPL_WAIT_ZERO:
+	    if (port0 != 0)
+		return;
+	    IAPU.YA.B.Y = 0;
+	    IAPU.PC = IAPU.RAM + IPL_WAIT_BYTE;
+	    break;
+
+	default:
+	    if (port0 == IAPU.YA.B.Y)
+	    {
+		uint16 address = IAPU.DirectPage [0] | (IAPU.DirectPage [1] << 8);
+
+		IAPU.YA.B.A = IAPU.RAM [0xf5];
+		APU.OutPorts [0] = IAPU.YA.B.Y;
+		S9xAPUSetByte (IAPU.YA.B.A, address + IAPU.YA.B.Y);
+		if (++IAPU.YA.B.Y == 0)
+		    IAPU.DirectPage [1]++;
+	    }
+	    else
+	    if ((uint8) (IAPU.YA.B.Y - port0) & 0x80)
+		// Port 0 moved on by more than one: a new command
+		IPLCommand ();
+	    else
+		return;
+	    break;
+	}
+    }
+}
+
 uint8 S9xGetAPUDSP ()
 {
     uint8 reg = IAPU.RAM [0xf2] & 0x7f;
@@ -138,6 +138,7 @@ void S9xSetAPUControl (uint8 byte);
 void S9xSetAPUDSP (uint8 byte);
 uint8 S9xGetAPUDSP ();
 void S9xSetAPUTimer (uint16 Address, uint8 byte);
+void S9xAPUFastUpload ();
 void S9xOpenCloseSoundTracingFile (bool8);
 void S9xPrintAPUState ();
 extern int32 S9xAPUCycles [256];	// Scaled cycle lengths
@@ -44,6 +44,9 @@
 #include "snes9x.h"
 #include "cheats.h"
 #include "memmap.h"
+#if !CONF_BUILD_ASM_CPU
+#include "cpublocks.h"
+#endif
 
 extern SCheatData Cheat;
 
@@ -118,7 +121,15 @@ void S9xRemoveCheat (uint32 which1)
 	uint8 *ptr = Memory.Map [block];
 	    
 	if (ptr >= (uint8 *) CMemory::MAP_LAST)
-	    *(ptr + (address & 0xffff)) = Cheat.c [which1].saved_byte;
+	{
+	    ptr += address & 0xffff;
+#if !CONF_BUILD_ASM_CPU
+	    // ROM code there may have been decoded or translated
+	    if (!Memory.BlockIsRAM [block] && *ptr != Cheat.c [which1].saved_byte)
+		S9xCPUBlocksFlush ();
+#endif
+	    *ptr = Cheat.c [which1].saved_byte;
+	}
 	else
 	    S9xSetByte (address, Cheat.c [which1].saved_byte);
     }
@@ -135,7 +146,15 @@ void S9xApplyCheat (uint32 which1)
     uint8 *ptr = Memory.Map [block];
     
     if (ptr >= (uint8 *) CMemory::MAP_LAST)
-	*(ptr + (address & 0xffff)) = Cheat.c [which1].byte;
+    {
+	ptr += address & 0xffff;
+#if !CONF_BUILD_ASM_CPU
+	// ROM code there may have been decoded or translated
+	if (!Memory.BlockIsRAM [block] && *ptr != Cheat.c [which1].byte)
+	    S9xCPUBlocksFlush ();
+#endif
+	*ptr = Cheat.c [which1].byte;
+    }
     else
 	S9xSetByte (address, Cheat.c [which1].byte);
     Cheat.c [which1].saved = TRUE;
@@ -110,7 +110,7 @@ void ComputeClipWindows ()
 	    {
 		if (c == 0) // ... on the main screen
 		{
-		    if ((Memory.FillRAM [0x2130] & 0xc0) == 0xc0)
+		    if ((GFX.FillRAM [0x2130] & 0xc0) == 0xc0)
 		    {
 			// The whole of the main screen is switched off,
 			// completely clip everything.
@@ -123,13 +123,13 @@ void ComputeClipWindows ()
 			continue;
 		    }
 		    else
-		    if ((Memory.FillRAM [0x2130] & 0xc0) == 0x00)
+		    if ((GFX.FillRAM [0x2130] & 0xc0) == 0x00)
 			continue;
 		}
 		else
 		{
 		    // .. colour window on the sub-screen.
-		    if ((Memory.FillRAM [0x2130] & 0x30) == 0x30)
+		    if ((GFX.FillRAM [0x2130] & 0x30) == 0x30)
 		    {
 			// The sub-screen is switched off, completely
 			// clip everything.
@@ -142,26 +142,26 @@ void ComputeClipWindows ()
 			return;
 		    }
 		    else
-		    if ((Memory.FillRAM [0x2130] & 0x30) == 0x00)
+		    if ((GFX.FillRAM [0x2130] & 0x30) == 0x00)
 			continue;
 		}
 	    }
 	    if (!Settings.DisableGraphicWindows)
 	    {
 		if (w == 5 || pClip->Count [5] ||
-		    (Memory.FillRAM [0x212c + c] & 
-		     Memory.FillRAM [0x212e + c] & (1 << w)))
+		    (GFX.FillRAM [0x212c + c] & 
+		     GFX.FillRAM [0x212e + c] & (1 << w)))
 		{
 		    struct Band Win1[3];
 		    struct Band Win2[3];
 		    uint32 Window1Enabled = 0;
 		    uint32 Window2Enabled = 0;
 		    bool8_32 invert = (w == 5 && 
-				    ((c == 1 && (Memory.FillRAM [0x2130] & 0x30) == 0x10) ||
-				     (c == 0 && (Memory.FillRAM [0x2130] & 0xc0) == 0x40)));
+				    ((c == 1 && (GFX.FillRAM [0x2130] & 0x30) == 0x10) ||
+				     (c == 0 && (GFX.FillRAM [0x2130] & 0xc0) == 0x40)));
 
 		    if (w == 5 ||
-			(Memory.FillRAM [0x212c + c] & Memory.FillRAM [0x212e + c] & (1 << w)))
+			(GFX.FillRAM [0x212c + c] & GFX.FillRAM [0x212e + c] & (1 << w)))
 		    {
 			if (PPU.ClipWindow1Enable [w])
 			{
@@ -43,6 +43,9 @@
 #include "ppu.h"
 #include "dsp1.h"
 #include "cpuexec.h"
+#if !CONF_BUILD_ASM_CPU
+#include "cpublocks.h"
+#endif
 #include "debug.h"
 #include "apu.h"
 #include "dma.h"
@@ -63,8 +66,11 @@ extern struct FxInit_s SuperFX;
 
 static void S9xResetSuperFX ()
 {
+    S9xSuperFXThreadStop ();
     SuperFX.vFlags = 0; //FX_FLAG_ROM_BUFFER;// | FX_FLAG_ADDRESS_CHECKING;
     FxReset (&SuperFX);
+    if (Settings.ThreadedSuperFX)
+	S9xSuperFXThreadStart ();
 }
 #endif
 
@@ -91,14 +97,14 @@ void S9xResetCPU ()
     CPU.IRQActive = FALSE;
     CPU.WaitingForInterrupt = FALSE;
     CPU.InDMA = FALSE;
-    CPU.WhichEvent = HBLANK_START_EVENT;
     CPU.PC = NULL;
     CPU.PCBase = NULL;
     CPU.PCAtOpcodeStart = NULL;
     CPU.WaitAddress = NULL;
     CPU.WaitCounter = 0;
+    CPU.APUWaitAddress = NULL;
     CPU.Cycles = 0;
-    CPU.NextEvent = Settings.HBlankStart;
+    S9xResetEvents ();
     CPU.V_Counter = 0;
     CPU.MemSpeed = SLOW_ONE_CYCLE;
     CPU.MemSpeedx2 = SLOW_ONE_CYCLE * 2;
@@ -118,6 +124,8 @@ void S9xResetCPU ()
 #endif
     ICPU.S9xOpcodes = S9xOpcodesM1X1;
     S9xUnpackStatus();
+    ICPU.InBlock = FALSE;
+    S9xCPUBlocksFlush ();
 #endif
 
     ICPU.CPUExecuting = TRUE;
@@ -129,6 +137,8 @@ void S9xReset (void)
 #ifdef SUPER_FX
     if (Settings.SuperFX)
         S9xResetSuperFX ();
+    else
+	S9xSuperFXThreadStop ();
 #endif
 
     ZeroMemory (Memory.FillRAM, 0x8000);
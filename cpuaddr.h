@@ -57,6 +57,10 @@ STATIC INLINE long FASTCALL Immediate16 ()
 	return OpAddress;
 }
 
+template <class T> STATIC INLINE long FASTCALL Immediate ();
+template <> INLINE long FASTCALL Immediate<uint8> () { return Immediate8 (); }
+template <> INLINE long FASTCALL Immediate<uint16> () { return Immediate16 (); }
+
 STATIC INLINE long FASTCALL Relative ()
 {
     int8 Int8 = *CPU.PC++;
@@ -68,11 +72,7 @@ STATIC INLINE long FASTCALL Relative ()
 
 STATIC INLINE long FASTCALL RelativeLong ()
 {
-#ifdef FAST_LSB_WORD_ACCESS
-    long OpAddress = *(uint16 *) CPU.PC;
-#else
-    long OpAddress = *CPU.PC + (*(CPU.PC + 1) << 8);
-#endif
+    long OpAddress = READ_WORD (CPU.PC);
 #ifdef VAR_CYCLES
     CPU.Cycles += CPU.MemSpeedx2 + ONE_CYCLE;
 #endif
@@ -84,11 +84,7 @@ STATIC INLINE long FASTCALL RelativeLong ()
 
 STATIC INLINE long FASTCALL AbsoluteIndexedIndirect ()
 {
-#ifdef FAST_LSB_WORD_ACCESS
-    long OpAddress = (Registers.X.W + *(uint16 *) CPU.PC) & 0xffff;
-#else
-    long OpAddress = (Registers.X.W + *CPU.PC + (*(CPU.PC + 1) << 8)) & 0xffff;
-#endif
+    long OpAddress = (Registers.X.W + READ_WORD (CPU.PC)) & 0xffff;
 #ifdef VAR_CYCLES
     CPU.Cycles += CPU.MemSpeedx2;
 #endif
@@ -98,26 +94,18 @@ STATIC INLINE long FASTCALL AbsoluteIndexedIndirect ()
 
 STATIC INLINE long FASTCALL AbsoluteIndirectLong ()
 {
-#ifdef FAST_LSB_WORD_ACCESS
-    long OpAddress = *(uint16 *) CPU.PC;
-#else
-    long OpAddress = *CPU.PC + (*(CPU.PC + 1) << 8);
-#endif
+    long OpAddress = READ_WORD (CPU.PC);
 
 #ifdef VAR_CYCLES
     CPU.Cycles += CPU.MemSpeedx2;
 #endif
     CPU.PC += 2;
-    return S9xGetWord (OpAddress) | (S9xGetByte (OpAddress + 2) << 16);
+    return S9xGetLong (OpAddress);
 }
 
 STATIC INLINE long FASTCALL AbsoluteIndirect ()
 {
-#ifdef FAST_LSB_WORD_ACCESS
-    long OpAddress = *(uint16 *) CPU.PC;
-#else
-    long OpAddress = *CPU.PC + (*(CPU.PC + 1) << 8);
-#endif
+    long OpAddress = READ_WORD (CPU.PC);
 
 #ifdef VAR_CYCLES
     CPU.Cycles += CPU.MemSpeedx2;
@@ -128,11 +116,7 @@ STATIC INLINE long FASTCALL AbsoluteIndirect ()
 
 STATIC INLINE long FASTCALL Absolute ()
 {
-#ifdef FAST_LSB_WORD_ACCESS
-    long OpAddress = *(uint16 *) CPU.PC + ICPU.ShiftedDB;
-#else
-    long OpAddress = *CPU.PC + (*(CPU.PC + 1) << 8) + ICPU.ShiftedDB;
-#endif
+    long OpAddress = READ_WORD (CPU.PC) + ICPU.ShiftedDB;
     CPU.PC += 2;
 #ifdef VAR_CYCLES
     CPU.Cycles += CPU.MemSpeedx2;
@@ -142,11 +126,7 @@ STATIC INLINE long FASTCALL Absolute ()
 
 STATIC INLINE long FASTCALL AbsoluteLong ()
 {
-#ifdef FAST_LSB_WORD_ACCESS
-    long OpAddress = (*(uint32 *) CPU.PC) & 0xffffff;
-#else
-    long OpAddress = *CPU.PC + (*(CPU.PC + 1) << 8) + (*(CPU.PC + 2) << 16);
-#endif
+    long OpAddress = READ_3WORD (CPU.PC);
     CPU.PC += 3;
 #ifdef VAR_CYCLES
     CPU.Cycles += CPU.MemSpeedx2 + CPU.MemSpeed;
@@ -186,8 +166,7 @@ STATIC INLINE long FASTCALL DirectIndirectIndexedLong ()
     CPU.Cycles += CPU.MemSpeed;
 #endif
 
-    OpAddress = S9xGetWord (OpAddress) + (S9xGetByte (OpAddress + 2) << 16) +
-		Registers.Y.W;
+    OpAddress = S9xGetLong (OpAddress) + Registers.Y.W;
 //    if (Registers.DL != 0) CPU.Cycles += ONE_CYCLE;
 	return OpAddress;
 }
@@ -244,12 +223,7 @@ STATIC INLINE long FASTCALL DirectIndexedY ()
 
 STATIC INLINE long FASTCALL AbsoluteIndexedX ()
 {
-#ifdef FAST_LSB_WORD_ACCESS
-    long OpAddress = ICPU.ShiftedDB + *(uint16 *) CPU.PC + Registers.X.W;
-#else
-    long OpAddress = ICPU.ShiftedDB + *CPU.PC + (*(CPU.PC + 1) << 8) +
-		Registers.X.W;
-#endif
+    long OpAddress = ICPU.ShiftedDB + READ_WORD (CPU.PC) + Registers.X.W;
     CPU.PC += 2;
 #ifdef VAR_CYCLES
     CPU.Cycles += CPU.MemSpeedx2;
@@ -261,12 +235,7 @@ STATIC INLINE long FASTCALL AbsoluteIndexedX ()
 
 STATIC INLINE long FASTCALL AbsoluteIndexedY ()
 {
-#ifdef FAST_LSB_WORD_ACCESS
-    long OpAddress = ICPU.ShiftedDB + *(uint16 *) CPU.PC + Registers.Y.W;
-#else
-    long OpAddress = ICPU.ShiftedDB + *CPU.PC + (*(CPU.PC + 1) << 8) +
-		Registers.Y.W;
-#endif    
+    long OpAddress = ICPU.ShiftedDB + READ_WORD (CPU.PC) + Registers.Y.W;
     CPU.PC += 2;
 #ifdef VAR_CYCLES
     CPU.Cycles += CPU.MemSpeedx2;
@@ -278,11 +247,7 @@ STATIC INLINE long FASTCALL AbsoluteIndexedY ()
 
 STATIC INLINE long FASTCALL AbsoluteLongIndexedX ()
 {
-#ifdef FAST_LSB_WORD_ACCESS
-    long OpAddress = (*(uint32 *) CPU.PC + Registers.X.W) & 0xffffff;
-#else
-    long OpAddress = (*CPU.PC + (*(CPU.PC + 1) << 8) + (*(CPU.PC + 2) << 16) + Registers.X.W) & 0xffffff;
-#endif
+    long OpAddress = (READ_3WORD (CPU.PC) + Registers.X.W) & 0xffffff;
     CPU.PC += 3;
 #ifdef VAR_CYCLES
     CPU.Cycles += CPU.MemSpeedx2 + CPU.MemSpeed;
@@ -308,8 +273,7 @@ STATIC INLINE long FASTCALL DirectIndirectLong ()
 #ifdef VAR_CYCLES
     CPU.Cycles += CPU.MemSpeed;
 #endif
-    OpAddress = S9xGetWord (OpAddress) +
-		(S9xGetByte (OpAddress + 2) << 16);
+    OpAddress = S9xGetLong (OpAddress);
 //    if (Registers.DL != 0) CPU.Cycles += ONE_CYCLE;
 	return OpAddress;
 }
@@ -0,0 +1,161 @@
+#include "snes9x.h"
+#include "memmap.h"
+#include "cpuexec.h"
+#include "cpublocks.h"
+#include "cpuidle.h"
+#if CONF_BUILD_JIT_CPU
+#include "cpujit.h"
+#endif
+
+struct SCPUBlock S9xCPUBlocks [CPU_BLOCK_CACHE_SIZE];
+
+/* Instruction length in bytes with M=1 and X=1 */
+static const uint8 OpLength [256] = {
+/*       0  1  2  3  4  5  6  7  8  9  A  B  C  D  E  F */
+/* 0 */	 2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 4,
+/* 1 */	 2, 2, 2, 2, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 4,
+/* 2 */	 3, 2, 4, 2, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 4,
+/* 3 */	 2, 2, 2, 2, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 4,
+/* 4 */	 1, 2, 2, 2, 3, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 4,
+/* 5 */	 2, 2, 2, 2, 3, 2, 2, 2, 1, 3, 1, 1, 4, 3, 3, 4,
+/* 6 */	 1, 2, 3, 2, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 4,
+/* 7 */	 2, 2, 2, 2, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 4,
+/* 8 */	 2, 2, 3, 2, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 4,
+/* 9 */	 2, 2, 2, 2, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 4,
+/* A */	 2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 4,
+/* B */	 2, 2, 2, 2, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 4,
+/* C */	 2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 4,
+/* D */	 2, 2, 2, 2, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 4,
+/* E */	 2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 4,
+/* F */	 2, 2, 2, 2, 3, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 4
+};
+
+/* Opcode attributes */
+enum {
+	OP_IMM_M = 1 << 0,	// One byte longer with a 16 bit accumulator
+	OP_IMM_X = 1 << 1,	// One byte longer with 16 bit index registers
+	OP_END   = 1 << 2	// Ends a block: jumps, branches, mode changes...
+};
+
+static uint8 OpFlags [256];
+
+static void InitOpFlags ()
+{
+	static const uint8 immM[] = { 0x09, 0x29, 0x49, 0x69, 0x89, 0xa9, 0xc9, 0xe9 };
+	static const uint8 immX[] = { 0xa0, 0xa2, 0xc0, 0xe0 };
+	static const uint8 end[] = {
+		// Branches, including the speedhack branches behind 0x42
+		0x10, 0x30, 0x42, 0x50, 0x70, 0x80, 0x82, 0x90, 0xb0, 0xd0, 0xf0,
+		// Jumps, calls and returns
+		0x20, 0x22, 0x4c, 0x5c, 0x6c, 0x7c, 0xdc, 0xfc, 0x40, 0x60, 0x6b,
+		// Software interrupts and waits
+		0x00, 0x02, 0xcb, 0xdb,
+		// Opcode table changes; CLI may let a pending IRQ in
+		0xc2, 0xe2, 0x28, 0xfb, 0x58,
+		// Block moves loop by rewinding the PC
+		0x44, 0x54
+	};
+	unsigned int i;
+
+	for (i = 0; i < sizeof (immM); i++)
+		OpFlags [immM [i]] |= OP_IMM_M;
+	for (i = 0; i < sizeof (immX); i++)
+		OpFlags [immX [i]] |= OP_IMM_X;
+	for (i = 0; i < sizeof (end); i++)
+		OpFlags [end [i]] |= OP_END;
+}
+
+/* Finds the end of the memory area PC points into, if it is one we cache.
+ * ROM is write protected; WRAM and S-RAM blocks are verified on each use.
+ * Anything else (I/O areas, SA-1 I-RAM...) is left to the plain loop. */
+uint8 *S9xCPUCacheableEnd (uint8 *pc, bool8 *verify)
+{
+	if (pc >= Memory.ROM && pc < Memory.ROM + Memory.CalculatedSize) {
+		*verify = FALSE;
+		return Memory.ROM + Memory.CalculatedSize;
+	}
+	if (pc >= Memory.RAM && pc < Memory.RAM + 0x20000) {
+		*verify = TRUE;
+		return Memory.RAM + 0x20000;
+	}
+	if (pc >= Memory.SRAM && pc < Memory.SRAM + 0x20000) {
+		*verify = TRUE;
+		return Memory.SRAM + 0x20000;
+	}
+	return NULL;
+}
+
+int S9xCPUOpLength (uint8 op, struct SOpcodes *opcodes)
+{
+	int length = OpLength [op];
+
+	if ((OpFlags [op] & OP_IMM_M) &&
+		(opcodes == S9xOpcodesM0X1 || opcodes == S9xOpcodesM0X0))
+		length++;
+	if ((OpFlags [op] & OP_IMM_X) &&
+		(opcodes == S9xOpcodesM1X0 || opcodes == S9xOpcodesM0X0))
+		length++;
+
+	return length;
+}
+
+struct SCPUBlock *S9xCPUBlockDecode (struct SCPUBlock *block)
+{
+	struct SOpcodes *opcodes = ICPU.S9xOpcodes;
+	uint8 *pc = CPU.PC;
+	uint8 *end;
+	bool8 verify;
+
+	if (!OpFlags [0x00])
+		InitOpFlags ();
+
+	end = S9xCPUCacheableEnd (pc, &verify);
+	if (!end)
+		return NULL;
+
+	if (Settings.HacksAuto && !verify && S9xCPUIdleLoopPatch (pc, end, opcodes)) {
+		// Blocks running into the loop still have its old branch
+		S9xCPUBlocksFlush ();
+	}
+
+	block->PC = pc;
+	block->Opcodes = opcodes;
+	block->Verify = verify;
+	block->Count = 0;
+#if CONF_BUILD_JIT_CPU
+	block->Hits = 0;
+	block->Code = NULL;
+#endif
+
+	while (block->Count < CPU_BLOCK_MAX_OPS) {
+		uint8 op = *pc;
+		int length = S9xCPUOpLength (op, opcodes);
+
+		if (pc + length > end)
+			break;
+
+		block->Opcode [block->Count] = op;
+		block->Op [block->Count] = opcodes [op].S9xOpcode;
+		block->Count++;
+
+		if (OpFlags [op] & OP_END)
+			break;
+		pc += length;
+	}
+
+	if (!block->Count) {
+		block->PC = NULL;
+		return NULL;
+	}
+
+	return block;
+}
+
+void S9xCPUBlocksFlush ()
+{
+	for (int i = 0; i < CPU_BLOCK_CACHE_SIZE; i++)
+		S9xCPUBlocks [i].PC = NULL;
+#if CONF_BUILD_JIT_CPU
+	S9xCPUJitFlush ();
+#endif
+}
@@ -0,0 +1,58 @@
+#ifndef _CPUBLOCKS_H_
+#define _CPUBLOCKS_H_
+
+#include "snes9x.h"
+#include "cpuexec.h"
+
+/* Pre-decoded basic blocks for the C 65c816 core.
+ * A block is a straight run of opcodes starting at some host address, each
+ * already resolved to its handler for one opcode table (i.e. one M/X/E mode).
+ * It ends at the first instruction that may change the PC non-sequentially
+ * or switch the opcode table. Handlers still read their operands through
+ * CPU.PC, so only the opcode bytes have to stay valid; blocks decoded from
+ * writable memory keep a copy of them and are dropped when one changes. */
+
+#define CPU_BLOCK_MAX_OPS	16
+#define CPU_BLOCK_CACHE_SIZE	4096	// Must be a power of two
+
+struct SCPUBlock {
+	uint8 *PC;			// Host address of the first opcode, NULL if free
+	struct SOpcodes *Opcodes;	// Opcode table the block was decoded with
+	bool8 Verify;			// Decoded from RAM: check Opcode[] before use
+	uint8 Count;
+	uint8 Opcode [CPU_BLOCK_MAX_OPS];
+	void (*Op [CPU_BLOCK_MAX_OPS])();
+#if CONF_BUILD_JIT_CPU
+	uint8 Hits;			// Runs since decoding, see CPU_JIT_THRESHOLD
+	int (*Code)();			// Native translation, NULL until hot
+#endif
+};
+
+START_EXTERN_C
+extern struct SCPUBlock S9xCPUBlocks [CPU_BLOCK_CACHE_SIZE];
+
+/** Decodes the block at CPU.PC into its cache slot.
+	@return NULL if the code at CPU.PC cannot be cached. */
+struct SCPUBlock *S9xCPUBlockDecode (struct SCPUBlock *block);
+/** @return The end of the memory area pc points into, NULL if blocks are
+	not cached there. *verify is set if the code there may change. */
+uint8 *S9xCPUCacheableEnd (uint8 *pc, bool8 *verify);
+/** @return The length in bytes of an instruction under the given opcode table. */
+int S9xCPUOpLength (uint8 op, struct SOpcodes *opcodes);
+/** Drops every cached block, e.g. after the ROM image changed. */
+void S9xCPUBlocksFlush ();
+END_EXTERN_C
+
+STATIC inline struct SCPUBlock *S9xCPUBlockGet ()
+{
+	uintptr_t hash = (uintptr_t) CPU.PC ^ ((uintptr_t) CPU.PC >> 12) ^
+		((uintptr_t) ICPU.S9xOpcodes >> 10);
+	struct SCPUBlock *block = &S9xCPUBlocks [hash & (CPU_BLOCK_CACHE_SIZE - 1)];
+
+	if (block->PC == CPU.PC && block->Opcodes == ICPU.S9xOpcodes)
+		return block;
+
+	return S9xCPUBlockDecode (block);
+}
+
+#endif
@@ -53,9 +53,15 @@
 #include "apu.h"
 #include "dma.h"
 #include "fxemu.h"
+#include "profile.h"
 
 #if !CONF_BUILD_ASM_CPU
 #include "cpuops.h"
+#include "cpublocks.h"
+#include "cpuidle.h"
+#if CONF_BUILD_JIT_CPU
+#include "cpujit.h"
+#endif
 #endif
 
 #ifdef USE_SA1
@@ -73,6 +79,69 @@ uint16 mem_check=0;
 int framecpt=0;
 #endif
 
+#if !CONF_BUILD_ASM_CPU
+/* Charges the fetch of the opcode at CPU.PC and steps over it, before its
+ * handler runs. Shared by the per opcode loop and the block runner, so both
+ * account for cycles the same way; the JIT emits the same steps. */
+static INLINE void StartOpcode ()
+{
+#ifdef CPU_SHUTDOWN
+	CPU.PCAtOpcodeStart = CPU.PC;
+#endif
+	ICPU.OpcodeCycles = CPU.Cycles;
+	CPU.Cycles += CPU.MemSpeed;
+	CPU.PC++;
+}
+
+/* Runs pre-decoded blocks back to back, starting with the given one, until
+ * an event is due, an interrupt is flagged or the code at CPU.PC cannot be
+ * cached. Opcodes run exactly as in the loop below, but the APU is only
+ * caught up when leaving or when the CPU touches its ports (S9xAPUCatchUp),
+ * and the flags and the opcode table are only looked at between blocks.
+ * With CONF_BUILD_JIT_CPU, hot blocks run as translated code instead. */
+static void RunBlocks (struct SCPUBlock *block)
+{
+	ICPU.InBlock = TRUE;
+	do {
+		// Locals, so they stay in registers across the handler calls
+		void (**op)() = block->Op;
+		void (**end)() = op + block->Count;
+		const uint8 *opcode = block->Verify ? block->Opcode : NULL;
+
+#if CONF_BUILD_JIT_CPU
+		if (block->Code || (++block->Hits == CPU_JIT_THRESHOLD &&
+			S9xCPUJitCompile (block))) {
+			if (block->Code ())
+				goto out;
+			continue;
+		}
+#endif
+
+		do {
+			if (opcode && *CPU.PC != *opcode++) {
+				// The code was overwritten since it was decoded
+				block->PC = NULL;
+				goto out;
+			}
+			StartOpcode ();
+			(**op) ();
+
+#ifdef USE_SA1
+			S9xSA1Step ();
+#endif
+
+			if (CPU.Flags || CPU.Cycles >= CPU.NextEvent)
+				goto out;
+		} while (++op != end);
+	} while ((block = S9xCPUBlockGet ()));
+
+out:
+	// Leave the APU where the per opcode loop would have
+	S9xAPUCatchUp ();
+	ICPU.InBlock = FALSE;
+}
+#endif
+
 void S9xMainLoop (void)
 {	
 #if defined(__showframe__)
@@ -81,6 +150,7 @@ void S9xMainLoop (void)
 	sprintf(stra,"framecpt : %d",framecpt);
 	S9xMessage(0,0,stra);
 #endif
+	PROFILE_ENTER(PROFILE_CPU);
 
 #if CONF_BUILD_ASM_CPU
 	asmMainLoop(&CPU);
@@ -119,23 +189,33 @@ void S9xMainLoop (void)
 			if (CPU.Flags & SCAN_KEYS_FLAG)
 				break;
 		}
+		else
+		{
+			struct SCPUBlock *block = S9xCPUBlockGet ();
+			if (block) {
+				RunBlocks (block);
+				DO_HBLANK_CHECK ();
+				continue;
+			}
+		}
 
-#ifdef CPU_SHUTDOWN
-		CPU.PCAtOpcodeStart = CPU.PC;
-#endif
-		CPU.Cycles += CPU.MemSpeed;
-
-		(*ICPU.S9xOpcodes[*CPU.PC++].S9xOpcode) ();
+		StartOpcode ();
+		(*ICPU.S9xOpcodes[CPU.PC [-1]].S9xOpcode) ();
 
 #ifdef USE_SA1
-		if (SA1.Executing)
-			S9xSA1MainLoop ();
+		S9xSA1Step ();
 #endif
 
 		DO_HBLANK_CHECK ();
 	}
 #endif
 
+#ifdef USE_SA1
+    // Leave the SA-1 where the serial core would have it between frames
+    if (SA1.Threaded)
+	S9xSA1ThreadPause ();
+#endif
+
     Registers.PC = CPU.PC - CPU.PCBase;
 #if !CONF_BUILD_ASM_CPU
     S9xPackStatus ();
@@ -152,7 +232,109 @@ void S9xMainLoop (void)
 	CPU.TriedInterleavedMode2 = TRUE;
 	CPU.BRKTriggered = FALSE;
 	S9xDeinterleaveMode2 ();
+#if !CONF_BUILD_ASM_CPU
+	S9xCPUBlocksFlush ();
+#endif
+    }
+    PROFILE_LEAVE();
+}
+
+/* Runs the APU up to the start of the current opcode, which is where the
+ * per opcode loop leaves it, when the CPU is in the middle of a block.
+ * Called before anything that exchanges data with the APU. */
+void S9xAPUCatchUp ()
+{
+#if !CONF_BUILD_ASM_CPU
+    if (ICPU.InBlock)
+    {
+	int32 cycles = CPU.Cycles;
+	CPU.Cycles = ICPU.OpcodeCycles;
+	APU_EXECUTE (1);
+	CPU.Cycles = cycles;
+    }
+#endif
+}
+
+/* The loop at CPU.APUWaitAddress, as S9xAPUWaitRead and S9xAPUWaitLoop
+ * saw it last */
+static struct {
+    uint8  OutPorts [4];	// The APU ports as the last read returned them
+    int32  Arrival;		// CPU.Cycles after the last branch back
+    int32  Period;		// Cycles between the last two branches back
+    bool8  Checked;		// Whether Loop is up to date
+    uint8  *Loop;		// Branch closing the loop, NULL if it cannot be run ahead
+    struct SOpcodes *Opcodes;	// What Loop was worked out for
+    uint16 D;
+    uint32 ShiftedDB;
+} APUWait;
+
+void S9xAPUWaitRead ()
+{
+    if (CPU.PCAtOpcodeStart != CPU.APUWaitAddress)
+    {
+	CPU.APUWaitAddress = CPU.PCAtOpcodeStart;
+	APUWait.Period = 0;
+	APUWait.Checked = FALSE;
+    }
+    memcpy (APUWait.OutPorts, APU.OutPorts, sizeof (APUWait.OutPorts));
+}
+
+/* Runs through a loop that polls an APU port, without interpreting it.
+ * Called on each branch back to the port read; once the loop is known to
+ * only read the port, WRAM and ROM, and two passes in a row took the same
+ * number of cycles, every further pass is the same as the last one until
+ * the port changes. So the APU is run ahead pass by pass, up to where the
+ * next read would see a new value or a pass would run into the next event,
+ * and CPU.Cycles is moved to the start of that pass. Nothing the CPU could
+ * see differs from interpreting the passes. */
+void S9xAPUWaitLoop ()
+{
+#if !CONF_BUILD_ASM_CPU
+    int32 period = CPU.Cycles - APUWait.Arrival;
+    bool8 steady = period > 0 && period == APUWait.Period;
+
+    APUWait.Arrival = CPU.Cycles;
+    APUWait.Period = period;
+
+    // Interrupts and the SA-1 need the passes to be run
+    if (!steady || CPU.Flags)
+	return;
+#ifdef USE_SA1
+    if (SA1.Threaded || SA1.Executing)
+	return;
+#endif
+
+    if (!APUWait.Checked || APUWait.Opcodes != ICPU.S9xOpcodes ||
+	APUWait.D != Registers.D.W || APUWait.ShiftedDB != ICPU.ShiftedDB)
+    {
+	APUWait.Loop = S9xCPUAPUWaitLoop (CPU.PC, ICPU.S9xOpcodes);
+	APUWait.Checked = TRUE;
+	APUWait.Opcodes = ICPU.S9xOpcodes;
+	APUWait.D = Registers.D.W;
+	APUWait.ShiftedDB = ICPU.ShiftedDB;
+    }
+    if (APUWait.Loop != CPU.PCAtOpcodeStart)
+	return;
+
+    int32 cycles = CPU.Cycles;
+    ICPU.CPUExecuting = FALSE;
+    for (;;)
+    {
+	// The APU as the port read at the start of this pass would find it
+	CPU.Cycles = cycles;
+	if (CPU.APU_APUExecuting)
+	{
+	    while (CPU.APU_Cycles <= cycles)
+		APU_EXECUTE1 ();
+	}
+	if (memcmp (APU.OutPorts, APUWait.OutPorts, sizeof (APUWait.OutPorts)) ||
+	    cycles + period >= CPU.NextEvent)
+	    break;
+	cycles += period;
     }
+    ICPU.CPUExecuting = TRUE;
+    APUWait.Arrival = cycles;
+#endif
 }
 
 void S9xSetIRQ (uint32 source)
@@ -176,16 +358,116 @@ void S9xClearIRQ (uint32 source)
 }
 
 
+/* Deadlines of the pending timed events, indexed by event, NO_TIME when
+ * not pending. Deadlines are CPU.Cycles values, so they are relative to the
+ * start of the current scanline. The earliest one is mirrored in
+ * CPU.NextEvent and CPU.WhichEvent, which is all the CPU cores and the
+ * snapshot code ever look at; there are few enough kinds of events that
+ * finding it is a short scan. */
+#define NO_TIME 0x7fffffff
+static int32 EventTime [NO_EVENT];
+
+static void UpdateNextEvent ()
+{
+    uint8 which = NO_EVENT;
+    int32 time = NO_TIME;
+
+    // Events due at the same time run in the order of their numbers
+    for (int i = 0; i < NO_EVENT; i++)
+    {
+	if (EventTime [i] < time)
+	{
+	    time = EventTime [i];
+	    which = i;
+	}
+    }
+    CPU.NextEvent = time;
+    CPU.WhichEvent = which;
+}
+
+void S9xScheduleEvent (uint8 which, int32 time)
+{
+    EventTime [which] = time;
+    UpdateNextEvent ();
+}
+
+void S9xCancelEvent (uint8 which)
+{
+    EventTime [which] = NO_TIME;
+    UpdateNextEvent ();
+}
+
+bool8 S9xEventPending (uint8 which)
+{
+    return EventTime [which] != NO_TIME;
+}
+
+static void ClearEvents ()
+{
+    for (int i = 0; i < NO_EVENT; i++)
+	EventTime [i] = NO_TIME;
+}
+
+/* Queues the H-IRQ of the current line if it is enabled there and falls
+ * between the two given times. Leaves CPU.NextEvent to the caller. */
+static void ScheduleHTimer (uint8 which, long after, long before)
+{
+    if (PPU.HTimerEnabled &&
+	(long) PPU.HTimerPosition > after &&
+	(long) PPU.HTimerPosition < before &&
+	(!PPU.VTimerEnabled || CPU.V_Counter == PPU.IRQVBeamPos))
+    {
+	EventTime [which] = PPU.HTimerPosition;
+    }
+}
+
+/* Queues the events of a new scanline. */
+static void StartLineEvents ()
+{
+    EventTime [HBLANK_START_EVENT] = Settings.HBlankStart;
+    EventTime [HBLANK_END_EVENT] = Settings.H_Max;
+    ScheduleHTimer (HTIMER_BEFORE_EVENT, -1, Settings.HBlankStart);
+}
+
+void S9xResetEvents ()
+{
+    ClearEvents ();
+    EventTime [HBLANK_START_EVENT] = Settings.HBlankStart;
+    EventTime [HBLANK_END_EVENT] = Settings.H_Max;
+    UpdateNextEvent ();
+}
+
+/* Rebuilds the queue from CPU.WhichEvent and CPU.NextEvent, which is all a
+ * snapshot records of it. */
+void S9xReschedule ()
+{
+    uint8 which = CPU.WhichEvent;
+    int32 time = CPU.NextEvent;
+
+    ClearEvents ();
+    if (which == HBLANK_START_EVENT || which == HTIMER_BEFORE_EVENT)
+	EventTime [HBLANK_START_EVENT] = Settings.HBlankStart;
+    EventTime [HBLANK_END_EVENT] = Settings.H_Max;
+    if (which == HTIMER_BEFORE_EVENT || which == HTIMER_AFTER_EVENT)
+	EventTime [which] = time;
+    UpdateNextEvent ();
+}
+
 void S9xDoHBlankProcessing ()
 {
+    uint8 which = CPU.WhichEvent;
+
 #ifdef CPU_SHUTDOWN
     CPU.WaitCounter++;
 #endif
-    switch (CPU.WhichEvent)
+    EventTime [which] = NO_TIME;
+
+    switch (which)
     {
     case HBLANK_START_EVENT:
 		if (IPPU.HDMA && CPU.V_Counter <= PPU.ScreenHeight)
 			IPPU.HDMA = S9xDoHDMA (IPPU.HDMA);
+		ScheduleHTimer (HTIMER_AFTER_EVENT, Settings.HBlankStart, Settings.H_Max);
 		break;
 
     case HBLANK_END_EVENT:
@@ -200,7 +482,10 @@ void S9xDoHBlankProcessing ()
 		else
 			CPU.APU_Cycles = 0;
 
-		CPU.NextEvent = -1;
+		// Whatever is still queued moves along with CPU.Cycles
+		for (int i = 0; i < NO_EVENT; i++)
+			if (EventTime [i] != NO_TIME)
+				EventTime [i] -= Settings.H_Max;
 		ICPU.Scanline++;
 
 		if (++CPU.V_Counter > (Settings.PAL ? SNES_MAX_PAL_VCOUNTER : SNES_MAX_NTSC_VCOUNTER))
@@ -308,6 +593,7 @@ void S9xDoHBlankProcessing ()
 			}
 			}
 		}
+		StartLineEvents ();
 		break;
 	case HTIMER_BEFORE_EVENT:
 	case HTIMER_AFTER_EVENT:
@@ -318,5 +604,5 @@ void S9xDoHBlankProcessing ()
 		}
 		break;
     }
-    S9xReschedule ();
+    UpdateNextEvent ();
 }
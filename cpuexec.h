@@ -61,6 +61,10 @@ struct SICPU
     uint8  _Zero;
     uint8  _Negative;
     uint8  _Overflow;
+    // Cycle count at the start of the opcode running inside a block,
+    // for S9xAPUCatchUp
+    int32  OpcodeCycles;
+    bool8  InBlock;
 #endif
 	bool8  CPUExecuting;
     uint32 ShiftedPB;
@@ -76,6 +80,20 @@ void S9xReset (void);
 void S9xDoHBlankProcessing ();
 void S9xClearIRQ (uint32);
 void S9xSetIRQ (uint32);
+void S9xAPUCatchUp ();
+/** Notes what the CPU read from the APU ports, see S9xAPUWaitLoop. */
+void S9xAPUWaitRead ();
+/** Called when the CPU branches back to CPU.APUWaitAddress. */
+void S9xAPUWaitLoop ();
+/** Queues an event for the given CPU.Cycles time on the current scanline,
+	replacing any pending event of the same kind. */
+void S9xScheduleEvent (uint8 which, int32 time);
+void S9xCancelEvent (uint8 which);
+bool8 S9xEventPending (uint8 which);
+/** Queues the events of the first scanline after a reset. */
+void S9xResetEvents ();
+/** Rebuilds the event queue after CPU.WhichEvent/NextEvent were restored. */
+void S9xReschedule ();
 
 extern struct SOpcodes S9xOpcodesM1X1 [256];
 extern struct SOpcodes S9xOpcodesM1X0 [256];
@@ -163,35 +181,4 @@ STATIC inline void S9xFixCycles ()
 }
 #endif
 
-STATIC inline void S9xReschedule ()
-{
-    uint8 which;
-    long max;
-    
-    if (CPU.WhichEvent == HBLANK_START_EVENT ||
-	CPU.WhichEvent == HTIMER_AFTER_EVENT)
-    {
-	which = HBLANK_END_EVENT;
-	max = Settings.H_Max;
-    }
-    else
-    {
-	which = HBLANK_START_EVENT;
-	max = Settings.HBlankStart;
-    }
-
-    if (PPU.HTimerEnabled &&
-        (long) PPU.HTimerPosition < max &&
-	(long) PPU.HTimerPosition > CPU.NextEvent &&
-	(!PPU.VTimerEnabled ||
-	 (PPU.VTimerEnabled && CPU.V_Counter == PPU.IRQVBeamPos)))
-    {
-	which = (long) PPU.HTimerPosition < Settings.HBlankStart ?
-			HTIMER_BEFORE_EVENT : HTIMER_AFTER_EVENT;
-	max = PPU.HTimerPosition;
-    }
-    CPU.NextEvent = max;
-    CPU.WhichEvent = which;
-}
-
 #endif
@@ -0,0 +1,287 @@
+#include "snes9x.h"
+#include "memmap.h"
+#include "cpuexec.h"
+#include "cpublocks.h"
+#include "cpuidle.h"
+#include "hacks.h"
+#include "sa1.h"
+
+/* An idle loop may be at most this long, branch included, so the 0x42
+ * branch can still reach its start. */
+#define IDLE_LOOP_MAX_BYTES	16
+
+/* Opcodes an idle loop may contain: loads, logic operations, compares and
+ * bit tests, without indexed or indirect operands */
+enum {
+	IDLE_OK      = 1 << 0,
+	IDLE_READ_A  = 1 << 1,	// Uses the accumulator
+	IDLE_WRITE_A = 1 << 2,	// Changes the accumulator
+	IDLE_DIRECT  = 1 << 3,	// Reads a direct page operand
+	IDLE_ABS     = 1 << 4,	// Reads an absolute operand in the data bank
+	IDLE_LONG    = 1 << 5,	// Reads a long operand
+	IDLE_INDEX   = 1 << 6	// Uses X or Y
+};
+
+// What a loop may read, see FindLoop
+enum { LOOP_IDLE, LOOP_APU, LOOP_SA1 };
+
+static uint8 IdleOp [256];
+
+static void InitIdleOps ()
+{
+	// ORA, AND, EOR, LDA and CMP
+	static const uint8 alu[] = { 0x00, 0x20, 0x40, 0xa0, 0xc0 };
+	static const uint8 aluFlags[] = {
+		IDLE_READ_A | IDLE_WRITE_A, IDLE_READ_A | IDLE_WRITE_A,
+		IDLE_READ_A | IDLE_WRITE_A, IDLE_WRITE_A, IDLE_READ_A
+	};
+	static const struct { uint8 op; uint8 flags; } other[] = {
+		// LDX, LDY, CPX, CPY
+		{ 0xa2, IDLE_INDEX }, { 0xa6, IDLE_INDEX | IDLE_DIRECT },
+		{ 0xae, IDLE_INDEX | IDLE_ABS },
+		{ 0xa0, IDLE_INDEX }, { 0xa4, IDLE_INDEX | IDLE_DIRECT },
+		{ 0xac, IDLE_INDEX | IDLE_ABS },
+		{ 0xe0, IDLE_INDEX }, { 0xe4, IDLE_INDEX | IDLE_DIRECT },
+		{ 0xec, IDLE_INDEX | IDLE_ABS },
+		{ 0xc0, IDLE_INDEX }, { 0xc4, IDLE_INDEX | IDLE_DIRECT },
+		{ 0xcc, IDLE_INDEX | IDLE_ABS },
+		// BIT
+		{ 0x89, IDLE_READ_A }, { 0x24, IDLE_READ_A | IDLE_DIRECT },
+		{ 0x2c, IDLE_READ_A | IDLE_ABS },
+		// ASL A, LSR A
+		{ 0x0a, IDLE_READ_A | IDLE_WRITE_A },
+		{ 0x4a, IDLE_READ_A | IDLE_WRITE_A },
+		// NOP, CLC, SEC, CLV
+		{ 0xea, 0 }, { 0x18, 0 }, { 0x38, 0 }, { 0xb8, 0 }
+	};
+	unsigned int i;
+
+	for (i = 0; i < sizeof (alu); i++) {
+		IdleOp [alu [i] | 0x09] = IDLE_OK | aluFlags [i];
+		IdleOp [alu [i] | 0x05] = IDLE_OK | aluFlags [i] | IDLE_DIRECT;
+		IdleOp [alu [i] | 0x0d] = IDLE_OK | aluFlags [i] | IDLE_ABS;
+		IdleOp [alu [i] | 0x0f] = IDLE_OK | aluFlags [i] | IDLE_LONG;
+	}
+	for (i = 0; i < sizeof (other) / sizeof (other [0]); i++)
+		IdleOp [other [i].op] = IDLE_OK | other [i].flags;
+}
+
+static bool8 IsBranch (uint8 op)
+{
+	// BPL, BMI, BVC, BVS, BCC, BCS, BNE, BEQ and BRA, the ones 0x42 can do
+	return (op & 0x1f) == 0x10 || op == 0x80;
+}
+
+/* Whether reading address has no side effects, and its value only changes
+ * at scanline events or in interrupt handlers. */
+static bool8 QuietAddress (uint32 address)
+{
+	uint32 bank = (address >> 16) & 0xff;
+	uint32 offset = address & 0xffff;
+
+	if (bank == 0x7e || bank == 0x7f)
+		return TRUE;
+	if (!(bank & 0x40)) {
+		// WRAM mirror, NMI flag, H/V-blank flags, auto-read joypads
+		if (offset < 0x2000 || offset == 0x4210 || offset == 0x4212 ||
+			(offset >= 0x4218 && offset < 0x4220))
+			return TRUE;
+	}
+	return Memory.BlockIsROM [(address >> MEMMAP_SHIFT) & MEMMAP_MASK];
+}
+
+/* Whether reading address returns the same value every time until the
+ * CPU itself writes somewhere: WRAM and ROM. */
+static bool8 StableAddress (uint32 address)
+{
+	uint32 bank = (address >> 16) & 0xff;
+
+	if (bank == 0x7e || bank == 0x7f)
+		return TRUE;
+	if (!(bank & 0x40) && (address & 0xffff) < 0x2000)
+		return TRUE;
+	return Memory.BlockIsROM [(address >> MEMMAP_SHIFT) & MEMMAP_MASK];
+}
+
+static bool8 APUPort (uint32 address)
+{
+	return !(address & 0x400000) && (address & 0xffc0) == 0x2140;
+}
+
+/* Whether the SA-1 reading address only sees ROM, or I-RAM and BW-RAM that
+ * nothing but the S-CPU changes while the SA-1 loops. Those bytes are added
+ * to watch, which has room for two. */
+static bool8 SA1Watch (uint32 address, uint8 **watch)
+{
+	uint8 *ptr = SA1.Map [(address >> MEMMAP_SHIFT) & MEMMAP_MASK];
+
+	if (ptr == (uint8 *) CMemory::MAP_BWRAM)
+		ptr = SA1.BWRAM + ((address & 0x7fff) - 0x6000);
+	else if (ptr >= (uint8 *) CMemory::MAP_LAST)
+		ptr += address & 0xffff;
+	else
+		return FALSE;
+
+	if (ptr >= Memory.ROM && ptr < Memory.ROM + Memory.CalculatedSize)
+		return TRUE;
+	if (!(ptr >= Memory.FillRAM + 0x3000 && ptr < Memory.FillRAM + 0x3800) &&
+		!(ptr >= Memory.SRAM && ptr < Memory.SRAM + 0x20000))
+		return FALSE;
+
+	if (watch [0] == ptr || watch [1] == ptr)
+		return TRUE;
+	if (!watch [0])
+		watch [0] = ptr;
+	else if (!watch [1])
+		watch [1] = ptr;
+	else
+		return FALSE;
+	return TRUE;
+}
+
+/* Finds the branch closing the loop that starts at start, if the loop only
+ * reads memory and leaves the same registers behind on every pass.
+ * For LOOP_APU, the first opcode must read an APU port and the rest may only
+ * read stable memory; for LOOP_IDLE every read must be of quiet memory.
+ * LOOP_SA1 loops are run by the SA-1 and may read what SA1Watch allows. */
+static uint8 *FindLoop (uint8 *start, uint8 *end, struct SOpcodes *opcodes,
+	int kind, uint8 **watch)
+{
+	uint8 *pc = start;
+	bool8 loadedA = FALSE;
+	bool8 apu = kind == LOOP_APU;
+	uint16 d = kind == LOOP_SA1 ? SA1Registers.D.W : Registers.D.W;
+	uint32 db = kind == LOOP_SA1 ? SA1.ShiftedDB : ICPU.ShiftedDB;
+	bool8 m16 = opcodes == S9xOpcodesM0X1 || opcodes == S9xOpcodesM0X0;
+	bool8 x16 = opcodes == S9xOpcodesM1X0 || opcodes == S9xOpcodesM0X0;
+
+	if (!IdleOp [0xea])
+		InitIdleOps ();
+
+	for (;;) {
+		uint8 op = *pc;
+		int length = S9xCPUOpLength (op, opcodes);
+		uint8 flags = IdleOp [op];
+		uint32 address;
+
+		if (pc + length > end || pc + length - start > IDLE_LOOP_MAX_BYTES)
+			return NULL;
+		if (IsBranch (op))
+			break;
+		if (!(flags & IDLE_OK))
+			return NULL;
+
+		// Every pass must start from the same registers
+		if ((flags & IDLE_READ_A) && (flags & IDLE_WRITE_A) && !loadedA)
+			return NULL;
+		if (flags & IDLE_WRITE_A)
+			loadedA = TRUE;
+
+		if (flags & (IDLE_DIRECT | IDLE_ABS | IDLE_LONG)) {
+			if (flags & IDLE_DIRECT)
+				address = (d + pc [1]) & 0xffff;
+			else if (flags & IDLE_ABS)
+				address = db + (pc [1] | (pc [2] << 8));
+			else
+				address = pc [1] | (pc [2] << 8) | (pc [3] << 16);
+
+			// 16 bit registers read the next byte too
+			if (kind == LOOP_SA1) {
+				if (!SA1Watch (address, watch))
+					return NULL;
+				if (((flags & IDLE_INDEX) ? x16 : m16) &&
+					!SA1Watch (address + 1, watch))
+					return NULL;
+			} else if (!apu) {
+				if (!QuietAddress (address) || !QuietAddress (address + 1))
+					return NULL;
+			} else if (pc == start) {
+				if (!APUPort (address) || !APUPort (address + 1))
+					return NULL;
+			} else if (!StableAddress (address) || !StableAddress (address + 1))
+				return NULL;
+		} else if (apu && pc == start)
+			return NULL;
+		pc += length;
+	}
+
+	// The branch must go back to the first opcode
+	if (pc + 2 + (int8) pc [1] != start)
+		return NULL;
+
+	return pc;
+}
+
+bool8 S9xCPUIdleLoopPatch (uint8 *pc, uint8 *end, struct SOpcodes *opcodes)
+{
+	uint8 *branch = FindLoop (pc, end, opcodes, LOOP_IDLE, NULL);
+
+	if (!branch)
+		return FALSE;
+
+	uint8 patch [2] = {
+		0x42, (uint8) ((branch [0] & 0xf0) | (branch [1] & 0x0f))
+	};
+	branch [0] = patch [0];
+	branch [1] = patch [1];
+	S9xHacksAddPatch (branch - Memory.ROM, patch, sizeof (patch));
+
+	return TRUE;
+}
+
+uint8 *S9xCPUAPUWaitLoop (uint8 *pc, struct SOpcodes *opcodes)
+{
+	bool8 verify;
+	uint8 *end = S9xCPUCacheableEnd (pc, &verify);
+
+	if (!end)
+		return NULL;
+
+	return FindLoop (pc, end, opcodes, LOOP_APU, NULL);
+}
+
+void S9xSA1IdleBranch ()
+{
+	if (SA1.PCAtOpcodeStart == SA1.IdleLoop &&
+		SA1.S9xOpcodes == SA1.IdleOpcodes &&
+		SA1Registers.D.W == SA1.IdleD && SA1.ShiftedDB == SA1.IdleShiftedDB) {
+		if (!SA1.WaitByteAddress1)
+			return;
+		// A whole pass since the S-CPU last wrote what the loop reads
+		if (SA1.WaitCounter >= 1) {
+			SA1.Executing = FALSE;
+			SA1.CPUExecuting = FALSE;
+		} else
+			SA1.WaitCounter++;
+		return;
+	}
+
+	SA1.IdleLoop = SA1.PCAtOpcodeStart;
+	SA1.IdleOpcodes = SA1.S9xOpcodes;
+	SA1.IdleD = SA1Registers.D.W;
+	SA1.IdleShiftedDB = SA1.ShiftedDB;
+	SA1.WaitByteAddress1 = NULL;
+	SA1.WaitByteAddress2 = NULL;
+
+	// Only ROM code, which the S-CPU cannot change under the loop
+	bool8 verify;
+	uint8 *end = S9xCPUCacheableEnd (SA1.PC, &verify);
+	if (!end || verify)
+		return;
+
+	// The opcode lengths only depend on the M and X flags
+	struct SOpcodes *opcodes =
+		SA1.S9xOpcodes == S9xSA1OpcodesM0X0 ? S9xOpcodesM0X0 :
+		SA1.S9xOpcodes == S9xSA1OpcodesM0X1 ? S9xOpcodesM0X1 :
+		SA1.S9xOpcodes == S9xSA1OpcodesM1X0 ? S9xOpcodesM1X0 :
+		S9xOpcodesM1X1;
+	uint8 *watch [2] = { NULL, NULL };
+	uint8 *branch = FindLoop (SA1.PC, end, opcodes, LOOP_SA1, watch);
+
+	// Loops that only read ROM wait for an IRQ; watch a byte no one writes
+	if (branch != SA1.PCAtOpcodeStart)
+		return;
+	SA1.WaitByteAddress1 = watch [0] ? watch [0] : Memory.ROM;
+	SA1.WaitByteAddress2 = watch [1];
+	SA1.WaitCounter = 1;
+}
@@ -0,0 +1,34 @@
+#ifndef _CPUIDLE_H_
+#define _CPUIDLE_H_
+
+#include "snes9x.h"
+#include "cpuexec.h"
+
+/* Idle loop detection for the C 65c816 core (Settings.HacksAuto).
+ * A ROM loop that only reads memory which cannot change before the next
+ * scanline event or interrupt, such as WRAM flags set by the NMI handler or
+ * the $4210/$4212 status registers, is patched into the 0x42 (WDM) branch
+ * the speedhacks file uses, so it skips straight to the next event.
+ * The patches are recorded with S9xHacksAddPatch and can be exported.
+ * The same analysis finds the loops that wait for the APU to answer on
+ * its ports, which S9xAPUWaitLoop runs through with the APU alone, and the
+ * SA-1 loops that wait for the S-CPU, which park the SA-1 until the S-CPU
+ * writes what they read. */
+
+START_EXTERN_C
+/** Patches the loop starting at pc, if it is an idle loop.
+	@param end End of the ROM area pc points into.
+	@return TRUE if the ROM was changed. */
+bool8 S9xCPUIdleLoopPatch (uint8 *pc, uint8 *end, struct SOpcodes *opcodes);
+/** Checks whether the loop starting at pc reads an APU port first and
+	otherwise only reads WRAM or ROM, so that passes of it only differ
+	once the port changes.
+	@return The branch closing the loop, NULL if it is not such a loop. */
+uint8 *S9xCPUAPUWaitLoop (uint8 *pc, struct SOpcodes *opcodes);
+/** Called when the SA-1 branches backwards, on ROMs without a hardcoded
+	SA1.WaitAddress. Points SA1.WaitByteAddress1/2 at what the loop reads
+	and parks the SA-1 once it has run a whole pass after the last write. */
+void S9xSA1IdleBranch ();
+END_EXTERN_C
+
+#endif
@@ -0,0 +1,568 @@
+#include <string.h>
+#include <sys/mman.h>
+
+#include "snes9x.h"
+#include "memmap.h"
+#include "cpuexec.h"
+#include "sa1.h"
+#include "cpublocks.h"
+#include "cpujit.h"
+
+/* The generated code keeps &CPU in r15 and reaches every other global it
+ * touches (ICPU, Memory, SA1) through a 32 bit displacement from it.
+ * Scratch registers are eax, ecx, edx, esi and edi; nothing is kept in them
+ * across calls, so the emitted C calls need no saving. */
+
+// Room one block can take at most: 16 opcodes of about 300 bytes each
+#define kMaxBlockCode	8192
+
+static uint8 *CodeBuffer;	// NULL until the first translation
+static uint8 *CodePtr;
+static bool8 Disabled;
+
+// Register numbers as encoded in ModRM
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI };
+
+// Condition codes for Jcc
+enum { CC_B = 0x2, CC_E = 0x4, CC_NE = 0x5, CC_GE = 0xd };
+
+#define DISP(x)	((int32) ((uint8 *) &(x) - (uint8 *) &CPU))
+
+static bool8 InRange (const void *p)
+{
+	intptr_t d = (intptr_t) p - (intptr_t) &CPU;
+	return d == (int32) d;
+}
+
+static bool8 InitBuffer ()
+{
+	void *p;
+
+	if (!InRange (&Memory) || !InRange ((uint8 *) &Memory + sizeof (Memory)) ||
+		!InRange (&ICPU) || !InRange (&SA1)) {
+		Disabled = TRUE;
+		return FALSE;
+	}
+
+	p = mmap (NULL, CPU_JIT_BUFFER_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED) {
+		Disabled = TRUE;
+		return FALSE;
+	}
+
+	CodeBuffer = CodePtr = (uint8 *) p;
+	return TRUE;
+}
+
+static void Emit8 (uint8 b)
+{
+	*CodePtr++ = b;
+}
+
+static void Emit32 (uint32 d)
+{
+	memcpy (CodePtr, &d, 4);
+	CodePtr += 4;
+}
+
+static void Emit64 (uintptr_t q)
+{
+	memcpy (CodePtr, &q, 8);
+	CodePtr += 8;
+}
+
+/* [r15 + disp] operand */
+static void Mem (int reg, int32 disp)
+{
+	Emit8 (0x87 | reg << 3);
+	Emit32 (disp);
+}
+
+/* [r15 + index << scale + disp] operand */
+static void MemIndex (int reg, int index, int scale, int32 disp)
+{
+	Emit8 (0x84 | reg << 3);
+	Emit8 (scale << 6 | index << 3 | 7);
+	Emit32 (disp);
+}
+
+static void Load32 (int reg, int32 disp)
+{
+	Emit8 (0x41); Emit8 (0x8b); Mem (reg, disp);
+}
+
+static void LoadU8 (int reg, int32 disp)
+{
+	Emit8 (0x41); Emit8 (0x0f); Emit8 (0xb6); Mem (reg, disp);
+}
+
+static void LoadU16 (int reg, int32 disp)
+{
+	Emit8 (0x41); Emit8 (0x0f); Emit8 (0xb7); Mem (reg, disp);
+}
+
+static void Load (bool8 wide, int reg, int32 disp)
+{
+	if (wide)
+		LoadU16 (reg, disp);
+	else
+		LoadU8 (reg, disp);
+}
+
+static void Store (bool8 wide, int32 disp, int reg)
+{
+	if (wide)
+		Emit8 (0x66);
+	Emit8 (0x41); Emit8 (wide ? 0x89 : 0x88); Mem (reg, disp);
+}
+
+static void Store32 (int32 disp, int reg)
+{
+	Emit8 (0x41); Emit8 (0x89); Mem (reg, disp);
+}
+
+static void Store64 (int32 disp, int reg)
+{
+	Emit8 (0x49); Emit8 (0x89); Mem (reg, disp);
+}
+
+static void StoreImm8 (int32 disp, uint8 imm)
+{
+	Emit8 (0x41); Emit8 (0xc6); Mem (0, disp); Emit8 (imm);
+}
+
+static void StoreImm16 (int32 disp, uint16 imm)
+{
+	Emit8 (0x66); Emit8 (0x41); Emit8 (0xc7); Mem (0, disp);
+	Emit8 (imm & 0xff); Emit8 (imm >> 8);
+}
+
+static void StoreImm64 (int32 disp, int32 imm)
+{
+	Emit8 (0x49); Emit8 (0xc7); Mem (0, disp); Emit32 (imm);
+}
+
+/* add [disp], reg */
+static void Add32 (int32 disp, int reg)
+{
+	Emit8 (0x41); Emit8 (0x01); Mem (reg, disp);
+}
+
+static void AddImm32 (int32 disp, int32 imm)
+{
+	Emit8 (0x41); Emit8 (0x81); Mem (0, disp); Emit32 (imm);
+}
+
+static void MovImm64 (int reg, uintptr_t imm)
+{
+	Emit8 (0x48); Emit8 (0xb8 + reg); Emit64 (imm);
+}
+
+static void Call (uintptr_t fn)
+{
+	MovImm64 (RAX, fn);
+	Emit8 (0xff); Emit8 (0xd0);			// call rax
+}
+
+/* Forward jumps: the returned rel32 is fixed up by Bind () */
+static uint8 *Jcc (int cc)
+{
+	Emit8 (0x0f); Emit8 (0x80 | cc); Emit32 (0);
+	return CodePtr - 4;
+}
+
+static uint8 *Jmp ()
+{
+	Emit8 (0xe9); Emit32 (0);
+	return CodePtr - 4;
+}
+
+static void Bind (uint8 *rel)
+{
+	int32 d = CodePtr - (rel + 4);
+	memcpy (rel, &d, 4);
+}
+
+/* Adds CPU.MemSpeed or CPU.MemSpeedx2 to CPU.Cycles */
+static void AddMemSpeed (bool8 twice)
+{
+	Load32 (RAX, twice ? DISP (CPU.MemSpeedx2) : DISP (CPU.MemSpeed));
+	Add32 (DISP (CPU.Cycles), RAX);
+}
+
+/* SETZN8 or SETZN16 on the value in eax */
+static void SetZN (bool8 wide)
+{
+	if (wide) {
+		Emit8 (0x89); Emit8 (0xc2);		// mov edx, eax
+		Emit8 (0xc1); Emit8 (0xea); Emit8 (0x08);	// shr edx, 8
+		Store (FALSE, DISP (ICPU._Negative), RDX);
+		Emit8 (0x85); Emit8 (0xc0);		// test eax, eax
+		Emit8 (0x0f); Emit8 (0x95); Emit8 (0xc2);	// setne dl
+		Store (FALSE, DISP (ICPU._Zero), RDX);
+	} else {
+		Store (FALSE, DISP (ICPU._Zero), RAX);
+		Store (FALSE, DISP (ICPU._Negative), RAX);
+	}
+}
+
+static void SetZNImm (bool8 wide, uint16 value)
+{
+	if (wide) {
+		StoreImm8 (DISP (ICPU._Zero), value != 0);
+		StoreImm8 (DISP (ICPU._Negative), value >> 8);
+	} else {
+		StoreImm8 (DISP (ICPU._Zero), value);
+		StoreImm8 (DISP (ICPU._Negative), value);
+	}
+}
+
+/* Leaves the effective address in ecx, as Direct () or Absolute () */
+static void EmitAddress (bool8 direct, uint16 operand)
+{
+	if (direct) {
+		LoadU16 (RCX, DISP (Registers.D.W));
+		Emit8 (0x81); Emit8 (0xc1); Emit32 (operand);	// add ecx, operand
+		Emit8 (0x0f); Emit8 (0xb7); Emit8 (0xc9);		// movzx ecx, cx
+	} else {
+		Load32 (RCX, DISP (ICPU.ShiftedDB));
+		Emit8 (0x81); Emit8 (0xc1); Emit32 (operand);	// add ecx, operand
+	}
+	AddMemSpeed (!direct);
+}
+
+/* edx = memory map block of the address in ecx */
+static void EmitBlockIndex ()
+{
+	Emit8 (0x89); Emit8 (0xca);				// mov edx, ecx
+	Emit8 (0xc1); Emit8 (0xea); Emit8 (MEMMAP_SHIFT);		// shr edx, MEMMAP_SHIFT
+	Emit8 (0x81); Emit8 (0xe2); Emit32 (MEMMAP_MASK);		// and edx, MEMMAP_MASK
+}
+
+/* CPU.Cycles += Memory.MemorySpeed [edx], twice for a word */
+static void EmitBlockCycles (bool8 wide)
+{
+	Emit8 (0x41); Emit8 (0x0f); Emit8 (0xb6);
+	MemIndex (RSI, RDX, 0, DISP (Memory.MemorySpeed));	// movzx esi, MemorySpeed [rdx]
+	if (wide) {
+		Emit8 (0xd1); Emit8 (0xe6);			// shl esi, 1
+	}
+	Add32 (DISP (CPU.Cycles), RSI);
+}
+
+/* eax = S9xGetByte (ecx) or S9xGetWord (ecx) */
+static void EmitRead (bool8 wide, const uint8 *pc)
+{
+	uint8 *slow, *split = NULL, *done;
+
+	if (wide) {
+		// S9xGetWord reads words that end a 8K page byte by byte
+		Emit8 (0x89); Emit8 (0xce);			// mov esi, ecx
+		Emit8 (0x81); Emit8 (0xe6); Emit32 (0x1fff);	// and esi, 0x1fff
+		Emit8 (0x81); Emit8 (0xfe); Emit32 (0x1fff);	// cmp esi, 0x1fff
+		split = Jcc (CC_E);
+	}
+
+	EmitBlockIndex ();
+	Emit8 (0x49); Emit8 (0x8b);
+	MemIndex (RAX, RDX, 3, DISP (Memory.Map));		// mov rax, Map [rdx]
+	Emit8 (0x48); Emit8 (0x83); Emit8 (0xf8); Emit8 (CMemory::MAP_LAST);	// cmp rax, MAP_LAST
+	slow = Jcc (CC_B);
+
+	EmitBlockCycles (wide);
+#ifdef CPU_SHUTDOWN
+	uint8 *rom;
+	Emit8 (0x41); Emit8 (0x80);
+	MemIndex (7, RDX, 0, DISP (Memory.BlockIsRAM)); Emit8 (0);	// cmp BlockIsRAM [rdx], 0
+	rom = Jcc (CC_E);
+	MovImm64 (RSI, (uintptr_t) pc);
+	Store64 (DISP (CPU.WaitAddress), RSI);
+	Bind (rom);
+#endif
+	Emit8 (0x0f); Emit8 (0xb7); Emit8 (0xf1);			// movzx esi, cx
+	Emit8 (0x48); Emit8 (0x01); Emit8 (0xf0);			// add rax, rsi
+	Emit8 (0x0f); Emit8 (wide ? 0xb7 : 0xb6); Emit8 (0x00);	// movzx eax, [rax]
+	done = Jmp ();
+
+	Bind (slow);
+	if (split)
+		Bind (split);
+	Emit8 (0x89); Emit8 (0xcf);				// mov edi, ecx
+	Call (wide ? (uintptr_t) &S9xGetWord : (uintptr_t) &S9xGetByte);
+	Emit8 (0x0f); Emit8 (wide ? 0xb7 : 0xb6); Emit8 (0xc0);	// movzx eax, ax/al
+	Bind (done);
+}
+
+/* S9xSetByte (value, ecx) or S9xSetWord (value, ecx), where value is the
+ * register at disp, or zero if disp is 0 */
+static void EmitWrite (bool8 wide, int32 disp)
+{
+	uint8 *slow, *wrap = NULL, *done;
+#if defined(CPU_SHUTDOWN) && defined(USE_SA1)
+	uint8 *wake1, *wake2, *wake3 = NULL, *wake4 = NULL;
+#endif
+
+#ifdef CPU_SHUTDOWN
+	StoreImm64 (DISP (CPU.WaitAddress), 0);
+#endif
+	EmitBlockIndex ();
+	Emit8 (0x49); Emit8 (0x8b);
+	MemIndex (RAX, RDX, 3, DISP (Memory.WriteMap));	// mov rax, WriteMap [rdx]
+	Emit8 (0x48); Emit8 (0x83); Emit8 (0xf8); Emit8 (CMemory::MAP_LAST);	// cmp rax, MAP_LAST
+	slow = Jcc (CC_B);
+
+	Emit8 (0x0f); Emit8 (0xb7); Emit8 (0xf1);			// movzx esi, cx
+	if (wide) {
+		// The high byte of a word at $xxFFFF wraps around the bank
+		Emit8 (0x81); Emit8 (0xfe); Emit32 (0xffff);	// cmp esi, 0xffff
+		wrap = Jcc (CC_E);
+	}
+	Emit8 (0x48); Emit8 (0x01); Emit8 (0xf0);			// add rax, rsi
+#if defined(CPU_SHUTDOWN) && defined(USE_SA1)
+	// Writes to the bytes a waiting SA-1 polls wake it up
+	Emit8 (0x49); Emit8 (0x3b); Mem (RAX, DISP (SA1.WaitByteAddress1));
+	wake1 = Jcc (CC_E);
+	Emit8 (0x49); Emit8 (0x3b); Mem (RAX, DISP (SA1.WaitByteAddress2));
+	wake2 = Jcc (CC_E);
+	if (wide) {
+		Emit8 (0x48); Emit8 (0x8d); Emit8 (0x70); Emit8 (0x01);	// lea rsi, [rax + 1]
+		Emit8 (0x49); Emit8 (0x3b); Mem (RSI, DISP (SA1.WaitByteAddress1));
+		wake3 = Jcc (CC_E);
+		Emit8 (0x49); Emit8 (0x3b); Mem (RSI, DISP (SA1.WaitByteAddress2));
+		wake4 = Jcc (CC_E);
+	}
+#endif
+
+	EmitBlockCycles (wide);
+	if (disp)
+		Load (wide, RDX, disp);
+	else {
+		Emit8 (0x31); Emit8 (0xd2);			// xor edx, edx
+	}
+	if (wide)
+		Emit8 (0x66);
+	Emit8 (wide ? 0x89 : 0x88); Emit8 (0x10);			// mov [rax], dl/dx
+	done = Jmp ();
+
+	Bind (slow);
+	if (wrap)
+		Bind (wrap);
+#if defined(CPU_SHUTDOWN) && defined(USE_SA1)
+	Bind (wake1);
+	Bind (wake2);
+	if (wide) {
+		Bind (wake3);
+		Bind (wake4);
+	}
+#endif
+	if (disp)
+		Load (wide, RDI, disp);
+	else {
+		Emit8 (0x31); Emit8 (0xff);			// xor edi, edi
+	}
+	Emit8 (0x89); Emit8 (0xce);				// mov esi, ecx
+	Call (wide ? (uintptr_t) &S9xSetWord : (uintptr_t) &S9xSetByte);
+	Bind (done);
+}
+
+/* Emits an opcode inline.
+ * @return FALSE, without emitting anything, if it has to go to its handler. */
+static bool8 EmitOp (uint8 op, const uint8 *pc, int length, bool8 m16, bool8 x16)
+{
+	const int32 a = DISP (Registers.A.W);
+	const int32 x = DISP (Registers.X.W);
+	const int32 y = DISP (Registers.Y.W);
+	uint16 operand = 0;
+	int32 reg, from;
+	bool8 wide;
+
+	if (length == 2)
+		operand = pc [1];
+	else if (length == 3)
+		operand = pc [1] | (pc [2] << 8);
+
+	switch (op) {
+	case 0x18: case 0x38: case 0xb8: case 0xea:	// CLC SEC CLV NOP
+	case 0xe8: case 0xc8: case 0xca: case 0x88:	// INX INY DEX DEY
+	case 0x1a: case 0x3a:				// INC A, DEC A
+	case 0xaa: case 0xa8: case 0x8a: case 0x98:	// TAX TAY TXA TYA
+	case 0xa9: case 0xa2: case 0xa0:		// LDA LDX LDY #
+	case 0xa5: case 0xad: case 0xa6: case 0xae: case 0xa4: case 0xac:
+	case 0x85: case 0x8d: case 0x86: case 0x8e: case 0x84: case 0x8c:
+	case 0x64: case 0x9c:
+		break;
+	default:
+		return FALSE;
+	}
+
+	// Operands are fetched before anything can look at CPU.PC
+	MovImm64 (RAX, (uintptr_t) (pc + length));
+	Store64 (DISP (CPU.PC), RAX);
+
+	switch (op) {
+	case 0x18:
+		StoreImm8 (DISP (ICPU._Carry), 0);
+		AddImm32 (DISP (CPU.Cycles), ONE_CYCLE);
+		break;
+	case 0x38:
+		StoreImm8 (DISP (ICPU._Carry), 1);
+		AddImm32 (DISP (CPU.Cycles), ONE_CYCLE);
+		break;
+	case 0xb8:
+		StoreImm8 (DISP (ICPU._Overflow), 0);
+		AddImm32 (DISP (CPU.Cycles), ONE_CYCLE);
+		break;
+	case 0xea:
+		AddImm32 (DISP (CPU.Cycles), ONE_CYCLE);
+		break;
+
+	case 0xe8: case 0xc8: case 0xca: case 0x88:
+	case 0x1a: case 0x3a:
+		AddImm32 (DISP (CPU.Cycles), ONE_CYCLE);
+#ifdef CPU_SHUTDOWN
+		StoreImm64 (DISP (CPU.WaitAddress), 0);
+#endif
+		reg = (op == 0xe8 || op == 0xca) ? x : (op == 0xc8 || op == 0x88) ? y : a;
+		wide = reg == a ? m16 : x16;
+		Load (wide, RAX, reg);
+		Emit8 (0xff); Emit8 (op == 0xe8 || op == 0xc8 || op == 0x1a ? 0xc0 : 0xc8);	// inc/dec eax
+		Store (wide, reg, RAX);
+		Emit8 (0x0f); Emit8 (wide ? 0xb7 : 0xb6); Emit8 (0xc0);	// movzx eax, ax/al
+		SetZN (wide);
+		break;
+
+	case 0xaa: case 0xa8: case 0x8a: case 0x98:
+		AddImm32 (DISP (CPU.Cycles), ONE_CYCLE);
+		from = op == 0x8a ? x : op == 0x98 ? y : a;
+		reg = op == 0xaa ? x : op == 0xa8 ? y : a;
+		wide = reg == a ? m16 : x16;
+		Load (wide, RAX, from);
+		Store (wide, reg, RAX);
+		SetZN (wide);
+		break;
+
+	case 0xa9: case 0xa2: case 0xa0:
+		reg = op == 0xa9 ? a : op == 0xa2 ? x : y;
+		wide = reg == a ? m16 : x16;
+		AddMemSpeed (wide);
+		if (wide)
+			StoreImm16 (reg, operand);
+		else
+			StoreImm8 (reg, operand);
+		SetZNImm (wide, operand);
+		break;
+
+	case 0xa5: case 0xad: case 0xa6: case 0xae: case 0xa4: case 0xac:
+		reg = (op & 3) == 1 ? a : (op & 3) == 2 ? x : y;
+		wide = reg == a ? m16 : x16;
+		EmitAddress (!(op & 8), operand);
+		EmitRead (wide, pc);
+		Store (wide, reg, RAX);
+		SetZN (wide);
+		break;
+
+	case 0x85: case 0x8d: case 0x86: case 0x8e: case 0x84: case 0x8c:
+		reg = (op & 3) == 1 ? a : (op & 3) == 2 ? x : y;
+		wide = reg == a ? m16 : x16;
+		EmitAddress (!(op & 8), operand);
+		EmitWrite (wide, reg);
+		break;
+
+	case 0x64: case 0x9c:
+		EmitAddress (op == 0x64, operand);
+		EmitWrite (m16, 0);
+		break;
+	}
+
+	return TRUE;
+}
+
+bool8 S9xCPUJitCompile (struct SCPUBlock *block)
+{
+	struct SOpcodes *opcodes = block->Opcodes;
+	bool8 m16 = opcodes == S9xOpcodesM0X1 || opcodes == S9xOpcodesM0X0;
+	bool8 x16 = opcodes == S9xOpcodesM1X0 || opcodes == S9xOpcodesM0X0;
+	uint8 *exits [CPU_BLOCK_MAX_OPS * 2];
+	const uint8 *pc = block->PC;
+	uint8 *code;
+	int i, n = 0;
+
+	// Code in RAM may change under us; leave it to the interpreter
+	if (block->Verify || Disabled)
+		return FALSE;
+	if (!CodeBuffer && !InitBuffer ())
+		return FALSE;
+	if (CodePtr + kMaxBlockCode > CodeBuffer + CPU_JIT_BUFFER_SIZE)
+		S9xCPUJitFlush ();
+
+	code = CodePtr;
+	Emit8 (0x41); Emit8 (0x57);				// push r15
+	Emit8 (0x49); Emit8 (0xbf); Emit64 ((uintptr_t) &CPU);	// mov r15, &CPU
+
+	for (i = 0; i < block->Count; i++) {
+		uint8 op = block->Opcode [i];
+		int length = S9xCPUOpLength (op, opcodes);
+
+		// The per opcode work of RunBlocks
+#ifdef CPU_SHUTDOWN
+		MovImm64 (RAX, (uintptr_t) pc);
+		Store64 (DISP (CPU.PCAtOpcodeStart), RAX);
+#endif
+		Load32 (RAX, DISP (CPU.Cycles));
+		Store32 (DISP (ICPU.OpcodeCycles), RAX);
+		Emit8 (0x41); Emit8 (0x03); Mem (RAX, DISP (CPU.MemSpeed));	// add eax, MemSpeed
+		Store32 (DISP (CPU.Cycles), RAX);
+
+		if (!EmitOp (op, pc, length, m16, x16)) {
+			MovImm64 (RAX, (uintptr_t) (pc + 1));
+			Store64 (DISP (CPU.PC), RAX);
+			Call ((uintptr_t) block->Op [i]);
+		}
+
+#ifdef USE_SA1
+		// Starting or stopping the SA-1 thread flushes the blocks
+		if (SA1.Threaded)
+			Call ((uintptr_t) &S9xSA1ThreadTick);
+		else {
+			uint8 *idle;
+			Emit8 (0x41); Emit8 (0x80); Mem (7, DISP (SA1.Executing)); Emit8 (0);	// cmp SA1.Executing, 0
+			idle = Jcc (CC_E);
+			Call ((uintptr_t) &S9xSA1MainLoop);
+			Bind (idle);
+		}
+#endif
+
+		Emit8 (0x41); Emit8 (0x83); Mem (7, DISP (CPU.Flags)); Emit8 (0);	// cmp CPU.Flags, 0
+		exits [n++] = Jcc (CC_NE);
+		Load32 (RAX, DISP (CPU.Cycles));
+		Emit8 (0x41); Emit8 (0x3b); Mem (RAX, DISP (CPU.NextEvent));	// cmp eax, NextEvent
+		exits [n++] = Jcc (CC_GE);
+
+		pc += length;
+	}
+
+	// Ran to the end: return 0 to go on with the next block
+	Emit8 (0x31); Emit8 (0xc0);				// xor eax, eax
+	Emit8 (0x41); Emit8 (0x5f);				// pop r15
+	Emit8 (0xc3);						// ret
+
+	// Flags or event: return 1 to leave the block loop
+	for (i = 0; i < n; i++)
+		Bind (exits [i]);
+	Emit8 (0xb8); Emit32 (1);					// mov eax, 1
+	Emit8 (0x41); Emit8 (0x5f);				// pop r15
+	Emit8 (0xc3);						// ret
+
+	block->Code = (int (*)()) code;
+	return TRUE;
+}
+
+void S9xCPUJitFlush ()
+{
+	for (int i = 0; i < CPU_BLOCK_CACHE_SIZE; i++) {
+		S9xCPUBlocks [i].Code = NULL;
+		S9xCPUBlocks [i].Hits = 0;
+	}
+	CodePtr = CodeBuffer;
+}
@@ -0,0 +1,28 @@
+#ifndef _CPUJIT_H_
+#define _CPUJIT_H_
+
+#include "snes9x.h"
+#include "cpublocks.h"
+
+/* x86-64 translation of hot pre-decoded blocks.
+ * A block becomes native code once it has run CPU_JIT_THRESHOLD times.
+ * Simple loads, stores, transfers and flag operations are emitted inline;
+ * memory accesses take the Memory.Map/WriteMap fast path and call back into
+ * S9xGetByte and friends for I/O and special areas. Every other opcode is a
+ * direct call to its S9xOpcodes handler. Cycle accounting, event and flag
+ * checks after each opcode are the same as in RunBlocks.
+ * Blocks from writable memory are never translated, so self modifying code
+ * keeps running on the interpreter. */
+
+#define CPU_JIT_THRESHOLD	16
+#define CPU_JIT_BUFFER_SIZE	(4 * 1024 * 1024)
+
+START_EXTERN_C
+/** Translates a block and sets its Code.
+	@return FALSE if the block was left to the interpreter. */
+bool8 S9xCPUJitCompile (struct SCPUBlock *block);
+/** Drops every translation. */
+void S9xCPUJitFlush ();
+END_EXTERN_C
+
+#endif
@@ -49,7 +49,92 @@
     ICPU._Zero = (W); \
     ICPU._Negative = (W);
 
-STATIC INLINE void FASTCALL ADC8 (long OpAddress)
+/* The opcodes that work on the accumulator or an index register come in an
+ * 8 bit and a 16 bit form. Both are written once, as templates on the type of
+ * the register (uint8 or uint16), and each opcode table in 65c816ops.inc
+ * instantiates the widths it runs with. The specialisations below are all
+ * that tells the two forms apart. */
+
+template <class T> STATIC INLINE T GetA ();
+template <> INLINE uint8 GetA<uint8> () { return Registers.AL; }
+template <> INLINE uint16 GetA<uint16> () { return Registers.A.W; }
+template <class T> STATIC INLINE void SetA (T W);
+template <> INLINE void SetA<uint8> (uint8 W) { Registers.AL = W; }
+template <> INLINE void SetA<uint16> (uint16 W) { Registers.A.W = W; }
+
+template <class T> STATIC INLINE T GetX ();
+template <> INLINE uint8 GetX<uint8> () { return Registers.XL; }
+template <> INLINE uint16 GetX<uint16> () { return Registers.X.W; }
+template <class T> STATIC INLINE void SetX (T W);
+template <> INLINE void SetX<uint8> (uint8 W) { Registers.XL = W; }
+template <> INLINE void SetX<uint16> (uint16 W) { Registers.X.W = W; }
+
+template <class T> STATIC INLINE T GetY ();
+template <> INLINE uint8 GetY<uint8> () { return Registers.YL; }
+template <> INLINE uint16 GetY<uint16> () { return Registers.Y.W; }
+template <class T> STATIC INLINE void SetY (T W);
+template <> INLINE void SetY<uint8> (uint8 W) { Registers.YL = W; }
+template <> INLINE void SetY<uint16> (uint16 W) { Registers.Y.W = W; }
+
+template <class T> STATIC INLINE T GetS ();
+template <> INLINE uint8 GetS<uint8> () { return Registers.SL; }
+template <> INLINE uint16 GetS<uint16> () { return Registers.S.W; }
+
+template <class T> STATIC INLINE T GetMem (long Address);
+template <> INLINE uint8 GetMem<uint8> (long Address) { return S9xGetByte (Address); }
+template <> INLINE uint16 GetMem<uint16> (long Address) { return S9xGetWord (Address); }
+
+template <class T> STATIC INLINE void SetMem (T W, long Address);
+template <> INLINE void SetMem<uint8> (uint8 W, long Address) { S9xSetByte (W, Address); }
+template <> INLINE void SetMem<uint16> (uint16 W, long Address) { S9xSetWord (W, Address); }
+
+/* What SETZN8 and SETZN16 store in ICPU._Zero and ICPU._Negative */
+template <class T> STATIC INLINE uint8 ZFlag (T W);
+template <> INLINE uint8 ZFlag<uint8> (uint8 W) { return W; }
+template <> INLINE uint8 ZFlag<uint16> (uint16 W) { return W != 0; }
+
+template <class T> STATIC INLINE uint8 NFlag (T W);
+template <> INLINE uint8 NFlag<uint8> (uint8 W) { return W; }
+template <> INLINE uint8 NFlag<uint16> (uint16 W) { return (uint8) (W >> 8); }
+
+template <class T> STATIC INLINE void SetZN (T W)
+{
+    ICPU._Zero = ZFlag<T> (W);
+    ICPU._Negative = NFlag<T> (W);
+}
+
+template <class T> STATIC INLINE T SignBit ()
+{
+    return (T) ~((T) ~0 >> 1);
+}
+
+/* Reads an immediate operand straight from the opcode stream */
+template <class T> STATIC INLINE T Fetch ();
+
+template <> INLINE uint8 Fetch<uint8> ()
+{
+    uint8 W = *CPU.PC++;
+#ifdef VAR_CYCLES
+    CPU.Cycles += CPU.MemSpeed;
+#endif
+    return W;
+}
+
+template <> INLINE uint16 Fetch<uint16> ()
+{
+    uint16 W = READ_WORD (CPU.PC);
+    CPU.PC += 2;
+#ifdef VAR_CYCLES
+    CPU.Cycles += CPU.MemSpeedx2;
+#endif
+    return W;
+}
+
+/* Decimal mode works digit by digit, so ADC and SBC keep a body per width */
+template <class T> STATIC INLINE void FASTCALL ADC (long OpAddress);
+template <class T> STATIC INLINE void FASTCALL SBC (long OpAddress);
+
+template <> INLINE void FASTCALL ADC<uint8> (long OpAddress)
 {
     uint8 Work8 = S9xGetByte (OpAddress);
     
@@ -104,7 +189,7 @@ STATIC INLINE void FASTCALL ADC8 (long OpAddress)
     }
 }
 
-STATIC INLINE void FASTCALL ADC16 (long OpAddress)
+template <> INLINE void FASTCALL ADC<uint16> (long OpAddress)
 {
     uint16 Work16 = S9xGetWord (OpAddress);
 
@@ -176,440 +261,7 @@ STATIC INLINE void FASTCALL ADC16 (long OpAddress)
     }
 }
 
-STATIC INLINE void FASTCALL AND16 (long OpAddress)
-{
-    Registers.A.W &= S9xGetWord (OpAddress);
-    SETZN16 (Registers.A.W);
-}
-
-STATIC INLINE void FASTCALL AND8 (long OpAddress)
-{
-    Registers.AL &= S9xGetByte (OpAddress);
-    SETZN8 (Registers.AL);
-}
-
-STATIC INLINE void FASTCALL A_ASL16 ()
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-    ICPU._Carry = (Registers.AH & 0x80) != 0;
-    Registers.A.W <<= 1;
-    SETZN16 (Registers.A.W);
-}
-
-STATIC INLINE void FASTCALL A_ASL8 ()
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-    ICPU._Carry = (Registers.AL & 0x80) != 0;
-    Registers.AL <<= 1;
-    SETZN8 (Registers.AL);
-}
-
-STATIC INLINE void FASTCALL ASL16 (long OpAddress)
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-    uint16 Work16 = S9xGetWord (OpAddress);
-    ICPU._Carry = (Work16 & 0x8000) != 0;
-    Work16 <<= 1;
-    S9xSetWord (Work16, OpAddress);
-    SETZN16 (Work16);
-}
-
-STATIC INLINE void FASTCALL ASL8 (long OpAddress)
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-    uint8 Work8 = S9xGetByte (OpAddress);
-    ICPU._Carry = (Work8 & 0x80) != 0;
-    Work8 <<= 1;
-    S9xSetByte (Work8, OpAddress);
-    SETZN8 (Work8);
-}
-
-STATIC INLINE void FASTCALL BIT16 (long OpAddress)
-{
-    uint16 Work16 = S9xGetWord (OpAddress);
-    ICPU._Overflow = (Work16 & 0x4000) != 0;
-    ICPU._Negative = (uint8) (Work16 >> 8);
-    ICPU._Zero = (Work16 & Registers.A.W) != 0;
-}
-
-STATIC INLINE void FASTCALL BIT8 (long OpAddress)
-{
-    uint8 Work8 = S9xGetByte (OpAddress);
-    ICPU._Overflow = (Work8 & 0x40) != 0;
-    ICPU._Negative = Work8;
-    ICPU._Zero = Work8 & Registers.AL;
-}
-
-STATIC INLINE void FASTCALL CMP16 (long OpAddress)
-{
-    int32 Int32 = (long) Registers.A.W -
-	    (long) S9xGetWord (OpAddress);
-    ICPU._Carry = Int32 >= 0;
-    SETZN16 ((uint16) Int32);
-}
-
-STATIC INLINE void FASTCALL CMP8 (long OpAddress)
-{
-    int32 Int32 = (short) Registers.AL -
-	    (short) S9xGetByte (OpAddress);
-    ICPU._Carry = Int32 >= 0;
-    SETZN8 ((uint8) Int32);
-}
-
-STATIC INLINE void FASTCALL CMX16 (long OpAddress)
-{
-    int32 Int32 = (long) Registers.X.W -
-	    (long) S9xGetWord (OpAddress);
-    ICPU._Carry = Int32 >= 0;
-    SETZN16 ((uint16) Int32);
-}
-
-STATIC INLINE void FASTCALL CMX8 (long OpAddress)
-{
-    int32 Int32 = (short) Registers.XL -
-	    (short) S9xGetByte (OpAddress);
-    ICPU._Carry = Int32 >= 0;
-    SETZN8 ((uint8) Int32);
-}
-
-STATIC INLINE void FASTCALL CMY16 (long OpAddress)
-{
-    int32 Int32 = (long) Registers.Y.W -
-	    (long) S9xGetWord (OpAddress);
-    ICPU._Carry = Int32 >= 0;
-    SETZN16 ((uint16) Int32);
-}
-
-STATIC INLINE void FASTCALL CMY8 (long OpAddress)
-{
-    int32 Int32 = (short) Registers.YL -
-	    (short) S9xGetByte (OpAddress);
-    ICPU._Carry = Int32 >= 0;
-    SETZN8 ((uint8) Int32);
-}
-
-STATIC INLINE void FASTCALL A_DEC16 ()
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-#ifdef CPU_SHUTDOWN
-    CPU.WaitAddress = NULL;
-#endif
-
-    Registers.A.W--;
-    SETZN16 (Registers.A.W);
-}
-
-STATIC INLINE void FASTCALL A_DEC8 ()
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-#ifdef CPU_SHUTDOWN
-    CPU.WaitAddress = NULL;
-#endif
-
-    Registers.AL--;
-    SETZN8 (Registers.AL);
-}
-
-STATIC INLINE void FASTCALL DEC16 (long OpAddress)
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-#ifdef CPU_SHUTDOWN
-    CPU.WaitAddress = NULL;
-#endif
-
-    uint16 Work16 = S9xGetWord (OpAddress) - 1;
-    S9xSetWord (Work16, OpAddress);
-    SETZN16 (Work16);
-}
-
-STATIC INLINE void FASTCALL DEC8 (long OpAddress)
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-#ifdef CPU_SHUTDOWN
-    CPU.WaitAddress = NULL;
-#endif
-
-    uint8 Work8 = S9xGetByte (OpAddress) - 1;
-    S9xSetByte (Work8, OpAddress);
-    SETZN8 (Work8);
-}
-
-STATIC INLINE void FASTCALL EOR16 (long OpAddress)
-{
-    Registers.A.W ^= S9xGetWord (OpAddress);
-    SETZN16 (Registers.A.W);
-}
-
-STATIC INLINE void FASTCALL EOR8 (long OpAddress)
-{
-    Registers.AL ^= S9xGetByte (OpAddress);
-    SETZN8 (Registers.AL);
-}
-
-STATIC INLINE void FASTCALL A_INC16 ()
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-#ifdef CPU_SHUTDOWN
-    CPU.WaitAddress = NULL;
-#endif
-
-    Registers.A.W++;
-    SETZN16 (Registers.A.W);
-}
-
-STATIC INLINE void FASTCALL A_INC8 ()
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-#ifdef CPU_SHUTDOWN
-    CPU.WaitAddress = NULL;
-#endif
-
-    Registers.AL++;
-    SETZN8 (Registers.AL);
-}
-
-STATIC INLINE void FASTCALL INC16 (long OpAddress)
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-#ifdef CPU_SHUTDOWN
-    CPU.WaitAddress = NULL;
-#endif
-
-    uint16 Work16 = S9xGetWord (OpAddress) + 1;
-    S9xSetWord (Work16, OpAddress);
-    SETZN16 (Work16);
-}
-
-STATIC INLINE void FASTCALL INC8 (long OpAddress)
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-#ifdef CPU_SHUTDOWN
-    CPU.WaitAddress = NULL;
-#endif
-
-    uint8 Work8 = S9xGetByte (OpAddress) + 1;
-    S9xSetByte (Work8, OpAddress);
-    SETZN8 (Work8);
-}
-
-STATIC INLINE void FASTCALL LDA16 (long OpAddress)
-{
-    Registers.A.W = S9xGetWord (OpAddress);
-    SETZN16 (Registers.A.W);
-}
-
-STATIC INLINE void FASTCALL LDA8 (long OpAddress)
-{
-    Registers.AL = S9xGetByte (OpAddress);
-    SETZN8 (Registers.AL);
-}
-
-STATIC INLINE void FASTCALL LDX16 (long OpAddress)
-{
-    Registers.X.W = S9xGetWord (OpAddress);
-    SETZN16 (Registers.X.W);
-}
-
-STATIC INLINE void FASTCALL LDX8 (long OpAddress)
-{
-    Registers.XL = S9xGetByte (OpAddress);
-    SETZN8 (Registers.XL);
-}
-
-STATIC INLINE void FASTCALL LDY16 (long OpAddress)
-{
-    Registers.Y.W = S9xGetWord (OpAddress);
-    SETZN16 (Registers.Y.W);
-}
-
-STATIC INLINE void FASTCALL LDY8 (long OpAddress)
-{
-    Registers.YL = S9xGetByte (OpAddress);
-    SETZN8 (Registers.YL);
-}
-
-STATIC INLINE void FASTCALL A_LSR16 ()
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-    ICPU._Carry = Registers.AL & 1;
-    Registers.A.W >>= 1;
-    SETZN16 (Registers.A.W);
-}
-
-STATIC INLINE void FASTCALL A_LSR8 ()
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-    ICPU._Carry = Registers.AL & 1;
-    Registers.AL >>= 1;
-    SETZN8 (Registers.AL);
-}
-
-STATIC INLINE void FASTCALL LSR16 (long OpAddress)
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-    uint16 Work16 = S9xGetWord (OpAddress);
-    ICPU._Carry = Work16 & 1;
-    Work16 >>= 1;
-    S9xSetWord (Work16, OpAddress);
-    SETZN16 (Work16);
-}
-
-STATIC INLINE void FASTCALL LSR8 (long OpAddress)
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-    uint8 Work8 = S9xGetByte (OpAddress);
-    ICPU._Carry = Work8 & 1;
-    Work8 >>= 1;
-    S9xSetByte (Work8, OpAddress);
-    SETZN8 (Work8);
-}
-
-STATIC INLINE void FASTCALL ORA16 (long OpAddress)
-{
-    Registers.A.W |= S9xGetWord (OpAddress);
-    SETZN16 (Registers.A.W);
-}
-
-STATIC INLINE void FASTCALL ORA8 (long OpAddress)
-{
-    Registers.AL |= S9xGetByte (OpAddress);
-    SETZN8 (Registers.AL);
-}
-
-STATIC INLINE void FASTCALL A_ROL16 ()
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-    uint32 Work32 = (Registers.A.W << 1) | CheckCarry();
-    ICPU._Carry = Work32 >= 0x10000;
-    Registers.A.W = (uint16) Work32;
-    SETZN16 ((uint16) Work32);
-}
-
-STATIC INLINE void FASTCALL A_ROL8 ()
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-    uint16 Work16 = Registers.AL;
-    Work16 <<= 1;
-    Work16 |= CheckCarry();
-    ICPU._Carry = Work16 >= 0x100;
-    Registers.AL = (uint8) Work16;
-    SETZN8 ((uint8) Work16);
-}
-
-STATIC INLINE void FASTCALL ROL16 (long OpAddress)
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-    uint32 Work32 = S9xGetWord (OpAddress);
-    Work32 <<= 1;
-    Work32 |= CheckCarry();
-    ICPU._Carry = Work32 >= 0x10000;
-    S9xSetWord ((uint16) Work32, OpAddress);
-    SETZN16 ((uint16) Work32);
-}
-
-STATIC INLINE void FASTCALL ROL8 (long OpAddress)
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-    uint16 Work16 = S9xGetByte (OpAddress);
-    Work16 <<= 1;
-    Work16 |= CheckCarry ();
-    ICPU._Carry = Work16 >= 0x100;
-    S9xSetByte ((uint8) Work16, OpAddress);
-    SETZN8 ((uint8) Work16);
-}
-
-STATIC INLINE void FASTCALL A_ROR16 ()
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-    uint32 Work32 = Registers.A.W;
-    Work32 |= (int) CheckCarry() << 16;
-    ICPU._Carry = (uint8) (Work32 & 1);
-    Work32 >>= 1;
-    Registers.A.W = (uint16) Work32;
-    SETZN16 ((uint16) Work32);
-}
-
-STATIC INLINE void FASTCALL A_ROR8 ()
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-    uint16 Work16 = Registers.AL | ((uint16) CheckCarry() << 8);
-    ICPU._Carry = (uint8) Work16 & 1;
-    Work16 >>= 1;
-    Registers.AL = (uint8) Work16;
-    SETZN8 ((uint8) Work16);
-}
-
-STATIC INLINE void FASTCALL ROR16 (long OpAddress)
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-    uint32 Work32 = S9xGetWord (OpAddress);
-    Work32 |= (int) CheckCarry() << 16;
-    ICPU._Carry = (uint8) (Work32 & 1);
-    Work32 >>= 1;
-    S9xSetWord ((uint16) Work32, OpAddress);
-    SETZN16 ((uint16) Work32);
-}
-
-STATIC INLINE void FASTCALL ROR8 (long OpAddress)
-{
-#ifdef VAR_CYCLES
-    CPU.Cycles += ONE_CYCLE;
-#endif
-    uint16 Work16 = S9xGetByte (OpAddress);
-    Work16 |= (int) CheckCarry () << 8;
-    ICPU._Carry = (uint8) (Work16 & 1);
-    Work16 >>= 1;
-    S9xSetByte ((uint8) Work16, OpAddress);
-    SETZN8 ((uint8) Work16);
-}
-
-STATIC INLINE void FASTCALL SBC16 (long OpAddress)
+template <> INLINE void FASTCALL SBC<uint16> (long OpAddress)
 {
     uint16 Work16 = S9xGetWord (OpAddress);
 
@@ -679,7 +331,7 @@ STATIC INLINE void FASTCALL SBC16 (long OpAddress)
     }
 }
 
-STATIC INLINE void FASTCALL SBC8 (long OpAddress)
+template <> INLINE void FASTCALL SBC<uint8> (long OpAddress)
 {
     uint8 Work8 = S9xGetByte (OpAddress);
     if (CheckDecimal())
@@ -730,87 +382,255 @@ STATIC INLINE void FASTCALL SBC8 (long OpAddress)
     }
 }
 
-STATIC INLINE void FASTCALL STA16 (long OpAddress)
+template <class T> STATIC INLINE void FASTCALL AND (long OpAddress)
+{
+    SetA<T> (GetA<T> () & GetMem<T> (OpAddress));
+    SetZN<T> (GetA<T> ());
+}
+
+template <class T> STATIC INLINE void FASTCALL EOR (long OpAddress)
+{
+    SetA<T> (GetA<T> () ^ GetMem<T> (OpAddress));
+    SetZN<T> (GetA<T> ());
+}
+
+template <class T> STATIC INLINE void FASTCALL ORA (long OpAddress)
+{
+    SetA<T> (GetA<T> () | GetMem<T> (OpAddress));
+    SetZN<T> (GetA<T> ());
+}
+
+template <class T> STATIC INLINE void FASTCALL A_ASL ()
+{
+#ifdef VAR_CYCLES
+    CPU.Cycles += ONE_CYCLE;
+#endif
+    ICPU._Carry = (GetA<T> () & SignBit<T> ()) != 0;
+    SetA<T> (GetA<T> () << 1);
+    SetZN<T> (GetA<T> ());
+}
+
+template <class T> STATIC INLINE void FASTCALL ASL (long OpAddress)
 {
-    S9xSetWord (Registers.A.W, OpAddress);
+#ifdef VAR_CYCLES
+    CPU.Cycles += ONE_CYCLE;
+#endif
+    T Work = GetMem<T> (OpAddress);
+    ICPU._Carry = (Work & SignBit<T> ()) != 0;
+    Work <<= 1;
+    SetMem<T> (Work, OpAddress);
+    SetZN<T> (Work);
 }
 
-STATIC INLINE void FASTCALL STA8 (long OpAddress)
+template <class T> STATIC INLINE void FASTCALL BIT (long OpAddress)
 {
-    S9xSetByte (Registers.AL, OpAddress);
+    T Work = GetMem<T> (OpAddress);
+    ICPU._Overflow = (Work & (SignBit<T> () >> 1)) != 0;
+    ICPU._Negative = NFlag<T> (Work);
+    ICPU._Zero = ZFlag<T> (Work & GetA<T> ());
 }
 
-STATIC INLINE void FASTCALL STX16 (long OpAddress)
+template <class T> STATIC INLINE void Compare (T Reg, T W)
 {
-    S9xSetWord (Registers.X.W, OpAddress);
+    int32 Int32 = (int32) Reg - (int32) W;
+    ICPU._Carry = Int32 >= 0;
+    SetZN<T> ((T) Int32);
 }
 
-STATIC INLINE void FASTCALL STX8 (long OpAddress)
+template <class T> STATIC INLINE void FASTCALL CMP (long OpAddress)
 {
-    S9xSetByte (Registers.XL, OpAddress);
+    Compare<T> (GetA<T> (), GetMem<T> (OpAddress));
 }
 
-STATIC INLINE void FASTCALL STY16 (long OpAddress)
+template <class T> STATIC INLINE void FASTCALL CMX (long OpAddress)
 {
-    S9xSetWord (Registers.Y.W, OpAddress);
+    Compare<T> (GetX<T> (), GetMem<T> (OpAddress));
 }
 
-STATIC INLINE void FASTCALL STY8 (long OpAddress)
+template <class T> STATIC INLINE void FASTCALL CMY (long OpAddress)
 {
-    S9xSetByte (Registers.YL, OpAddress);
+    Compare<T> (GetY<T> (), GetMem<T> (OpAddress));
 }
 
-STATIC INLINE void FASTCALL STZ16 (long OpAddress)
+template <class T> STATIC INLINE void FASTCALL A_DEC ()
 {
-    S9xSetWord (0, OpAddress);
+#ifdef VAR_CYCLES
+    CPU.Cycles += ONE_CYCLE;
+#endif
+#ifdef CPU_SHUTDOWN
+    CPU.WaitAddress = NULL;
+#endif
+
+    SetA<T> (GetA<T> () - 1);
+    SetZN<T> (GetA<T> ());
 }
 
-STATIC INLINE void FASTCALL STZ8 (long OpAddress)
+template <class T> STATIC INLINE void FASTCALL DEC (long OpAddress)
 {
-    S9xSetByte (0, OpAddress);
+#ifdef VAR_CYCLES
+    CPU.Cycles += ONE_CYCLE;
+#endif
+#ifdef CPU_SHUTDOWN
+    CPU.WaitAddress = NULL;
+#endif
+
+    T Work = GetMem<T> (OpAddress) - 1;
+    SetMem<T> (Work, OpAddress);
+    SetZN<T> (Work);
 }
 
-STATIC INLINE void FASTCALL TSB16 (long OpAddress)
+template <class T> STATIC INLINE void FASTCALL A_INC ()
 {
 #ifdef VAR_CYCLES
     CPU.Cycles += ONE_CYCLE;
 #endif
-    uint16 Work16 = S9xGetWord (OpAddress);
-    ICPU._Zero = (Work16 & Registers.A.W) != 0;
-    Work16 |= Registers.A.W;
-    S9xSetWord (Work16, OpAddress);
+#ifdef CPU_SHUTDOWN
+    CPU.WaitAddress = NULL;
+#endif
+
+    SetA<T> (GetA<T> () + 1);
+    SetZN<T> (GetA<T> ());
 }
 
-STATIC INLINE void FASTCALL TSB8 (long OpAddress)
+template <class T> STATIC INLINE void FASTCALL INC (long OpAddress)
 {
 #ifdef VAR_CYCLES
     CPU.Cycles += ONE_CYCLE;
 #endif
-    uint8 Work8 = S9xGetByte (OpAddress);
-    ICPU._Zero = Work8 & Registers.AL;
-    Work8 |= Registers.AL;
-    S9xSetByte (Work8, OpAddress);
+#ifdef CPU_SHUTDOWN
+    CPU.WaitAddress = NULL;
+#endif
+
+    T Work = GetMem<T> (OpAddress) + 1;
+    SetMem<T> (Work, OpAddress);
+    SetZN<T> (Work);
+}
+
+template <class T> STATIC INLINE void FASTCALL LDA (long OpAddress)
+{
+    SetA<T> (GetMem<T> (OpAddress));
+    SetZN<T> (GetA<T> ());
+}
+
+template <class T> STATIC INLINE void FASTCALL LDX (long OpAddress)
+{
+    SetX<T> (GetMem<T> (OpAddress));
+    SetZN<T> (GetX<T> ());
+}
+
+template <class T> STATIC INLINE void FASTCALL LDY (long OpAddress)
+{
+    SetY<T> (GetMem<T> (OpAddress));
+    SetZN<T> (GetY<T> ());
 }
 
-STATIC INLINE void FASTCALL TRB16 (long OpAddress)
+template <class T> STATIC INLINE void FASTCALL A_LSR ()
 {
 #ifdef VAR_CYCLES
     CPU.Cycles += ONE_CYCLE;
 #endif
-    uint16 Work16 = S9xGetWord (OpAddress);
-    ICPU._Zero = (Work16 & Registers.A.W) != 0;
-    Work16 &= ~Registers.A.W;
-    S9xSetWord (Work16, OpAddress);
+    ICPU._Carry = Registers.AL & 1;
+    SetA<T> (GetA<T> () >> 1);
+    SetZN<T> (GetA<T> ());
 }
 
-STATIC INLINE void FASTCALL TRB8 (long OpAddress)
+template <class T> STATIC INLINE void FASTCALL LSR (long OpAddress)
 {
 #ifdef VAR_CYCLES
     CPU.Cycles += ONE_CYCLE;
 #endif
-    uint8 Work8 = S9xGetByte (OpAddress);
-    ICPU._Zero = Work8 & Registers.AL;
-    Work8 &= ~Registers.AL;
-    S9xSetByte (Work8, OpAddress);
+    T Work = GetMem<T> (OpAddress);
+    ICPU._Carry = Work & 1;
+    Work >>= 1;
+    SetMem<T> (Work, OpAddress);
+    SetZN<T> (Work);
+}
+
+template <class T> STATIC INLINE void FASTCALL A_ROL ()
+{
+#ifdef VAR_CYCLES
+    CPU.Cycles += ONE_CYCLE;
+#endif
+    uint32 Work32 = ((uint32) GetA<T> () << 1) | CheckCarry ();
+    ICPU._Carry = (uint8) (Work32 >> (sizeof (T) * 8));
+    SetA<T> ((T) Work32);
+    SetZN<T> ((T) Work32);
+}
+
+template <class T> STATIC INLINE void FASTCALL ROL (long OpAddress)
+{
+#ifdef VAR_CYCLES
+    CPU.Cycles += ONE_CYCLE;
+#endif
+    uint32 Work32 = ((uint32) GetMem<T> (OpAddress) << 1) | CheckCarry ();
+    ICPU._Carry = (uint8) (Work32 >> (sizeof (T) * 8));
+    SetMem<T> ((T) Work32, OpAddress);
+    SetZN<T> ((T) Work32);
+}
+
+template <class T> STATIC INLINE void FASTCALL A_ROR ()
+{
+#ifdef VAR_CYCLES
+    CPU.Cycles += ONE_CYCLE;
+#endif
+    uint32 Work32 = GetA<T> () | ((uint32) CheckCarry () << (sizeof (T) * 8));
+    ICPU._Carry = (uint8) (Work32 & 1);
+    Work32 >>= 1;
+    SetA<T> ((T) Work32);
+    SetZN<T> ((T) Work32);
+}
+
+template <class T> STATIC INLINE void FASTCALL ROR (long OpAddress)
+{
+#ifdef VAR_CYCLES
+    CPU.Cycles += ONE_CYCLE;
+#endif
+    uint32 Work32 = GetMem<T> (OpAddress) | ((uint32) CheckCarry () << (sizeof (T) * 8));
+    ICPU._Carry = (uint8) (Work32 & 1);
+    Work32 >>= 1;
+    SetMem<T> ((T) Work32, OpAddress);
+    SetZN<T> ((T) Work32);
+}
+
+template <class T> STATIC INLINE void FASTCALL STA (long OpAddress)
+{
+    SetMem<T> (GetA<T> (), OpAddress);
+}
+
+template <class T> STATIC INLINE void FASTCALL STX (long OpAddress)
+{
+    SetMem<T> (GetX<T> (), OpAddress);
+}
+
+template <class T> STATIC INLINE void FASTCALL STY (long OpAddress)
+{
+    SetMem<T> (GetY<T> (), OpAddress);
+}
+
+template <class T> STATIC INLINE void FASTCALL STZ (long OpAddress)
+{
+    SetMem<T> (0, OpAddress);
+}
+
+template <class T> STATIC INLINE void FASTCALL TSB (long OpAddress)
+{
+#ifdef VAR_CYCLES
+    CPU.Cycles += ONE_CYCLE;
+#endif
+    T Work = GetMem<T> (OpAddress);
+    ICPU._Zero = ZFlag<T> (Work & GetA<T> ());
+    Work |= GetA<T> ();
+    SetMem<T> (Work, OpAddress);
+}
+
+template <class T> STATIC INLINE void FASTCALL TRB (long OpAddress)
+{
+#ifdef VAR_CYCLES
+    CPU.Cycles += ONE_CYCLE;
+#endif
+    T Work = GetMem<T> (OpAddress);
+    ICPU._Zero = ZFlag<T> (Work & GetA<T> ());
+    Work &= ~GetA<T> ();
+    SetMem<T> (Work, OpAddress);
 }
 #endif
@@ -47,6 +47,7 @@
 #include "dma.h"
 #include "apu.h"
 #include "gfx.h"
+#include "profile.h"
 #ifdef USE_SA1
 #include "sa1.h"
 #endif
@@ -67,6 +68,143 @@ static int S9xCompareSDD1IndexEntries (const void *p1, const void *p2)
 }
 #endif
 
+/* A linear VRAM DMA stepping the address a word at a time writes the words
+ * from where it started to where it leaves the address, so their tiles are
+ * invalidated in one go once it is done. */
+static inline void InvalidateVRAM (uint16 start, int bytes)
+{
+    uint32 words = (uint16) (PPU.VMA.Address - start) + 1;
+    S9xInvalidateTiles (start << 1, bytes >= 0x10000 ? 0x10000 : words << 1);
+}
+
+/* Block versions of the common A-bus to B-bus transfers. Each makes the
+ * same changes as the register writes it replaces would, byte by byte, for
+ * count bytes at src that do not wrap around the A-bus bank. */
+
+// Mode 1 to $2118/$2119, linear, stepping a word after each $2119 write
+static void DMAToVRAM (uint8 *src, int count)
+{
+    uint32 address = (PPU.VMA.Address << 1) & 0xffff;
+    int n = count;
+
+    if (address + n > 0x10000)
+    {
+	memcpy (&Memory.VRAM [address], src, 0x10000 - address);
+	src += 0x10000 - address;
+	n -= 0x10000 - address;
+	S9xInvalidateTiles (address, 0x10000 - address);
+	address = 0;
+    }
+    memcpy (&Memory.VRAM [address], src, n);
+    S9xInvalidateTiles (address, n);
+    PPU.VMA.Address += count >> 1;
+}
+
+// $2122, a colour (two bytes) at a time
+static void DMAToCGRAM (uint8 *src, int count)
+{
+    if (PPU.CGFLIP)
+    {
+	REGISTER_2122 (*src++);
+	count--;
+    }
+    for ( ; count > 1; count -= 2, src += 2)
+    {
+	uint16 old = PPU.CGDATA [PPU.CGADD];
+	uint16 colour = src [0] | ((src [1] & 0x7f) << 8);
+
+	if (colour != old)
+	{
+	    if (!(Settings.os9x_hack & PPU_IGNORE_PALWRITE))
+		FLUSH_REDRAW ();
+	    PPU.CGDATA [PPU.CGADD] = colour;
+	    IPPU.ColorsChanged = TRUE;
+	    if ((colour ^ old) & 0xff)
+		IPPU.Red [PPU.CGADD] = IPPU.XB [colour & 0x1f];
+	    if ((colour ^ old) & 0xff00)
+		IPPU.Blue [PPU.CGADD] = IPPU.XB [(colour >> 10) & 0x1f];
+	    IPPU.Green [PPU.CGADD] = IPPU.XB [(colour >> 5) & 0x1f];
+	    IPPU.ScreenColors [PPU.CGADD] = (uint16) BUILD_PIXEL (IPPU.Red [PPU.CGADD],
+								  IPPU.Green [PPU.CGADD],
+								  IPPU.Blue [PPU.CGADD]);
+	}
+	PPU.CGADD++;
+    }
+    if (count)
+	REGISTER_2122 (*src);
+}
+
+// Rebuilds sprite i from its OAM bytes, as $2104 writes leave it
+static void DecodeOBJ (int i)
+{
+    struct SOBJ *pObj = &PPU.OBJ [i];
+    uint8 *o = &PPU.OAMData [i << 2];
+    uint8 high = PPU.OAMData [0x200 + (i >> 2)] >> ((i & 3) << 1);
+
+    pObj->HPos = o [0] | SignExtend [high & 1];
+    pObj->VPos = o [1];
+    pObj->Name = o [2] | ((uint16) (o [3] & 1) << 8);
+    pObj->Palette = (o [3] >> 1) & 7;
+    pObj->Priority = (o [3] >> 4) & 3;
+    pObj->HFlip = (o [3] >> 6) & 1;
+    pObj->VFlip = (o [3] >> 7) & 1;
+    pObj->Size = PPU.OAMData [0x200 + (i >> 2)] & (2 << ((i & 3) << 1));
+}
+
+// $2104: the bytes up to the end of OAM, where the writes stop taking
+static void DMAToOAM (uint8 *src, int count)
+{
+    int start, end, i;
+
+    if (PPU.OAMAddr >= 0x110)
+	return;
+
+    start = (PPU.OAMAddr << 1) + (PPU.OAMFlip & 1);
+    end = start + count;
+    if (end > 0x220)
+	end = 0x220;
+
+    if (memcmp (&PPU.OAMData [start], src, end - start))
+    {
+	FLUSH_REDRAW ();
+	memcpy (&PPU.OAMData [start], src, end - start);
+	IPPU.OBJChanged = TRUE;
+
+	if (start < 0x200)
+	    for (i = start >> 2; i <= ((end < 0x200 ? end : 0x200) - 1) >> 2; i++)
+		DecodeOBJ (i);
+	if (end > 0x200)
+	    for (i = ((start > 0x200 ? start : 0x200) & 0x1f) << 2; i < ((end - 0x200) << 2); i++)
+		DecodeOBJ (i);
+    }
+
+    Memory.FillRAM [0x2104] = src [end - start - 1];
+    PPU.OAMAddr = end >> 1;
+    PPU.OAMFlip = (PPU.OAMFlip & ~1) | (end & 1);
+}
+
+// $2180, unless the source is the WRAM the bytes go to
+static bool8 DMAToWRAM (uint8 *src, int count)
+{
+    uint32 address = PPU.WRAM;
+    int n = count;
+
+    if (src < Memory.RAM + 0x20000 && src + count > Memory.RAM)
+	return FALSE;
+
+    if (address + n > 0x20000)
+    {
+	memcpy (&Memory.RAM [address], src, 0x20000 - address);
+	src += 0x20000 - address;
+	n -= 0x20000 - address;
+	address = 0;
+    }
+    memcpy (&Memory.RAM [address], src, n);
+    PPU.WRAM = (address + n) & 0x1ffff;
+    Memory.FillRAM [0x2180] = src [n - 1];
+    return TRUE;
+}
+
 /**********************************************************************************************/
 /* S9xDoDMA()                                                                                   */
 /* This function preforms the general dma transfer                                            */
@@ -78,6 +216,25 @@ void S9xDoDMA (uint8 Channel)
     if (Channel > 7 || CPU.InDMA)
 	return;
 
+#ifdef USE_SA1
+    // The SA-1 may own the source, or be converting characters into it
+    S9xSA1Sync ();
+#ifdef CPU_SHUTDOWN
+    // DMA writes skip the checks that wake a polling SA-1 up
+    if (SA1.WaitByteAddress1)
+    {
+	if (!SA1.Executing && !SA1.Waiting)
+	    SA1.Executing = SA1.S9xOpcodes != NULL;
+	SA1.WaitCounter = 0;
+    }
+#endif
+#endif
+#ifdef SUPER_FX
+    // The GSU may be drawing into the source
+    if (Settings.SuperFX)
+	S9xSuperFXSync ();
+#endif
+    PROFILE_ENTER(PROFILE_DMA);
     CPU.InDMA = TRUE;
     bool8 in_sa1_dma = FALSE;
     uint8 *in_sdd1_dma = NULL;
@@ -351,11 +508,19 @@ void S9xDoDMA (uint8 Channel)
 	if (inc < 0)
 	    d->AAddress -= count;
 
+	// Whether the common transfers can be made a block at a time
+	bool8 block = inc > 0 && p + count <= 0x10000;
+
 	if (d->TransferMode == 0 || d->TransferMode == 2)
 	{
 	    switch (d->BAddress)
 	    {
 	    case 0x04:
+		if (block)
+		{
+		    DMAToOAM (base + p, count);
+		    break;
+		}
 		do
 		{
 		    Work = *(base + p);
@@ -366,6 +531,20 @@ void S9xDoDMA (uint8 Channel)
 		break;
 	    case 0x18:
 		IPPU.FirstVRAMRead = TRUE;
+		if (!PPU.VMA.FullGraphicCount && PPU.VMA.Increment == 1)
+		{
+		    uint16 start = PPU.VMA.Address;
+		    int bytes = count;
+		    do
+		    {
+			Work = *(base + p);
+			REGISTER_2118_dma(Work);
+			p += inc;
+			CHECK_SOUND();
+		    } while (--count > 0);
+		    InvalidateVRAM (start, bytes);
+		}
+		else
 		if (!PPU.VMA.FullGraphicCount)
 		{
 		    do
@@ -389,6 +568,20 @@ void S9xDoDMA (uint8 Channel)
 		break;
 	    case 0x19:
 		IPPU.FirstVRAMRead = TRUE;
+		if (!PPU.VMA.FullGraphicCount && PPU.VMA.Increment == 1)
+		{
+		    uint16 start = PPU.VMA.Address;
+		    int bytes = count;
+		    do
+		    {
+			Work = *(base + p);
+			REGISTER_2119_dma(Work);
+			p += inc;
+			CHECK_SOUND();
+		    } while (--count > 0);
+		    InvalidateVRAM (start, bytes);
+		}
+		else
 		if (!PPU.VMA.FullGraphicCount)
 		{
 		    do
@@ -411,6 +604,11 @@ void S9xDoDMA (uint8 Channel)
 		}
 		break;
 	    case 0x22:
+		if (block)
+		{
+		    DMAToCGRAM (base + p, count);
+		    break;
+		}
 		do
 		{
 		    Work = *(base + p);
@@ -420,6 +618,8 @@ void S9xDoDMA (uint8 Channel)
 		} while (--count > 0);
 		break;
 	    case 0x80:
+		if (block && DMAToWRAM (base + p, count))
+		    break;
 		do
 		{
 		    Work = *(base + p);
@@ -446,6 +646,35 @@ void S9xDoDMA (uint8 Channel)
 	    {
 		// Write to V-RAM
 		IPPU.FirstVRAMRead = TRUE;
+		if (!PPU.VMA.FullGraphicCount && PPU.VMA.Increment == 1 &&
+		    PPU.VMA.High && block)
+		    DMAToVRAM (base + p, count);
+		else
+		if (!PPU.VMA.FullGraphicCount && PPU.VMA.Increment == 1)
+		{
+		    uint16 start = PPU.VMA.Address;
+		    int bytes = count;
+		    while (count > 1)
+		    {
+			Work = *(base + p);
+			REGISTER_2118_dma(Work);
+			p += inc;
+
+			Work = *(base + p);
+			REGISTER_2119_dma(Work);
+			p += inc;
+			CHECK_SOUND();
+			count -= 2;
+		    }
+		    if (count == 1)
+		    {
+			Work = *(base + p);
+			REGISTER_2118_dma(Work);
+			p += inc;
+		    }
+		    InvalidateVRAM (start, bytes);
+		}
+		else
 		if (!PPU.VMA.FullGraphicCount)
 		{
 		    while (count > 1)
@@ -713,6 +942,7 @@ void S9xDoDMA (uint8 Channel)
     d->TransferBytes = 0;
     
     CPU.InDMA = FALSE;
+    PROFILE_LEAVE();
 }
 
 void S9xStartHDMA ()
@@ -744,10 +974,20 @@ void S9xTraceSoundDSP (const char *s, int i1 = 0, int i2 = 0, int i3 = 0,
 
 uint8 S9xDoHDMA (uint8 byte)
 {
+    PROFILE_ENTER(PROFILE_DMA);
     struct SDMA *p = &DMA [0];
     
     int d = 0;
 
+#ifdef USE_SA1
+    // HDMA tables in I-RAM or BW-RAM are read through cached pointers
+    S9xSA1Sync ();
+#endif
+#ifdef SUPER_FX
+    if (Settings.SuperFX)
+	S9xSuperFXSync ();
+#endif
+
     for (uint8 mask = 1; mask; mask <<= 1, p++, d++)
     {
 	if (byte & mask)
@@ -892,6 +1132,7 @@ uint8 S9xDoHDMA (uint8 byte)
 	    p->LineCount--;
 	}
     }
+    PROFILE_LEAVE();
     return (byte);
 }
 
@@ -518,6 +518,8 @@ void FxReset(struct FxInit_s *psFxInfo)
     /* Set pointer to GSU cache */
     GSU.pvCache = &GSU.pvRegisters[0x100];
 
+    fx_flushDecoded();
+
     fx_readRegisterSpace();
 }
 
@@ -71,6 +71,7 @@ struct FxInit_s
     uint8 *	pvRam;		/* Pointer to GSU-RAM */
     uint32	nRomBanks;	/* Number of 32kb-banks in Cart-ROM */
     uint8 *	pvRom;		/* Pointer to Cart-ROM */
+    uint32	speedPerLine;	/* GSU instructions per scanline at 10.74 MHz */
 };
 
 /* Reset the FxChip */
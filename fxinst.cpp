@@ -42,8 +42,12 @@
 
 #include "fxemu.h"
 #include "fxinst.h"
+#include <stdint.h>
 #include <string.h>
 #include <stdio.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 extern struct FxRegs_s GSU;
 int gsu_bank [512] = {0};
@@ -63,6 +67,203 @@ int gsu_bank [512] = {0};
  *
  */
 
+/*** Pre-decoded prefix sequences ***/
+
+/* Most GSU instructions that name registers or use the ALT tables are led
+ * by one or more of the prefixes alt1-3, to, with and from, each of which
+ * costs a dispatch of its own. A run of prefixes that starts from the clean
+ * state (no ALT or B flag, r0 as source and destination) always leaves the
+ * same flags and registers behind, so it is decoded once, keyed by the ROM
+ * address it starts at, and later applied at once by its first prefix,
+ * which then dispatches the instruction that ends it. Only ROM is decoded:
+ * the GSU fetches straight from the program bank, so its cache RAM is never
+ * seen here, and code in the RAM banks 70-73 runs undecoded.
+ * The instruction count is kept as if each prefix was stepped, so a slice
+ * ends on the same instruction it did before. */
+
+#define FX_DECODE_SIZE		1024
+#define FX_DECODE_PREFIXES	8
+
+struct FxDecoded
+{
+    const uint8 *pvPc;		/* &PRGBANK(R15) with the first prefix in PIPE */
+    uint8 vPrefix;		/* The first prefix */
+    uint8 vPrefixes;		/* Opcodes applied at once, the first included */
+    uint8 vLast;		/* The opcode ending the run */
+    uint8 vSreg;
+    uint8 vDreg;
+    uint16 vFlags;		/* ALT1/ALT2/B as the run leaves them */
+};
+
+static struct FxDecoded fx_avDecoded[FX_DECODE_SIZE];
+
+/* Prefixes, with bit 1 set for from and to, which mean move(s) after with */
+static const uint8 fx_avPrefix[256] = {
+    /* 00 - 0f */ 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    /* 10 - 1f */ 3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,
+    /* 20 - 2f */ 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    /* 30 - 3f */ 0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,
+    /* 40 - af */ 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+		  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+		  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+		  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+		  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+		  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+		  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    /* b0 - bf */ 3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,
+    /* c0 - ff */ 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+		  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+		  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+		  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+};
+
+void fx_flushDecoded()
+{
+    memset(fx_avDecoded, 0, sizeof(fx_avDecoded));
+}
+
+static void fx_decode(struct FxDecoded *pd, const uint8 *pvPc, uint8 vPrefix)
+{
+    uint32 vAvail = 0x10000 - USEX16(R15);
+    uint32 vSreg = 0, vDreg = 0, vFlags = 0;
+    uint32 n = 0;
+    uint8 v = vPrefix;
+
+    pd->pvPc = pvPc;
+    pd->vPrefix = vPrefix;
+
+    /* The run ends within the bank, where R15 wraps */
+    for(;;)
+    {
+	switch(v & 0xf0)
+	{
+	case 0x30:
+	    vFlags = (vFlags & ~FLG_B) | ((v & 3) << 8);
+	    break;
+	case 0x20:
+	    vFlags |= FLG_B;
+	    vSreg = vDreg = v & 0xf;
+	    break;
+	case 0x10:
+	    vDreg = v & 0xf;
+	    break;
+	case 0xb0:
+	    vSreg = v & 0xf;
+	    break;
+	}
+	v = pvPc[n++];
+	if(n >= vAvail || n >= FX_DECODE_PREFIXES || !fx_avPrefix[v] ||
+	   ((fx_avPrefix[v] & 2) && (vFlags & FLG_B)))
+	    break;
+    }
+
+    pd->vPrefixes = n;
+    pd->vLast = v;
+    pd->vSreg = vSreg;
+    pd->vDreg = vDreg;
+    pd->vFlags = vFlags;
+}
+
+/* Called by a prefix handler when another prefix follows it. Applies the
+ * whole run and executes the instruction ending it, if the run starts from
+ * the clean state and fits in the slice. */
+static bool8 fx_runPrefixes(uint8 vPrefix)
+{
+    const uint8 *pvPc;
+    struct FxDecoded *pd;
+
+    if((SFR & (FLG_ALT1|FLG_ALT2|FLG_B)) || GSU.pvSreg != &R0 ||
+       GSU.pvDreg != &R0 || (PBR & 0xfc) == 0x70)
+	return FALSE;
+
+    pvPc = &PRGBANK(R15);
+    pd = &fx_avDecoded[((uintptr_t)pvPc) & (FX_DECODE_SIZE - 1)];
+    if(pd->pvPc != pvPc || pd->vPrefix != vPrefix)
+	fx_decode(pd, pvPc, vPrefix);
+    if(GSU.vCounter < pd->vPrefixes)
+	return FALSE;
+
+    /* The loop has counted the first prefix, the last instruction is due */
+    GSU.vCounter -= pd->vPrefixes;
+    SFR |= pd->vFlags;
+    GSU.pvSreg = &GSU.avReg[pd->vSreg];
+    GSU.pvDreg = &GSU.avReg[pd->vDreg];
+    R15 += pd->vPrefixes;
+    PIPE = pd->vLast;
+    FX_STEP;
+    return TRUE;
+}
+
+/* In the prefix handlers, PIPE holds the opcode after the prefix */
+#define FX_PREFIX_RUN(op) if(fx_avPrefix[PIPE] && fx_runPrefixes(op)) return;
+#define FX_WITH_RUN(op) if(fx_avPrefix[PIPE] == 1 && fx_runPrefixes(op)) return;
+
+/*** Pixel cache ***/
+
+/* Plot stores the pixel's color in a cache of the 8 pixels of a screen row
+ * that share their bitplane bytes, and the row is written to RAM once, all
+ * planes at a time, when a pixel of another row is plotted. Like the GSU's
+ * own pixel cache, it is flushed before anything reads or writes RAM: rpix,
+ * the loads and stores, and the end of the slice. With program or ROM
+ * buffer code in the RAM banks 70-73 every pixel is written through. */
+
+#ifdef __SSE2__
+/* Bit n of each color to the top of its byte, then gathered */
+#define FX_PIXEL_PLANE(n) ((uint8)_mm_movemask_epi8(_mm_slli_epi16(c, 7 - (n))))
+#else
+/* Bit n of each color gathered into the top byte */
+#define FX_PIXEL_PLANE(n) \
+((uint8)((((c >> (n)) & 0x0101010101010101ULL) * 0x0102040810204080ULL) >> 56))
+#endif
+
+/* Planes 0/1, 2/3, 4/5 and 6/7 are interleaved 16 bytes apart */
+#define FX_PIXEL_FLUSH(n, offset) \
+a[offset] = (a[offset] & ~m) | (FX_PIXEL_PLANE(n) & m);
+
+static void fx_flushPixels()
+{
+    uint8 *a = GSU.pvPixelRow;
+    uint8 m = (uint8)GSU.vPixelMask;
+#ifdef __SSE2__
+    __m128i c = _mm_loadl_epi64((const __m128i *)GSU.avPixelColor);
+#else
+    uint64_t c = 0;
+    for(int i=0; i<8; i++)
+	c |= (uint64_t)GSU.avPixelColor[i] << (i << 3);
+#endif
+
+    switch(GSU.vPixelPlanes)
+    {
+    case 8:
+	FX_PIXEL_FLUSH(7, 0x31);
+	FX_PIXEL_FLUSH(6, 0x30);
+	FX_PIXEL_FLUSH(5, 0x21);
+	FX_PIXEL_FLUSH(4, 0x20);
+    case 4:
+	FX_PIXEL_FLUSH(3, 0x11);
+	FX_PIXEL_FLUSH(2, 0x10);
+    case 2:
+	FX_PIXEL_FLUSH(1, 0x01);
+	FX_PIXEL_FLUSH(0, 0x00);
+    }
+    GSU.vPixelMask = 0;
+}
+
+#define FX_FLUSH_PIXELS if(GSU.vPixelMask) fx_flushPixels();
+
+/* Plots color c at x in the row at a */
+#define FX_PLOT_PIXEL(planes) \
+if(a != GSU.pvPixelRow || GSU.vPixelPlanes != (planes)) \
+{ \
+    FX_FLUSH_PIXELS; \
+    GSU.pvPixelRow = a; \
+    GSU.vPixelPlanes = (planes); \
+} \
+GSU.avPixelColor[7 - (x & 7)] = c; \
+GSU.vPixelMask |= 128 >> (x & 7); \
+if((GSU.vPrgBankReg & 0xfc) == 0x70 || (GSU.vRomBankReg & 0xfc) == 0x70) \
+    fx_flushPixels();
+
 /* 00 - stop - stop GSU execution (and maybe generate an IRQ) */
 static void fx_stop()
 {
@@ -185,12 +386,15 @@ static void fx_bvs() { BRA_COND( TEST_OV ); }
 /* 10-1f - to rn - set register n as destination register */
 /* 10-1f(B) - move rn - move one register to another (if B flag is set) */
 #define FX_TO(reg) \
+FX_PREFIX_RUN(0x10 | (reg)); \
 if(TF(B)) { GSU.avReg[(reg)] = SREG; CLRFLAGS; } \
 else { GSU.pvDreg = &GSU.avReg[reg]; } R15++;
 #define FX_TO_R14(reg) \
+FX_PREFIX_RUN(0x10 | (reg)); \
 if(TF(B)) { GSU.avReg[(reg)] = SREG; CLRFLAGS; READR14; } \
 else { GSU.pvDreg = &GSU.avReg[reg]; } R15++;
 #define FX_TO_R15(reg) \
+FX_PREFIX_RUN(0x10 | (reg)); \
 if(TF(B)) { GSU.avReg[(reg)] = SREG; CLRFLAGS; } \
 else { GSU.pvDreg = &GSU.avReg[reg]; R15++; }
 static void fx_to_r0() { FX_TO(0); }
@@ -211,7 +415,7 @@ static void fx_to_r14() { FX_TO_R14(14); }
 static void fx_to_r15() { FX_TO_R15(15); }
 
 /* 20-2f - to rn - set register n as source and destination register */
-#define FX_WITH(reg) SF(B); GSU.pvSreg = GSU.pvDreg = &GSU.avReg[reg]; R15++;
+#define FX_WITH(reg) FX_WITH_RUN(0x20 | (reg)); SF(B); GSU.pvSreg = GSU.pvDreg = &GSU.avReg[reg]; R15++;
 static void fx_with_r0() { FX_WITH(0); }
 static void fx_with_r1() { FX_WITH(1); }
 static void fx_with_r2() { FX_WITH(2); }
@@ -231,6 +435,7 @@ static void fx_with_r15() { FX_WITH(15); }
 
 /* 30-3b - stw (rn) - store word */
 #define FX_STW(reg) \
+FX_FLUSH_PIXELS; \
 GSU.vLastRamAdr = GSU.avReg[reg]; \
 RAM(GSU.avReg[reg]) = (uint8)SREG; \
 RAM(GSU.avReg[reg]^1) = (uint8)(SREG>>8); \
@@ -250,6 +455,7 @@ static void fx_stw_r11() { FX_STW(11); }
 
 /* 30-3b(ALT1) - stb (rn) - store byte */
 #define FX_STB(reg) \
+FX_FLUSH_PIXELS; \
 GSU.vLastRamAdr = GSU.avReg[reg]; \
 RAM(GSU.avReg[reg]) = (uint8)SREG; \
 CLRFLAGS; R15++
@@ -279,16 +485,17 @@ static void fx_loop()
 }
 
 /* 3d - alt1 - set alt1 mode */
-static void fx_alt1() { SF(ALT1); CF(B); R15++; }
+static void fx_alt1() { FX_PREFIX_RUN(0x3d); SF(ALT1); CF(B); R15++; }
 
 /* 3e - alt2 - set alt2 mode */
-static void fx_alt2() { SF(ALT2); CF(B); R15++; }
+static void fx_alt2() { FX_PREFIX_RUN(0x3e); SF(ALT2); CF(B); R15++; }
 
 /* 3f - alt3 - set alt3 mode */
-static void fx_alt3() { SF(ALT1); SF(ALT2); CF(B); R15++; }
+static void fx_alt3() { FX_PREFIX_RUN(0x3f); SF(ALT1); SF(ALT2); CF(B); R15++; }
     
 /* 40-4b - ldw (rn) - load word from RAM */
 #define FX_LDW(reg) uint32 v; \
+FX_FLUSH_PIXELS; \
 GSU.vLastRamAdr = GSU.avReg[reg]; \
 v = (uint32)RAM(GSU.avReg[reg]); \
 v |= ((uint32)RAM(GSU.avReg[reg]^1))<<8; \
@@ -310,6 +517,7 @@ static void fx_ldw_r11() { FX_LDW(11); }
 
 /* 40-4b(ALT1) - ldb (rn) - load byte */
 #define FX_LDB(reg) uint32 v; \
+FX_FLUSH_PIXELS; \
 GSU.vLastRamAdr = GSU.avReg[reg]; \
 v = (uint32)RAM(GSU.avReg[reg]); \
 R15++; DREG = v; \
@@ -334,7 +542,7 @@ static void fx_plot_2bit()
     uint32 x = USEX8(R1);
     uint32 y = USEX8(R2);
     uint8 *a;
-    uint8 v,c;
+    uint8 c;
 
     R15++;
     CLRFLAGS;
@@ -350,12 +558,7 @@ static void fx_plot_2bit()
     
     if( !(GSU.vPlotOptionReg & 0x01) && !(c & 0xf)) return;
     a = GSU.apvScreen[y >> 3] + GSU.x[x >> 3] + ((y & 7) << 1);
-    v = 128 >> (x&7);
-
-    if(c & 0x01) a[0] |= v;
-    else a[0] &= ~v;
-    if(c & 0x02) a[1] |= v;
-    else a[1] &= ~v;
+    FX_PLOT_PIXEL(2);
 }
 
 /* 2c(ALT1) - rpix - read color of the pixel with R1,R2 as x,y */
@@ -368,6 +571,7 @@ static void fx_rpix_2bit()
 
     R15++;
     CLRFLAGS;
+    FX_FLUSH_PIXELS;
 #ifdef CHECK_LIMITS
     if(y >= GSU.vScreenHeight) return;
 #endif
@@ -387,7 +591,7 @@ static void fx_plot_4bit()
     uint32 x = USEX8(R1);
     uint32 y = USEX8(R2);
     uint8 *a;
-    uint8 v,c;
+    uint8 c;
 
     R15++;
     CLRFLAGS;
@@ -404,16 +608,7 @@ static void fx_plot_4bit()
     if( !(GSU.vPlotOptionReg & 0x01) && !(c & 0xf)) return;
 
     a = GSU.apvScreen[y >> 3] + GSU.x[x >> 3] + ((y & 7) << 1);
-    v = 128 >> (x&7);
-
-    if(c & 0x01) a[0x00] |= v;
-    else a[0x00] &= ~v;
-    if(c & 0x02) a[0x01] |= v;
-    else a[0x01] &= ~v;
-    if(c & 0x04) a[0x10] |= v;
-    else a[0x10] &= ~v;
-    if(c & 0x08) a[0x11] |= v;
-    else a[0x11] &= ~v;
+    FX_PLOT_PIXEL(4);
 }
 
 /* 4c(ALT1) - rpix - read color of the pixel with R1,R2 as x,y */
@@ -426,6 +621,7 @@ static void fx_rpix_4bit()
 
     R15++;
     CLRFLAGS;
+    FX_FLUSH_PIXELS;
 
 #ifdef CHECK_LIMITS
     if(y >= GSU.vScreenHeight) return;
@@ -448,7 +644,7 @@ static void fx_plot_8bit()
     uint32 x = USEX8(R1);
     uint32 y = USEX8(R2);
     uint8 *a;
-    uint8 v,c;
+    uint8 c;
 
     R15++;
     CLRFLAGS;
@@ -465,24 +661,7 @@ static void fx_plot_8bit()
 	}
 
     a = GSU.apvScreen[y >> 3] + GSU.x[x >> 3] + ((y & 7) << 1);
-    v = 128 >> (x&7);
-
-    if(c & 0x01) a[0x00] |= v;
-    else a[0x00] &= ~v;
-    if(c & 0x02) a[0x01] |= v;
-    else a[0x01] &= ~v;
-    if(c & 0x04) a[0x10] |= v;
-    else a[0x10] &= ~v;
-    if(c & 0x08) a[0x11] |= v;
-    else a[0x11] &= ~v;
-    if(c & 0x10) a[0x20] |= v;
-    else a[0x20] &= ~v;
-    if(c & 0x20) a[0x21] |= v;
-    else a[0x21] &= ~v;
-    if(c & 0x40) a[0x30] |= v;
-    else a[0x30] &= ~v;
-    if(c & 0x80) a[0x31] |= v;
-    else a[0x31] &= ~v;
+    FX_PLOT_PIXEL(8);
 }
 
 /* 4c(ALT1) - rpix - read color of the pixel with R1,R2 as x,y */
@@ -495,6 +674,7 @@ static void fx_rpix_8bit()
 
     R15++;
     CLRFLAGS;
+    FX_FLUSH_PIXELS;
 
 #ifdef CHECK_LIMITS
     if(y >= GSU.vScreenHeight) return;
@@ -1012,6 +1192,7 @@ static void fx_umult_i15() { FX_UMULT_I(15); }
 /* 90 - sbk - store word to last accessed RAM address */
 static void fx_sbk()
 {
+    FX_FLUSH_PIXELS;
     RAM(GSU.vLastRamAdr) = (uint8)SREG;
     RAM(GSU.vLastRamAdr^1) = (uint8)(SREG>>8);
     CLRFLAGS;
@@ -1168,6 +1349,7 @@ static void fx_ibt_r15() { FX_IBT(15); }
 
 /* a0-af(ALT1) - lms rn,(yy) - load word from RAM (short address) */
 #define FX_LMS(reg) \
+FX_FLUSH_PIXELS; \
 GSU.vLastRamAdr = ((uint32)PIPE) << 1; \
 R15++; FETCHPIPE; R15++; \
 GSU.avReg[reg] = (uint32)RAM(GSU.vLastRamAdr); \
@@ -1194,6 +1376,7 @@ static void fx_lms_r15() { FX_LMS(15); }
 /* If rn == r15, is the value of r15 before or after the extra byte is read? */
 #define FX_SMS(reg) \
 uint32 v = GSU.avReg[reg]; \
+FX_FLUSH_PIXELS; \
 GSU.vLastRamAdr = ((uint32)PIPE) << 1; \
 R15++; FETCHPIPE; \
 RAM(GSU.vLastRamAdr) = (uint8)v; \
@@ -1219,6 +1402,7 @@ static void fx_sms_r15() { FX_SMS(15); }
 /* b0-bf - from rn - set source register */
 /* b0-bf(B) - moves rn - move register to register, and set flags, (if B flag is set) */
 #define FX_FROM(reg) \
+FX_PREFIX_RUN(0xb0 | (reg)); \
 if(TF(B)) { uint32 v = GSU.avReg[reg]; R15++; DREG = v; \
 GSU.vOverflow = (v&0x80) << 16; GSU.vSign = v; GSU.vZero = v; TESTR14; CLRFLAGS; } \
 else { GSU.pvSreg = &GSU.avReg[reg]; R15++; }
@@ -1513,6 +1697,7 @@ static void fx_iwt_r15() { FX_IWT(15); }
 
 /* f0-ff(ALT1) - lm rn,(xx) - load word from RAM */
 #define FX_LM(reg) \
+FX_FLUSH_PIXELS; \
 GSU.vLastRamAdr = PIPE; R15++; FETCHPIPE; R15++; \
 GSU.vLastRamAdr |= USEX8(PIPE) << 8; FETCHPIPE; R15++; \
 GSU.avReg[reg] = RAM(GSU.vLastRamAdr); \
@@ -1539,6 +1724,7 @@ static void fx_lm_r15() { FX_LM(15); }
 /* If rn == r15, is the value of r15 before or after the extra bytes are read? */
 #define FX_SM(reg) \
 uint32 v = GSU.avReg[reg]; \
+FX_FLUSH_PIXELS; \
 GSU.vLastRamAdr = PIPE; R15++; FETCHPIPE; R15++; \
 GSU.vLastRamAdr |= USEX8(PIPE) << 8; FETCHPIPE; \
 RAM(GSU.vLastRamAdr) = (uint8)v; \
@@ -1570,6 +1756,7 @@ static uint32 fx_run(uint32 nInstructions)
 	while(GSU.vCounter-- > 0) {
 		FX_STEP;
 	}
+	FX_FLUSH_PIXELS;
  /*
 #ifndef FX_ADDRESS_CHECK
     GSU.vPipeAdr = USEX16(R15-1) | (USEX8(GSU.vPrgBankReg)<<16);
@@ -1581,6 +1768,8 @@ static uint32 fx_run(uint32 nInstructions)
 static uint32 fx_run_to_breakpoint(uint32 nInstructions)
 {
     uint32 vCounter = 0;
+    /* Step every prefix on its own */
+    GSU.vCounter = 0;
     while(TF(G) && vCounter < nInstructions)
     {
 		vCounter++;
@@ -1591,6 +1780,7 @@ static uint32 fx_run_to_breakpoint(uint32 nInstructions)
 	    break;
 	}
     }
+    FX_FLUSH_PIXELS;
     /*
 #ifndef FX_ADDRESS_CHECK
     GSU.vPipeAdr = USEX16(R15-1) | (USEX8(GSU.vPrgBankReg)<<16);
@@ -1602,6 +1792,8 @@ static uint32 fx_run_to_breakpoint(uint32 nInstructions)
 static uint32 fx_step_over(uint32 nInstructions)
 {
     uint32 vCounter = 0;
+    /* Step every prefix on its own */
+    GSU.vCounter = 0;
     while(TF(G) && vCounter < nInstructions)
     {
 		vCounter++;
@@ -1614,6 +1806,7 @@ static uint32 fx_step_over(uint32 nInstructions)
 	if(USEX16(R15) == GSU.vStepPoint)
 	    break;
     }
+    FX_FLUSH_PIXELS;
     /*
 #ifndef FX_ADDRESS_CHECK
     GSU.vPipeAdr = USEX16(R15-1) | (USEX8(GSU.vPrgBankReg)<<16);
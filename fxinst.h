@@ -219,6 +219,11 @@ struct FxRegs_s
     uint32	vScreenSize;
     void	(*pfPlot)();
     void	(*pfRpix)();
+
+    uint8 *	pvPixelRow;		/* Screen row of 8 pixels held by the pixel cache */
+    uint32	vPixelPlanes;		/* Its bitplanes */
+    uint32	vPixelMask;		/* Its plotted pixels, bit 7 being the leftmost */
+    uint8	avPixelColor[8];	/* Their colors, the rightmost first */
     
     uint8 *	pvRamBank;		/* Pointer to current RAM-bank */
     uint8 *	pvRomBank;		/* Pointer to current ROM-bank */
@@ -396,6 +401,9 @@ struct FxRegs_s
 #define FX_FUNCTION_RUN_TO_BREAKPOINT	1
 #define FX_FUNCTION_STEP_OVER		2
 
+/* Forgets the decoded prefix runs, for when the ROM changes */
+extern void fx_flushDecoded();
+
 extern uint32 (**fx_ppfFunctionTable)(uint32);
 extern void (**fx_ppfPlotTable)();
 extern void (**fx_ppfOpcodeTable)();
@@ -0,0 +1,301 @@
+/* Runs the SuperFX slices on a thread of their own (Settings.ThreadedSuperFX).
+ *
+ * S9xSuperFXExec runs the GSU for a scanline's worth of instructions at a
+ * time; here that slice is handed to the GSU thread and the S-CPU goes on
+ * with the scanline. The S-CPU waits for the slice before it next touches
+ * what the GSU owns: its registers and cache at $3000-$32ff, which go
+ * through S9xGetPPU/S9xSetPPU, and the GSU RAM, whose blocks the main map
+ * tags MAP_SUPERFX_SHARED to get the accesses here. DMA waits as well.
+ * So the S-CPU sees the GSU exactly where the serial core would have it.
+ *
+ * The one difference is the GSU IRQ, which the serial core raises right
+ * after the slice that stops the GSU, and which is raised here when the
+ * S-CPU next waits for the slice, at the latest a scanline later. ROM is
+ * only read by the GSU and needs no waiting. */
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "snes9x.h"
+
+#ifdef SUPER_FX
+
+#include "memmap.h"
+#include "ppu.h"
+#include "cpuexec.h"
+#include "fxemu.h"
+
+/* How many times a thread looks for the other before it gives up the core */
+#define FX_THREAD_SPINS		(1 << 14)
+
+#if defined(__i386__) || defined(__x86_64__)
+// Stores are not reordered with each other, nor loads with each other
+#define BARRIER()	__asm__ __volatile__ ("" : : : "memory")
+#define PAUSE()		__builtin_ia32_pause ()
+#else
+#define BARRIER()	__sync_synchronize ()
+#define PAUSE()
+#endif
+
+static struct {
+	// Written by the S-CPU
+	volatile uint32 Posted __attribute__ ((aligned (64)));
+	uint32 Instructions;
+	bool8 Running;		// The thread exists
+	bool8 Pending;		// A slice has been posted since the last sync
+	volatile bool8 Quit;
+
+	// Written by the GSU
+	volatile uint32 Done __attribute__ ((aligned (64)));
+
+	volatile bool8 Sleeping __attribute__ ((aligned (64)));
+} Thread;
+
+static pthread_t ThreadId;
+static pthread_mutex_t Lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t Wake = PTHREAD_COND_INITIALIZER;
+
+// The main map entries of the blocks tagged MAP_SUPERFX_SHARED
+static uint8 *SharedMap [MEMMAP_NUM_BLOCKS];
+static uint8 *SharedWriteMap [MEMMAP_NUM_BLOCKS];
+
+static bool8 SharedEntry (uint8 *entry, int block)
+{
+	uint8 *ptr;
+
+	if (entry < (uint8 *) CMemory::MAP_LAST)
+		return FALSE;
+	ptr = entry + ((block << MEMMAP_SHIFT) & 0xffff);
+	return ptr >= Memory.SRAM && ptr < Memory.SRAM + 0x20000;
+}
+
+static void TagShared ()
+{
+	// Banks 70-71 and the $6000 window of banks 00-3f/80-bf
+	for (int block = 0; block < MEMMAP_NUM_BLOCKS; block++) {
+		SharedMap [block] = Memory.Map [block];
+		SharedWriteMap [block] = Memory.WriteMap [block];
+		if (SharedEntry (Memory.Map [block], block))
+			Memory.Map [block] = (uint8 *) CMemory::MAP_SUPERFX_SHARED;
+		if (SharedEntry (Memory.WriteMap [block], block))
+			Memory.WriteMap [block] = (uint8 *) CMemory::MAP_SUPERFX_SHARED;
+	}
+}
+
+static void UntagShared ()
+{
+	// A ROM loaded since has built a map of its own
+	for (int block = 0; block < MEMMAP_NUM_BLOCKS; block++) {
+		if (Memory.Map [block] == (uint8 *) CMemory::MAP_SUPERFX_SHARED)
+			Memory.Map [block] = SharedMap [block];
+		if (Memory.WriteMap [block] == (uint8 *) CMemory::MAP_SUPERFX_SHARED)
+			Memory.WriteMap [block] = SharedWriteMap [block];
+	}
+}
+
+static void WakeUp ()
+{
+	__sync_synchronize ();
+	if (Thread.Sleeping) {
+		pthread_mutex_lock (&Lock);
+		pthread_cond_signal (&Wake);
+		pthread_mutex_unlock (&Lock);
+	}
+}
+
+static void Sleep (uint32 done)
+{
+	pthread_mutex_lock (&Lock);
+	Thread.Sleeping = TRUE;
+	__sync_synchronize ();
+	while (Thread.Posted == done && !Thread.Quit)
+		pthread_cond_wait (&Wake, &Lock);
+	Thread.Sleeping = FALSE;
+	pthread_mutex_unlock (&Lock);
+}
+
+static void *Run (void *)
+{
+	uint32 done = Thread.Done;
+	int spins = 0;
+
+	for (;;) {
+		uint32 posted = Thread.Posted;
+		BARRIER ();
+
+		if (posted == done) {
+			if (Thread.Quit)
+				break;
+			if (++spins < FX_THREAD_SPINS)
+				PAUSE ();
+			else {
+				Sleep (done);
+				spins = 0;
+			}
+			continue;
+		}
+
+		spins = 0;
+		FxEmulate (Thread.Instructions);
+		BARRIER ();
+		Thread.Done = ++done;
+	}
+	return NULL;
+}
+
+void S9xSuperFXSync ()
+{
+	int spins = 0;
+
+	if (!Thread.Pending)
+		return;
+
+	while (Thread.Done != Thread.Posted) {
+		WakeUp ();
+		if (++spins < FX_THREAD_SPINS)
+			PAUSE ();
+		else
+			sched_yield ();
+	}
+	BARRIER ();
+	Thread.Pending = FALSE;
+	S9xSuperFXStopped ();
+}
+
+bool8 S9xSuperFXThreadRun (uint32 instructions)
+{
+	if (!Thread.Running)
+		return FALSE;
+	// The S-CPU runs code from GSU RAM directly
+	if (CPU.PC >= Memory.SRAM && CPU.PC < Memory.SRAM + 0x20000)
+		return FALSE;
+
+	S9xSuperFXSync ();
+	Thread.Instructions = instructions;
+	Thread.Pending = TRUE;
+	BARRIER ();
+	Thread.Posted++;
+	WakeUp ();
+	return TRUE;
+}
+
+void S9xSuperFXThreadStart ()
+{
+	// With one core the threads would only take turns at it
+	if (Thread.Running || sysconf (_SC_NPROCESSORS_ONLN) < 2)
+		return;
+
+	Thread.Posted = 0;
+	Thread.Done = 0;
+	Thread.Pending = FALSE;
+	Thread.Quit = FALSE;
+
+	TagShared ();
+	Thread.Running = TRUE;
+	if (pthread_create (&ThreadId, NULL, Run, NULL) != 0) {
+		Thread.Running = FALSE;
+		UntagShared ();
+	}
+}
+
+void S9xSuperFXThreadStop ()
+{
+	if (!Thread.Running)
+		return;
+
+	S9xSuperFXSync ();
+	Thread.Quit = TRUE;
+	WakeUp ();
+	pthread_join (ThreadId, NULL);
+	Thread.Running = FALSE;
+	UntagShared ();
+}
+
+/* The S-CPU accesses to MAP_SUPERFX_SHARED blocks: wait for the GSU, then
+ * make the access with the block's own map entry. */
+
+uint8 S9xSuperFXSharedGetByte (uint32 address)
+{
+	int block = (address >> MEMMAP_SHIFT) & MEMMAP_MASK;
+	uint8 byte;
+
+	S9xSuperFXSync ();
+	Memory.Map [block] = SharedMap [block];
+	byte = S9xGetByte (address);
+	Memory.Map [block] = (uint8 *) CMemory::MAP_SUPERFX_SHARED;
+
+	return byte;
+}
+
+uint16 S9xSuperFXSharedGetWord (uint32 address)
+{
+	int block = (address >> MEMMAP_SHIFT) & MEMMAP_MASK;
+	uint16 word;
+
+	S9xSuperFXSync ();
+	Memory.Map [block] = SharedMap [block];
+	word = S9xGetWord (address);
+	Memory.Map [block] = (uint8 *) CMemory::MAP_SUPERFX_SHARED;
+
+	return word;
+}
+
+void S9xSuperFXSharedSetByte (uint8 byte, uint32 address)
+{
+	int block = (address >> MEMMAP_SHIFT) & MEMMAP_MASK;
+
+	S9xSuperFXSync ();
+	Memory.WriteMap [block] = SharedWriteMap [block];
+	S9xSetByte (byte, address);
+	Memory.WriteMap [block] = (uint8 *) CMemory::MAP_SUPERFX_SHARED;
+}
+
+void S9xSuperFXSharedSetWord (uint16 word, uint32 address)
+{
+	int block = (address >> MEMMAP_SHIFT) & MEMMAP_MASK;
+
+	S9xSuperFXSync ();
+	Memory.WriteMap [block] = SharedWriteMap [block];
+	S9xSetWord (word, address);
+	Memory.WriteMap [block] = (uint8 *) CMemory::MAP_SUPERFX_SHARED;
+}
+
+uint8 *S9xSuperFXSharedBasePointer (uint32 address)
+{
+	int block = (address >> MEMMAP_SHIFT) & MEMMAP_MASK;
+	uint8 *ptr;
+
+	S9xSuperFXSync ();
+	Memory.Map [block] = SharedMap [block];
+	ptr = GetBasePointer (address);
+	Memory.Map [block] = (uint8 *) CMemory::MAP_SUPERFX_SHARED;
+
+	return ptr;
+}
+
+uint8 *S9xSuperFXSharedMemPointer (uint32 address)
+{
+	int block = (address >> MEMMAP_SHIFT) & MEMMAP_MASK;
+	uint8 *ptr;
+
+	S9xSuperFXSync ();
+	Memory.Map [block] = SharedMap [block];
+	ptr = S9xGetMemPointer (address);
+	Memory.Map [block] = (uint8 *) CMemory::MAP_SUPERFX_SHARED;
+
+	return ptr;
+}
+
+void S9xSuperFXSharedSetPCBase (uint32 address)
+{
+	int block = (address >> MEMMAP_SHIFT) & MEMMAP_MASK;
+
+	// From here on S9xSuperFXThreadRun runs the slices serially
+	S9xSuperFXSync ();
+	Memory.Map [block] = SharedMap [block];
+	S9xSetPCBase (address);
+	Memory.Map [block] = (uint8 *) CMemory::MAP_SUPERFX_SHARED;
+}
+
+#endif
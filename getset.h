@@ -79,7 +79,7 @@ INLINE uint8 S9xGetByte (uint32 Address)
 	return (*(GetAddress + (Address & 0xffff)));
     }
 
-    switch ((int) GetAddress)
+    switch ((intptr_t) GetAddress)
     {
     case CMemory::MAP_PPU:
 #ifdef VAR_CYCLES
@@ -125,6 +125,14 @@ INLINE uint8 S9xGetByte (uint32 Address)
     case CMemory::MAP_C4:
 	return (S9xGetC4 (Address & 0xffff));
 
+#ifdef USE_SA1
+    case CMemory::MAP_SA1_SHARED:
+	return (S9xSA1SharedGetByte (Address));
+#endif
+#ifdef SUPER_FX
+    case CMemory::MAP_SUPERFX_SHARED:
+	return (S9xSuperFXSharedGetByte (Address));
+#endif
     default:
     case CMemory::MAP_NONE:
 #ifdef VAR_CYCLES
@@ -166,15 +174,10 @@ INLINE uint16 S9xGetWord (uint32 Address)
 	if (Memory.BlockIsRAM [block])
 	    CPU.WaitAddress = CPU.PCAtOpcodeStart;
 #endif
-#ifdef FAST_LSB_WORD_ACCESS
-	return (*(uint16 *) (GetAddress + (Address & 0xffff)));
-#else
-	return (*(GetAddress + (Address & 0xffff)) |
-		(*(GetAddress + (Address & 0xffff) + 1) << 8));
-#endif	
+	return (READ_WORD (GetAddress + (Address & 0xffff)));
     }
 
-    switch ((int) GetAddress)
+    switch ((intptr_t) GetAddress)
     {
     case CMemory::MAP_PPU:
 #ifdef VAR_CYCLES
@@ -230,6 +233,14 @@ INLINE uint16 S9xGetWord (uint32 Address)
 	return (S9xGetC4 (Address & 0xffff) |	
 		(S9xGetC4 ((Address + 1) & 0xffff) << 8));
 
+#ifdef USE_SA1
+    case CMemory::MAP_SA1_SHARED:
+	return (S9xSA1SharedGetWord (Address));
+#endif
+#ifdef SUPER_FX
+    case CMemory::MAP_SUPERFX_SHARED:
+	return (S9xSuperFXSharedGetWord (Address));
+#endif
     default:
     case CMemory::MAP_NONE:
 #ifdef VAR_CYCLES
@@ -242,6 +253,34 @@ INLINE uint16 S9xGetWord (uint32 Address)
     }
 }
 
+/* Reads the 24 bit pointers of the long indirect addressing modes. When all
+ * three bytes are in the same block of plain memory this is one load, else
+ * it is the word and byte reads the CPU does. */
+INLINE uint32 S9xGetLong (uint32 Address)
+{
+    if ((Address & MEMMAP_MASK) < MEMMAP_MASK - 1)
+    {
+#if defined(VAR_CYCLES) || defined(CPU_SHUTDOWN)
+	int block;
+	uint8 *GetAddress = Memory.Map [block = (Address >> MEMMAP_SHIFT) & MEMMAP_MASK];
+#else
+	uint8 *GetAddress = Memory.Map [(Address >> MEMMAP_SHIFT) & MEMMAP_MASK];
+#endif
+	if (GetAddress >= (uint8 *) CMemory::MAP_LAST)
+	{
+#ifdef VAR_CYCLES
+	    CPU.Cycles += Memory.MemorySpeed [block] * 3;
+#endif
+#ifdef CPU_SHUTDOWN
+	    if (Memory.BlockIsRAM [block])
+		CPU.WaitAddress = CPU.PCAtOpcodeStart;
+#endif
+	    return (READ_3WORD (GetAddress + (Address & 0xffff)));
+	}
+    }
+    return (S9xGetWord (Address) | (S9xGetByte (Address + 2) << 16));
+}
+
 INLINE void S9xSetByte (uint8 Byte, uint32 Address)
 {
 #ifdef __show_io__
@@ -285,7 +324,7 @@ INLINE void S9xSetByte (uint8 Byte, uint32 Address)
 	return;
     }
 
-    switch ((int) SetAddress)
+    switch ((intptr_t) SetAddress)
     {
     case CMemory::MAP_PPU:
 #ifdef VAR_CYCLES
@@ -336,7 +375,16 @@ INLINE void S9xSetByte (uint8 Byte, uint32 Address)
 #ifdef VAR_CYCLES
 	CPU.Cycles += SLOW_ONE_CYCLE;
 #endif
-	*(Memory.BWRAM + ((Address & 0x7fff) - 0x6000)) = Byte;
+	SetAddress = Memory.BWRAM + ((Address & 0x7fff) - 0x6000);
+#if defined(CPU_SHUTDOWN) && defined(USE_SA1)
+	if (SetAddress == SA1.WaitByteAddress1 ||
+	    SetAddress == SA1.WaitByteAddress2)
+	{
+	    SA1.Executing = SA1.S9xOpcodes != NULL;
+	    SA1.WaitCounter = 0;
+	}
+#endif
+	*SetAddress = Byte;
 	CPU.SRAMModified = TRUE;
 	return;
 
@@ -357,6 +405,16 @@ INLINE void S9xSetByte (uint8 Byte, uint32 Address)
 	S9xSetC4 (Byte, Address & 0xffff);
 	return;
 
+#ifdef USE_SA1
+    case CMemory::MAP_SA1_SHARED:
+	S9xSA1SharedSetByte (Byte, Address);
+	return;
+#endif
+#ifdef SUPER_FX
+    case CMemory::MAP_SUPERFX_SHARED:
+	S9xSuperFXSharedSetByte (Byte, Address);
+	return;
+#endif
     default:
     case CMemory::MAP_NONE:
 #ifdef VAR_CYCLES    
@@ -397,22 +455,26 @@ INLINE void S9xSetWord (uint16 Word, uint32 Address)
 #if defined(CPU_SHUTDOWN) && defined(USE_SA1)
 	uint8 *SetAddressSA1 = SetAddress + (Address & 0xffff);
 	if (SetAddressSA1 == SA1.WaitByteAddress1 ||
-	    SetAddressSA1 == SA1.WaitByteAddress2)
+	    SetAddressSA1 == SA1.WaitByteAddress2 ||
+	    SetAddressSA1 + 1 == SA1.WaitByteAddress1 ||
+	    SetAddressSA1 + 1 == SA1.WaitByteAddress2)
 	{
 	    SA1.Executing = SA1.S9xOpcodes != NULL;
 	    SA1.WaitCounter = 0;
 	}
 #endif
-#ifdef FAST_LSB_WORD_ACCESS
-	*(uint16 *) (SetAddress + (Address & 0xffff)) = Word;
-#else
-	*(SetAddress + (Address & 0xffff)) = (uint8) Word;
-	*(SetAddress + ((Address + 1) & 0xffff)) = Word >> 8;
-#endif
+	// The second byte of a word at $ffff wraps to the start of the bank
+	if ((Address & 0xffff) != 0xffff)
+	    WRITE_WORD (SetAddress + (Address & 0xffff), Word);
+	else
+	{
+	    *(SetAddress + 0xffff) = (uint8) Word;
+	    *SetAddress = Word >> 8;
+	}
 	return;
     }
 
-    switch ((int) SetAddress)
+    switch ((intptr_t) SetAddress)
     {
     case CMemory::MAP_PPU:
 #ifdef VAR_CYCLES
@@ -474,6 +536,19 @@ INLINE void S9xSetWord (uint16 Word, uint32 Address)
     case CMemory::MAP_BWRAM:
 #ifdef VAR_CYCLES
 	CPU.Cycles += SLOW_ONE_CYCLE * 2;
+#endif
+#if defined(CPU_SHUTDOWN) && defined(USE_SA1)
+	{
+	    uint8 *SetAddressSA1 = Memory.BWRAM + ((Address & 0x7fff) - 0x6000);
+	    if (SetAddressSA1 == SA1.WaitByteAddress1 ||
+		SetAddressSA1 == SA1.WaitByteAddress2 ||
+		SetAddressSA1 + 1 == SA1.WaitByteAddress1 ||
+		SetAddressSA1 + 1 == SA1.WaitByteAddress2)
+	    {
+		SA1.Executing = SA1.S9xOpcodes != NULL;
+		SA1.WaitCounter = 0;
+	    }
+	}
 #endif
 	*(Memory.BWRAM + ((Address & 0x7fff) - 0x6000)) = (uint8) Word;
 	*(Memory.BWRAM + (((Address + 1) & 0x7fff) - 0x6000)) = (uint8) (Word >> 8);
@@ -499,6 +574,16 @@ INLINE void S9xSetWord (uint16 Word, uint32 Address)
 	S9xSetC4 ((uint8) (Word >> 8), (Address + 1) & 0xffff);
 	return;
 
+#ifdef USE_SA1
+    case CMemory::MAP_SA1_SHARED:
+	S9xSA1SharedSetWord (Word, Address);
+	return;
+#endif
+#ifdef SUPER_FX
+    case CMemory::MAP_SUPERFX_SHARED:
+	S9xSuperFXSharedSetWord (Word, Address);
+	return;
+#endif
     default:
     case CMemory::MAP_NONE:
 #ifdef VAR_CYCLES    
@@ -517,7 +602,7 @@ INLINE uint8 *GetBasePointer (uint32 Address)
     if (GetAddress >= (uint8 *) CMemory::MAP_LAST)
 	return (GetAddress);
 
-    switch ((int) GetAddress)
+    switch ((intptr_t) GetAddress)
     {
     case CMemory::MAP_PPU:
 	return (Memory.FillRAM - 0x2000);
@@ -537,6 +622,14 @@ INLINE uint8 *GetBasePointer (uint32 Address)
     case CMemory::MAP_DEBUG:
 #ifdef DEBUGGER
 	printf ("GBP %06x\n", Address);
+#endif
+#ifdef USE_SA1
+    case CMemory::MAP_SA1_SHARED:
+	return (S9xSA1SharedBasePointer (Address));
+#endif
+#ifdef SUPER_FX
+    case CMemory::MAP_SUPERFX_SHARED:
+	return (S9xSuperFXSharedBasePointer (Address));
 #endif
     default:
     case CMemory::MAP_NONE:
@@ -553,7 +646,7 @@ INLINE uint8 *S9xGetMemPointer (uint32 Address)
     if (GetAddress >= (uint8 *) CMemory::MAP_LAST)
 	return (GetAddress + (Address & 0xffff));
 
-    switch ((int) GetAddress)
+    switch ((intptr_t) GetAddress)
     {
     case CMemory::MAP_PPU:
 	return (Memory.FillRAM - 0x2000 + (Address & 0xffff));
@@ -575,6 +668,14 @@ INLINE uint8 *S9xGetMemPointer (uint32 Address)
     case CMemory::MAP_DEBUG:
 #ifdef DEBUGGER
 	printf ("GMP %06x\n", Address);
+#endif
+#ifdef USE_SA1
+    case CMemory::MAP_SA1_SHARED:
+	return (S9xSA1SharedMemPointer (Address));
+#endif
+#ifdef SUPER_FX
+    case CMemory::MAP_SUPERFX_SHARED:
+	return (S9xSuperFXSharedMemPointer (Address));
 #endif
     default:
     case CMemory::MAP_NONE:
@@ -604,7 +705,7 @@ INLINE void S9xSetPCBase (uint32 Address)
 	return;
     }
 
-    switch ((int) GetAddress)
+    switch ((intptr_t) GetAddress)
     {
     case CMemory::MAP_PPU:
 #ifdef VAR_CYCLES
@@ -674,6 +775,16 @@ INLINE void S9xSetPCBase (uint32 Address)
 	printf ("SBP %06x\n", Address);
 #endif
 	
+#ifdef USE_SA1
+    case CMemory::MAP_SA1_SHARED:
+	S9xSA1SharedSetPCBase (Address);
+	return;
+#endif
+#ifdef SUPER_FX
+    case CMemory::MAP_SUPERFX_SHARED:
+	S9xSuperFXSharedSetPCBase (Address);
+	return;
+#endif
     default:
     case CMemory::MAP_NONE:
 #ifdef VAR_CYCLES
@@ -52,8 +52,15 @@
 #include "cheats.h"
 #include "tile.h"
 #include "misc.h"
+#include "profile.h"
 #include "platform/Options.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 #define USE_CRAZY_OPTS
 
 #define M7 19
@@ -72,19 +79,6 @@ extern uint8 PaletteMasks[8][4];
 extern uint8 Depths[8][4];
 extern uint8 BGSizes [2];
 
-extern NormalTileRenderer DrawTilePtr;
-extern ClippedTileRenderer DrawClippedTilePtr;
-extern NormalTileRenderer DrawHiResTilePtr;
-extern ClippedTileRenderer DrawHiResClippedTilePtr;
-extern LargePixelRenderer DrawLargePixelPtr;
-
-extern struct SBG BG;
-
-extern struct SLineData LineData[240];
-extern struct SLineMatrixData LineMatrixData [240];
-
-extern uint8  Mode7Depths [2];
-
 #define ON_MAIN(N) \
 (GFX.r212c & (1 << (N)) && \
  !(PPU.BG_Forced & (1 << (N))))
@@ -210,6 +204,8 @@ bool8_32 S9xGraphicsInit ()
 
     GFX.InfoStringTimeout = 0;
     GFX.InfoString = NULL;
+    GFX.VRAM = Memory.VRAM;
+    GFX.FillRAM = Memory.FillRAM;
 
     PPU.BG_Forced = 0;
     IPPU.OBJChanged = TRUE;
@@ -369,11 +365,19 @@ bool8_32 S9xGraphicsInit ()
 	    }
 	}
 
+    if (Settings.RenderThreads > 1)
+	S9xRenderThreadsStart ();
+    if (Settings.RenderPipeline)
+	S9xRenderPipelineStart ();
+
     return (TRUE);
 }
 
 void S9xGraphicsDeinit (void)
 {
+    S9xRenderPipelineStop ();
+    S9xRenderThreadsStop ();
+
     // Free any memory allocated in S9xGraphicsInit
     if (GFX.X2)
     {
@@ -479,6 +483,20 @@ void RenderLine (uint8 C)
 }
 
 
+void S9xShowScreen ()
+{
+	if (Settings.DisplayFrameRate || showSpeed) {
+		S9xDisplayFrameRate();
+	}
+
+	if (GFX.InfoString) {
+		S9xDisplayString(GFX.InfoString);
+	}
+
+	S9xDeinitUpdate(
+		IPPU.RenderedScreenWidth, IPPU.RenderedScreenHeight);
+}
+
 void S9xEndScreenRefresh()
 {
 	IPPU.HDMAStarted = FALSE;
@@ -511,16 +529,10 @@ void S9xEndScreenRefresh()
 			PPU.CGDATA[0] = saved;
 		}
 
-		if (Settings.DisplayFrameRate || showSpeed) {
-			S9xDisplayFrameRate();
-		}
-
-		if (GFX.InfoString) {
-			S9xDisplayString(GFX.InfoString);
-		}
-
-		S9xDeinitUpdate(
-			IPPU.RenderedScreenWidth, IPPU.RenderedScreenHeight);
+		// The render pipeline draws the frame while the next one is
+		// emulated, and shows the one it drew before instead
+		if (!S9xRenderPipelineEndFrame ())
+			S9xShowScreen ();
     }
 
 #ifndef RC_OPTIMIZED
@@ -638,6 +650,43 @@ INLINE void SelectTileRenderer (bool8_32 normal)
     }
 }
 
+/* Counts the tiles of sprite S on the screen, the ones the PPU has to fetch,
+ * and sets X to the first of their columns. */
+static INLINE int OBJVisibleTiles (int S, int *X)
+{
+    int HPos = PPU.OBJ [S].HPos;
+    int Size = GFX.Sizes [S];
+
+    if (HPos < 0)
+    {
+	*X = HPos + (-HPos & ~7);
+	return (Size + HPos + 7) >> 3;
+    }
+    *X = HPos;
+    if (HPos + Size >= 257)
+	return (263 - HPos) >> 3;
+    return (Size >> 3);
+}
+
+/* Takes sprite S's tiles off After, those of the sprites from S on in a
+ * line's OBJ, and returns the screen x where the tiles the PPU has time for
+ * end. It fetches the last sprite's first, so out of time it is the first
+ * sprites that lose theirs. */
+static INLINE int OBJTimeLimit (int S, int *After)
+{
+    int X;
+    int Tiles = OBJVisibleTiles (S, &X);
+    int Room;
+
+    *After -= Tiles;
+    Room = 34 - *After;
+    if (Room < 0)
+	Room = 0;
+    if (Room > Tiles)
+	Room = Tiles;
+    return (X + Room * 8);
+}
+
 void S9xSetupOBJ ()
 {
     int SmallSize;
@@ -700,161 +749,233 @@ void S9xSetupOBJ ()
 
     // Terminate the list
     GFX.OBJList [C] = -1;
+
+    // Then the first 32 of them on each line, and how many tiles those have
+    for (int Y = 0; Y < 240; Y++)
+    {
+	GFX.OBJLines [Y].Count = 0;
+	GFX.OBJLines [Y].Flags = 0;
+	GFX.OBJLines [Y].Tiles = 0;
+    }
+    for (int I = 0; I < C; I++)
+    {
+	int X;
+	S = GFX.OBJList [I];
+	int Tiles = OBJVisibleTiles (S, &X);
+	int Y = GFX.VPositions [S] > 0 ? GFX.VPositions [S] : 0;
+	int End = GFX.VPositions [S] + (int) GFX.Sizes [S];
+
+	if (End > 240)
+	    End = 240;
+	for (; Y < End; Y++)
+	{
+	    struct SOBJLine *L = &GFX.OBJLines [Y];
+
+	    if (L->Count == 32)
+	    {
+		L->Flags |= OBJ_RANGE_OVER;
+		continue;
+	    }
+	    L->OBJ [L->Count++] = S;
+	    L->Tiles += Tiles;
+	    if (L->Tiles > 34)
+		L->Flags |= OBJ_TIME_OVER;
+	}
+    }
     IPPU.OBJChanged = FALSE;
 }
 
-void DrawOBJS (bool8_32 OnMain = FALSE, uint8 D = 0)
+/* Draws the lines GFX.StartY to GFX.EndY of sprite S, left of Limit. */
+static void DrawOBJ (int S, int Limit, bool8_32 OnMain, uint8 D)
 {
-	uint32 O;
+    uint32 O;
     uint32 BaseTile, Tile;
 
-    CHECK_SOUND();
+    int VPos = GFX.VPositions [S];
+    int Size = GFX.Sizes[S];
+    int TileInc = 1;
+    int Offset;
 
-    BG.BitShift = 4;
-    BG.TileShift = 5;
-    BG.TileAddress = PPU.OBJNameBase;
-    BG.StartPalette = 128;
-    BG.PaletteShift = 4;
-    BG.PaletteMask = 7;
-    BG.Buffer = IPPU.TileCache [TILE_4BIT];
-	BG.Buffered = IPPU.TileCached [TILE_4BIT];
-	BG.NameSelect = PPU.OBJNameSelect;
-    BG.DirectColourMode = FALSE;
+    if (OnMain && SUB_OR_ADD(4))
+    {
+	SelectTileRenderer (!GFX.Pseudo && PPU.OBJ [S].Palette < 4);
+    }
 
-    GFX.Z1 = D + 2;
+    BaseTile = PPU.OBJ[S].Name | (PPU.OBJ[S].Palette << 10);
 
-    int I = 0;
-    for (int S = GFX.OBJList [I++]; S >= 0; S = GFX.OBJList [I++])
+    if (PPU.OBJ[S].HFlip)
     {
-	int VPos = GFX.VPositions [S];
-	int Size = GFX.Sizes[S];
-	int TileInc = 1;
-	int Offset;
+	BaseTile += ((Size >> 3) - 1) | H_FLIP;
+	TileInc = -1;
+    }
+    if (PPU.OBJ[S].VFlip)
+	BaseTile |= V_FLIP;
 
-	if (VPos + Size <= (int) GFX.StartY || VPos > (int) GFX.EndY)
-	    continue;
+    int clipcount = GFX.pCurrentClip->Count [4];
+    if (!clipcount)
+	clipcount = 1;
+	
+    GFX.Z2 = (PPU.OBJ[S].Priority + 1) * 4 + D;
 
-	if (OnMain && SUB_OR_ADD(4))
+    for (int clip = 0; clip < clipcount; clip++)
+    {
+	int Left; 
+	int Right;
+	if (!GFX.pCurrentClip->Count [4])
 	{
-	    SelectTileRenderer (!GFX.Pseudo && PPU.OBJ [S].Palette < 4);
+	    Left = 0;
+	    Right = 256;
 	}
-
-	BaseTile = PPU.OBJ[S].Name | (PPU.OBJ[S].Palette << 10);
-
-	if (PPU.OBJ[S].HFlip)
+	else
 	{
-	    BaseTile += ((Size >> 3) - 1) | H_FLIP;
-	    TileInc = -1;
+	    Left = GFX.pCurrentClip->Left [clip][4];
+	    Right = GFX.pCurrentClip->Right [clip][4];
 	}
-	if (PPU.OBJ[S].VFlip)
-	    BaseTile |= V_FLIP;
 
-	int clipcount = GFX.pCurrentClip->Count [4];
-	if (!clipcount)
-	    clipcount = 1;
-	
-	GFX.Z2 = (PPU.OBJ[S].Priority + 1) * 4 + D;
+	if (Right > Limit)
+	    Right = Limit;
+	if (Right <= Left || PPU.OBJ[S].HPos + Size <= Left ||
+	    PPU.OBJ[S].HPos >= Right)
+	    continue;
 
-	for (int clip = 0; clip < clipcount; clip++)
+	for (int Y = 0; Y < Size; Y += 8)
 	{
-	    int Left; 
-	    int Right;
-	    if (!GFX.pCurrentClip->Count [4])
-	    {
-		Left = 0;
-		Right = 256;
-	    }
-	    else
+	    if (VPos + Y + 7 >= (int) GFX.StartY && VPos + Y <= (int) GFX.EndY)
 	    {
-		Left = GFX.pCurrentClip->Left [clip][4];
-		Right = GFX.pCurrentClip->Right [clip][4];
-	    }
+		int StartLine;
+		int TileLine;
+		int LineCount;
+		int Last;
+		    
+		if ((StartLine = VPos + Y) < (int) GFX.StartY)
+		{
+		    StartLine = GFX.StartY - StartLine;
+		    LineCount = 8 - StartLine;
+		}
+		else
+		{
+		    StartLine = 0;
+		    LineCount = 8;
+		}
+		if ((Last = VPos + Y + 7 - GFX.EndY) > 0)
+		    if ((LineCount -= Last) <= 0)
+			break;
 
-	    if (Right <= Left || PPU.OBJ[S].HPos + Size <= Left ||
-		PPU.OBJ[S].HPos >= Right)
-		continue;
+		TileLine = StartLine << 3;
+		O = (VPos + Y + StartLine) * GFX.PPL;
+		if (!PPU.OBJ[S].VFlip)
+		    Tile = BaseTile + (Y << 1);
+		else
+		    Tile = BaseTile + ((Size - Y - 8) << 1);
 
-	    for (int Y = 0; Y < Size; Y += 8)
-	    {
-		if (VPos + Y + 7 >= (int) GFX.StartY && VPos + Y <= (int) GFX.EndY)
+		int Middle = Size >> 3;
+		if (PPU.OBJ[S].HPos < Left)
 		{
-		    int StartLine;
-		    int TileLine;
-		    int LineCount;
-		    int Last;
-		    
-		    if ((StartLine = VPos + Y) < (int) GFX.StartY)
-		    {
-			StartLine = GFX.StartY - StartLine;
-			LineCount = 8 - StartLine;
-		    }
-		    else
-		    {
-			StartLine = 0;
-			LineCount = 8;
-		    }
-		    if ((Last = VPos + Y + 7 - GFX.EndY) > 0)
-			if ((LineCount -= Last) <= 0)
-			    break;
-
-		    TileLine = StartLine << 3;
-		    O = (VPos + Y + StartLine) * GFX.PPL;
-		    if (!PPU.OBJ[S].VFlip)
-			Tile = BaseTile + (Y << 1);
-		    else
-			Tile = BaseTile + ((Size - Y - 8) << 1);
-
-		    int Middle = Size >> 3;
-		    if (PPU.OBJ[S].HPos < Left)
+		    Tile += ((Left - PPU.OBJ[S].HPos) >> 3) * TileInc;
+		    Middle -= (Left - PPU.OBJ[S].HPos) >> 3;
+		    O += Left * GFX_PIX_SIZE;
+		    if ((Offset = (Left - PPU.OBJ[S].HPos) & 7))
 		    {
-			Tile += ((Left - PPU.OBJ[S].HPos) >> 3) * TileInc;
-			Middle -= (Left - PPU.OBJ[S].HPos) >> 3;
-			O += Left * GFX_PIX_SIZE;
-			if ((Offset = (Left - PPU.OBJ[S].HPos) & 7))
-			{
-			    O -= Offset * GFX_PIX_SIZE;
-			    int W = 8 - Offset;
-			    int Width = Right - Left;
-			    if (W > Width)
-				W = Width;
-			    (*DrawClippedTilePtr) (Tile, O, Offset, W,
-						   TileLine, LineCount);
+			O -= Offset * GFX_PIX_SIZE;
+			int W = 8 - Offset;
+			int Width = Right - Left;
+			if (W > Width)
+			    W = Width;
+			(*DrawClippedTilePtr) (Tile, O, Offset, W,
+					       TileLine, LineCount);
 			    
-			    if (W >= Width)
-				continue;
-			    Tile += TileInc;
-			    Middle--;
-			    O += 8 * GFX_PIX_SIZE;
-			}
+			if (W >= Width)
+			    continue;
+			Tile += TileInc;
+			Middle--;
+			O += 8 * GFX_PIX_SIZE;
 		    }
-		    else
-			O += PPU.OBJ[S].HPos * GFX_PIX_SIZE;
+		}
+		else
+		    O += PPU.OBJ[S].HPos * GFX_PIX_SIZE;
 
-		    if (PPU.OBJ[S].HPos + Size >= Right)
-		    {
-			Middle -= ((PPU.OBJ[S].HPos + Size + 7) -
-				   Right) >> 3;
-			Offset = (Right - (PPU.OBJ[S].HPos + Size)) & 7;
-		    }
-		    else
-			Offset = 0;
+		if (PPU.OBJ[S].HPos + Size >= Right)
+		{
+		    Middle -= ((PPU.OBJ[S].HPos + Size + 7) -
+			       Right) >> 3;
+		    Offset = (Right - (PPU.OBJ[S].HPos + Size)) & 7;
+		}
+		else
+		    Offset = 0;
 
-		    for (int X = 0; X < Middle; X++, O += 8 * GFX_PIX_SIZE,
-			 Tile += TileInc)
-		    {
-			(*DrawTilePtr) (Tile, O, TileLine, LineCount);
-		    }
-		    if (Offset)
-		    {
-			(*DrawClippedTilePtr) (Tile, O, 0, Offset,
-					       TileLine, LineCount);
-		    }
+		for (int X = 0; X < Middle; X++, O += 8 * GFX_PIX_SIZE,
+		     Tile += TileInc)
+		{
+		    (*DrawTilePtr) (Tile, O, TileLine, LineCount);
+		}
+		if (Offset)
+		{
+		    (*DrawClippedTilePtr) (Tile, O, 0, Offset,
+					   TileLine, LineCount);
 		}
 	    }
 	}
     }
 }
 
+void DrawOBJS (bool8_32 OnMain = FALSE, uint8 D = 0)
+{
+    CHECK_SOUND();
+
+    BG.BitShift = 4;
+    BG.TileShift = 5;
+    BG.TileAddress = PPU.OBJNameBase;
+    BG.StartPalette = 128;
+    BG.PaletteShift = 4;
+    BG.PaletteMask = 7;
+    BG.Buffer = IPPU.TileCache [TILE_4BIT];
+	BG.Buffered = IPPU.TileCached [TILE_4BIT];
+	BG.NameSelect = PPU.OBJNameSelect;
+    BG.DirectColourMode = FALSE;
+
+    GFX.Z1 = D + 2;
+
+    // Lines that have room for all their sprites draw them a tile row at a
+    // time. Those the PPU runs out of room or time on only go together
+    // with lines that lose the same sprites and tiles
+    uint32 StartY = GFX.StartY;
+    uint32 EndY = GFX.EndY;
+
+    for (uint32 Y = StartY; Y <= EndY; Y = GFX.EndY + 1)
+    {
+	const struct SOBJLine *L = &GFX.OBJLines [Y];
+
+	GFX.StartY = GFX.EndY = Y;
+	if (L->Flags)
+	{
+	    while (GFX.EndY < EndY &&
+		   memcmp (L, L + GFX.EndY + 1 - Y,
+			   offsetof (struct SOBJLine, OBJ) + L->Count) == 0)
+		GFX.EndY++;
+
+	    int After = L->Tiles;
+	    for (int I = 0; I < L->Count; I++)
+		DrawOBJ (L->OBJ [I], OBJTimeLimit (L->OBJ [I], &After),
+			 OnMain, D);
+	    continue;
+	}
+
+	while (GFX.EndY < EndY && !GFX.OBJLines [GFX.EndY + 1].Flags)
+	    GFX.EndY++;
+
+	int I = 0;
+	for (int S = GFX.OBJList [I++]; S >= 0; S = GFX.OBJList [I++])
+	{
+	    if (GFX.VPositions [S] + (int) GFX.Sizes [S] > (int) GFX.StartY &&
+		GFX.VPositions [S] <= (int) GFX.EndY)
+		DrawOBJ (S, 256, OnMain, D);
+	}
+    }
+
+    GFX.StartY = StartY;
+    GFX.EndY = EndY;
+}
+
 void DrawBackgroundMosaic (uint32 BGMode, uint32 bg, uint8 Z1, uint8 Z2)
 {
     CHECK_SOUND();
@@ -871,7 +992,7 @@ void DrawBackgroundMosaic (uint32 BGMode, uint32 bg, uint8 Z1, uint8 Z2)
     else
 	BG.StartPalette = 0;
 
-    SC0 = (uint16 *) &Memory.VRAM[PPU.BG[bg].SCBase << 1];
+    SC0 = (uint16 *) &GFX.VRAM[PPU.BG[bg].SCBase << 1];
 
     if (PPU.BG[bg].SCSize & 1)
 	SC1 = SC0 + 1024;
@@ -1085,7 +1206,7 @@ void DrawBackgroundOffset (uint32 BGMode, uint32 bg, uint8 Z1, uint8 Z2)
     
     BG.StartPalette = 0;
 
-    BPS0 = (uint16 *) &Memory.VRAM[PPU.BG[2].SCBase << 1];
+    BPS0 = (uint16 *) &GFX.VRAM[PPU.BG[2].SCBase << 1];
 
     if (PPU.BG[2].SCSize & 1)
 	BPS1 = BPS0 + 1024;
@@ -1102,7 +1223,7 @@ void DrawBackgroundOffset (uint32 BGMode, uint32 bg, uint8 Z1, uint8 Z2)
     else
 	BPS3 = BPS2;
     
-    SC0 = (uint16 *) &Memory.VRAM[PPU.BG[bg].SCBase << 1];
+    SC0 = (uint16 *) &GFX.VRAM[PPU.BG[bg].SCBase << 1];
 
     if (PPU.BG[bg].SCSize & 1)
 	SC1 = SC0 + 1024;
@@ -1362,7 +1483,7 @@ void DrawBackgroundMode5 (uint32 /* BGMODE */, uint32 bg, uint8 Z1, uint8 Z2)
     
     BG.StartPalette = 0;
 
-    SC0 = (uint16 *) &Memory.VRAM[PPU.BG[bg].SCBase << 1];
+    SC0 = (uint16 *) &GFX.VRAM[PPU.BG[bg].SCBase << 1];
 
     if ((PPU.BG[bg].SCSize & 1))
 	SC1 = SC0 + 1024;
@@ -1711,7 +1832,7 @@ void DrawBackground (uint32 BGMode, uint32 bg, uint8 Z1, uint8 Z2)
     else
 	BG.StartPalette = 0;
 
-    SC0 = (uint16 *) &Memory.VRAM[PPU.BG[bg].SCBase << 1];
+    SC0 = (uint16 *) &GFX.VRAM[PPU.BG[bg].SCBase << 1];
 
     if (PPU.BG[bg].SCSize & 1)
 	SC1 = SC0 + 1024;
@@ -2012,624 +2133,305 @@ void DrawBackground (uint32 BGMode, uint32 bg, uint8 Z1, uint8 Z2)
     }
 }
 
-#define RENDER_BACKGROUND_MODE7_PIXEL_NOREPEAT(FUNC,HFLIP,REPEAT,MASK,PRIOMASK) \
-	const uint8 bmask = MASK; \
-	for (int x = startx; x != endx; \
-		x += (HFLIP ? -1 : 1), AA += aa, CC += cc, p++, d++) \
-	{ \
-		int X = ((AA + BB) >> 8) & 0x3ff; \
-		int Y = ((CC + DD) >> 8) & 0x3ff; \
-		uint8 *TileData = VRAM1 + (Memory.VRAM[((Y & ~7) << 5) + ((X >> 2) & ~1)] << 7); \
-		uint8 b = *(TileData + ((Y & 7) << 4) + ((X & 7) << 1)); \
-		uint8 z = Mode7Depths [(b & PRIOMASK) >> 7]; \
-		if (z > *d && b) \
-		{ \
-			*p = (FUNC); \
-			*d = z; \
-		} \
-	}
-
-#define RENDER_BACKGROUND_MODE7_PIXEL(FUNC,HFLIP,REPEAT,MASK,PRIOMASK,CFILT) \
-	register int AABB = AA + BB; \
-	register int CCDD = CC + DD; \
-	const uint8 bmask = MASK; \
-	for (int x = startx; x != endx; \
-		x += (HFLIP ? -1 : 1), AABB += aa, CCDD += cc, p++, d++) \
-	{ \
-		register uint16 X = ((AABB) >> 8) CFILT; \
-		register uint16 Y = ((CCDD) >> 8) CFILT; \
-	\
-		if (((X | Y) & ~0x3ff) == 0) { \
-			uint8 *TileData = VRAM1 + (Memory.VRAM[((Y & ~7) << 5) + ((X >> 2) & ~1)] << 7); \
-			uint8 b = TileData[((Y & 7) << 4) + ((X & 7) << 1)]; \
-			uint8 z = Mode7Depths [(b & PRIOMASK) >> 7]; \
-			if (z > *d && b) { \
-				*p = (FUNC); \
-				*d = z; \
-			} \
-		} else if (REPEAT == 3) { \
-			X = (x + HOffset) & 7; \
-			Y = (yy + CentreY) & 7; \
-			uint8 b = *(VRAM1 + ((Y & 7) << 4) + ((X & 7) << 1)); \
-			uint8 z = Mode7Depths [(b & PRIOMASK) >> 7]; \
-			if (z > *d && b) { \
-				*p = (FUNC); \
-				*d = z; \
-			} \
-		} \
-	} \
-
-#define RENDER_BACKGROUND_MODE7_CLIP(TYPE,FUNC,HFLIP,REPEAT,DEZAEMON,MASK,PRIOMASK) \
-	for (uint32 clip = 0; clip < ClipCount; clip++) \
-	{ \
-	    if (GFX.pCurrentClip->Count [bg]) \
-	    { \
-			Left = GFX.pCurrentClip->Left [clip][bg]; \
-			Right = GFX.pCurrentClip->Right [clip][bg]; \
-			if (Right <= Left) \
-				continue; \
-	    } \
-	    register TYPE *p = (TYPE *) Screen + Left; \
-	    register uint8 *d = Depth + Left; \
-\
-	    if (HFLIP) \
-	    { \
-			startx = Right - 1; \
-			endx = Left - 1; \
-			aa = -l->MatrixA; \
-			cc = -l->MatrixC; \
-	    } \
-	    else \
-	    { \
-			startx = Left; \
-			endx = Right; \
-			aa = l->MatrixA; \
-			cc = l->MatrixC; \
-	    } \
-	    int xx; \
-	    if (!REPEAT) \
-			xx = startx + (HOffset - CentreX) % 1023; \
-	    else \
-			xx = startx + HOffset - CentreX; \
-	    int AA = l->MatrixA * xx; \
-	    int CC = l->MatrixC * xx; \
-\
-	    if (!REPEAT) \
-	    { \
-			RENDER_BACKGROUND_MODE7_PIXEL_NOREPEAT(FUNC,HFLIP,REPEAT,MASK,PRIOMASK) \
-	    } else if (DEZAEMON) { \
-			RENDER_BACKGROUND_MODE7_PIXEL(FUNC,HFLIP,REPEAT,MASK,PRIOMASK,& 0x7ff) \
-		} else { \
-			RENDER_BACKGROUND_MODE7_PIXEL(FUNC,HFLIP,REPEAT,MASK,PRIOMASK,) \
-	    } \
-	} \
-
-#ifdef USE_CRAZY_OPTS
-
-#define RENDER_BACKGROUND_MODE7_CLIP_CHOOSE_MASK(TYPE,FUNC,HFLIP,REPEAT,DEZAEMON) \
-	if (GFX.Mode7PriorityMask) { \
-		RENDER_BACKGROUND_MODE7_CLIP(TYPE,FUNC,HFLIP,REPEAT,DEZAEMON,0x7f,0x80) \
-	} else { \
-		RENDER_BACKGROUND_MODE7_CLIP(TYPE,FUNC,HFLIP,REPEAT,DEZAEMON,0xff,0x00) \
-	}
-
-#define RENDER_BACKGROUND_MODE7_CLIP_CHOOSE_REPEAT_DEZAEMON(TYPE,FUNC,HFLIP) \
-	if (Settings.Dezaemon && PPU.Mode7Repeat) { \
-		switch (PPU.Mode7Repeat) { \
-			case 1: RENDER_BACKGROUND_MODE7_CLIP_CHOOSE_MASK(TYPE,FUNC,HFLIP,1,1); break; \
-			case 2: RENDER_BACKGROUND_MODE7_CLIP_CHOOSE_MASK(TYPE,FUNC,HFLIP,2,1); break; \
-			case 3: RENDER_BACKGROUND_MODE7_CLIP_CHOOSE_MASK(TYPE,FUNC,HFLIP,3,1); break; \
-		} \
-	} else { \
-		switch (PPU.Mode7Repeat) { \
-			case 0: RENDER_BACKGROUND_MODE7_CLIP_CHOOSE_MASK(TYPE,FUNC,HFLIP,0,0); break; \
-			case 1: RENDER_BACKGROUND_MODE7_CLIP_CHOOSE_MASK(TYPE,FUNC,HFLIP,1,0); break; \
-			case 2: RENDER_BACKGROUND_MODE7_CLIP_CHOOSE_MASK(TYPE,FUNC,HFLIP,2,0); break; \
-			case 3: RENDER_BACKGROUND_MODE7_CLIP_CHOOSE_MASK(TYPE,FUNC,HFLIP,3,0); break; \
-		} \
-	}
-
-#define RENDER_BACKGROUND_MODE7_CLIP_CHOOSE_HFLIP(TYPE,FUNC) \
-	if (PPU.Mode7HFlip) { \
-		RENDER_BACKGROUND_MODE7_CLIP_CHOOSE_REPEAT_DEZAEMON(TYPE,FUNC,1); \
-	} else { \
-		RENDER_BACKGROUND_MODE7_CLIP_CHOOSE_REPEAT_DEZAEMON(TYPE,FUNC,0); \
-	}
+/* Colour math a line at a time. The COLOR_ADD, COLOR_ADD1_2, COLOR_SUB and
+ * COLOR_SUB1_2 tables only ever double, saturate, zero or keep a whole
+ * field of the halved sum or difference, which masks built from the top bit
+ * of each field do as well, so with SSE2 or NEON BlendLine gives exactly
+ * what they give eight RGB565 pixels at a time. */
+#if (defined(__SSE2__) || defined(__ARM_NEON__)) && \
+    !defined(GFX_MULTI_FORMAT) && !defined(OLD_COLOUR_BLENDING) && \
+    RGB_LOW_BITS_MASK == 0x0821 && RGB_HI_BITS_MASK == 0x8410
+#define BLEND_VECTOR
+
+#if defined(__SSE2__)
+typedef __m128i BlendVec;
+#define BLEND_SET(c) _mm_set1_epi16 ((short) (c))
+#define BLEND_AND(a, b) _mm_and_si128 (a, b)
+#define BLEND_ANDNOT(a, b) _mm_andnot_si128 (b, a)
+#define BLEND_OR(a, b) _mm_or_si128 (a, b)
+#define BLEND_XOR(a, b) _mm_xor_si128 (a, b)
+#define BLEND_ADD(a, b) _mm_add_epi16 (a, b)
+#define BLEND_SUB(a, b) _mm_sub_epi16 (a, b)
+#define BLEND_SHR(a, n) _mm_srli_epi16 (a, n)
+#define BLEND_SHL(a, n) _mm_slli_epi16 (a, n)
+#define BLEND_ZERO(a) _mm_cmpeq_epi16 (a, _mm_setzero_si128 ())
+#define BLEND_LOAD(p) _mm_loadu_si128 ((const __m128i *) (p))
+#define BLEND_STORE(p, a) _mm_storeu_si128 ((__m128i *) (p), a)
+#define BLEND_MASK(p) _mm_cmpgt_epi16 (_mm_unpacklo_epi8 ( \
+	_mm_loadl_epi64 ((const __m128i *) (p)), _mm_setzero_si128 ()), \
+	_mm_setzero_si128 ())
+#define BLEND_SELECT(m, a, b) _mm_or_si128 (_mm_and_si128 (m, a), \
+					    _mm_andnot_si128 (m, b))
+#else
+typedef uint16x8_t BlendVec;
+#define BLEND_SET(c) vdupq_n_u16 (c)
+#define BLEND_AND(a, b) vandq_u16 (a, b)
+#define BLEND_ANDNOT(a, b) vbicq_u16 (a, b)
+#define BLEND_OR(a, b) vorrq_u16 (a, b)
+#define BLEND_XOR(a, b) veorq_u16 (a, b)
+#define BLEND_ADD(a, b) vaddq_u16 (a, b)
+#define BLEND_SUB(a, b) vsubq_u16 (a, b)
+#define BLEND_SHR(a, n) vshrq_n_u16 (a, n)
+#define BLEND_SHL(a, n) vshlq_n_u16 (a, n)
+#define BLEND_ZERO(a) vceqq_u16 (a, vdupq_n_u16 (0))
+#define BLEND_LOAD(p) vld1q_u16 (p)
+#define BLEND_STORE(p, a) vst1q_u16 (p, a)
+#define BLEND_MASK(p) vtstq_u16 (vmovl_u8 (vld1_u8 (p)), vdupq_n_u16 (0xffff))
+#define BLEND_SELECT(m, a, b) vbslq_u16 (m, a, b)
+#endif
 
-#define RENDER_BACKGROUND_MODE7_CLIP_CHOOSE(TYPE,FUNC) \
-	RENDER_BACKGROUND_MODE7_CLIP_CHOOSE_HFLIP(TYPE,FUNC)
+/* Returns each field of y all ones if its top bit is set, else 0. */
+static INLINE BlendVec BlendFields (BlendVec y)
+{
+    BlendVec rb = BLEND_AND (y, BLEND_SET (0x8010));
+    BlendVec g = BLEND_AND (y, BLEND_SET (0x0400));
 
-#else
+    return BLEND_OR (BLEND_OR (rb, BLEND_SUB (rb, BLEND_SHR (rb, 4))),
+		     BLEND_OR (g, BLEND_SUB (g, BLEND_SHR (g, 5))));
+}
 
-#define RENDER_BACKGROUND_MODE7_CLIP_CHOOSE(TYPE,FUNC) \
-	RENDER_BACKGROUND_MODE7_CLIP(TYPE,FUNC,PPU.Mode7HFlip,PPU.Mode7Repeat,Settings.Dezaemon,GFX.Mode7Mask,GFX.Mode7PriorityMask)
+static INLINE BlendVec BlendAdd1_2 (BlendVec c1, BlendVec c2)
+{
+    BlendVec low = BLEND_SET (RGB_LOW_BITS_MASK);
 
-#endif
+    return BLEND_ADD (BLEND_ADD (BLEND_SHR (BLEND_ANDNOT (c1, low), 1),
+				 BLEND_SHR (BLEND_ANDNOT (c2, low), 1)),
+		      BLEND_AND (BLEND_AND (c1, c2), low));
+}
 
-#define RENDER_BACKGROUND_MODE7_LINE(TYPE,FUNC) \
-	for (uint32 Line = GFX.StartY; Line <= GFX.EndY; Line++, Screen += GFX.Pitch, Depth += GFX.PPL, l++) \
-    { \
-	int yy; \
-\
-	int32 HOffset = ((int32) LineData [Line].BG[0].HOffset << M7) >> M7; \
-	int32 VOffset = ((int32) LineData [Line].BG[0].VOffset << M7) >> M7; \
-\
-	int32 CentreX = ((int32) l->CentreX << M7) >> M7; \
-	int32 CentreY = ((int32) l->CentreY << M7) >> M7; \
-\
-	if (PPU.Mode7VFlip) \
-	    yy = 261 - (int) Line; \
-	else \
-	    yy = Line; \
-\
-	if (PPU.Mode7Repeat == 0) \
-	    yy += (VOffset - CentreY) % 1023; \
-	else \
-	    yy += VOffset - CentreY; \
-	int BB = l->MatrixB * yy + (CentreX << 8); \
-	int DD = l->MatrixD * yy + (CentreY << 8); \
-\
-	RENDER_BACKGROUND_MODE7_CLIP_CHOOSE(TYPE,FUNC) \
-    }
-
-#define RENDER_BACKGROUND_MODE7(TYPE,FUNC) \
-    CHECK_SOUND(); \
-\
-    uint8 * const VRAM1 = Memory.VRAM + 1; \
-    if (GFX.r2130 & 1) \
-    { \
-		if (IPPU.DirectColourMapsNeedRebuild) \
-			S9xBuildDirectColourMaps (); \
-		GFX.ScreenColors = DirectColourMaps [0]; \
-    } \
-    else \
-		GFX.ScreenColors = IPPU.ScreenColors; \
-\
-    int aa, cc; \
-    int startx, endx; \
-    uint32 Left = 0; \
-    uint32 Right = 256; \
-    uint32 ClipCount = GFX.pCurrentClip->Count [bg]; \
-\
-    if (!ClipCount) \
-	ClipCount = 1; \
-\
-    Screen += GFX.StartY * GFX.Pitch; \
-    uint8 *Depth = GFX.DB + GFX.StartY * GFX.PPL; \
-    struct SLineMatrixData *l = &LineMatrixData [GFX.StartY]; \
-    RENDER_BACKGROUND_MODE7_LINE(TYPE,FUNC) \
-\
-
-
-void DrawBGMode7Background (uint8 *Screen, int bg)
+static INLINE BlendVec BlendAdd (BlendVec c1, BlendVec c2)
 {
-    RENDER_BACKGROUND_MODE7 (uint8, (uint8) (b & bmask))
+    // GFX.X2: double each field, saturating the ones that overflow
+    BlendVec h = BlendAdd1_2 (c1, c2);
+    BlendVec m = BlendFields (h);
+    BlendVec r = BLEND_OR (BLEND_ANDNOT (BLEND_SHL (h, 1),
+					 BLEND_OR (m, BLEND_SET (0x0820))), m);
+
+    return BLEND_OR (r, BLEND_AND (BLEND_XOR (c1, c2),
+				   BLEND_SET (RGB_LOW_BITS_MASK)));
 }
 
-void DrawBGMode7Background16 (uint8 *Screen, int bg)
+/* Returns the halved difference of each field, with the field's top bit set
+ * if it did not borrow. */
+static INLINE BlendVec BlendDifference (BlendVec c1, BlendVec c2)
 {
-    RENDER_BACKGROUND_MODE7 (uint16, GFX.ScreenColors [b & bmask]);
+    return BLEND_SUB (BLEND_OR (BLEND_SHR (c1, 1), BLEND_SET (RGB_HI_BITS_MASK)),
+		      BLEND_SHR (BLEND_ANDNOT (c2, BLEND_SET (RGB_LOW_BITS_MASK)), 1));
 }
 
-void DrawBGMode7Background16Add (uint8 *Screen, int bg)
+static INLINE BlendVec BlendSub1_2 (BlendVec c1, BlendVec c2)
 {
-    RENDER_BACKGROUND_MODE7 (uint16, *(d + GFX.DepthDelta) ?
-					(*(d + GFX.DepthDelta) != 1 ?
-					    COLOR_ADD (GFX.ScreenColors [b & bmask],
-						       p [GFX.Delta]) :
-					    COLOR_ADD (GFX.ScreenColors [b & bmask],
-						       GFX.FixedColour)) :
-					 GFX.ScreenColors [b & bmask]);
+    // GFX.ZERO: zero the fields that borrowed
+    BlendVec y = BlendDifference (c1, c2);
+
+    return BLEND_ANDNOT (BLEND_AND (y, BlendFields (y)),
+			 BLEND_SET (RGB_HI_BITS_MASK));
 }
 
-void DrawBGMode7Background16Add1_2 (uint8 *Screen, int bg)
+static INLINE BlendVec BlendSub (BlendVec c1, BlendVec c2)
 {
-    RENDER_BACKGROUND_MODE7 (uint16, *(d + GFX.DepthDelta) ?
-					(*(d + GFX.DepthDelta) != 1 ?
-					    COLOR_ADD1_2 (GFX.ScreenColors [b & bmask],
-						       p [GFX.Delta]) :
-					    COLOR_ADD (GFX.ScreenColors [b & bmask],
-						       GFX.FixedColour)) :
-					 GFX.ScreenColors [b & bmask]);
+    // GFX.ZERO_OR_X2: double the fields that did not borrow, zero the rest,
+    // then make the zero ones 1
+    BlendVec low = BLEND_SET (RGB_LOW_BITS_MASK);
+    BlendVec y = BlendDifference (c1, c2);
+    BlendVec r = BLEND_AND (BlendFields (y),
+			    BLEND_ANDNOT (BLEND_SHL (y, 1), BLEND_SET (0x0820)));
+
+    r = BLEND_OR (r, BLEND_OR (BLEND_OR (
+	BLEND_AND (BLEND_ZERO (BLEND_AND (r, BLEND_SET (0xf800))), BLEND_SET (0x0800)),
+	BLEND_AND (BLEND_ZERO (BLEND_AND (r, BLEND_SET (0x07e0))), BLEND_SET (0x0020))),
+	BLEND_AND (BLEND_ZERO (BLEND_AND (r, BLEND_SET (0x001f))), BLEND_SET (0x0001))));
+
+    return BLEND_SUB (BLEND_ADD (r, BLEND_AND (c1, low)), BLEND_AND (c2, low));
 }
+#endif
 
-void DrawBGMode7Background16Sub (uint8 *Screen, int bg)
+/* Sets Dst to Main added to or subtracted from Sub, as r2131 asks, and
+ * halved if Half, where Mask is not 0. Main and Sub may be Dst. */
+static void BlendLine (uint16 *Dst, const uint16 *Main, const uint16 *Sub,
+		       const uint8 *Mask, int Width, bool8_32 Half)
 {
-    RENDER_BACKGROUND_MODE7 (uint16, *(d + GFX.DepthDelta) ?
-					(*(d + GFX.DepthDelta) != 1 ?
-					    COLOR_SUB (GFX.ScreenColors [b & bmask],
-						       p [GFX.Delta]) :
-					    COLOR_SUB (GFX.ScreenColors [b & bmask],
-						       GFX.FixedColour)) :
-					 GFX.ScreenColors [b & bmask]);
+    int x = 0;
+
+#ifdef BLEND_VECTOR
+#define BLEND_LINE(OP) \
+    for (; x + 8 <= Width; x += 8) \
+    { \
+	uint64_t any; \
+	memcpy (&any, Mask + x, 8); \
+	if (any) \
+	    BLEND_STORE (Dst + x, BLEND_SELECT (BLEND_MASK (Mask + x), \
+			 OP (BLEND_LOAD (Main + x), BLEND_LOAD (Sub + x)), \
+			 BLEND_LOAD (Dst + x))); \
+    }
+
+    if (GFX.r2131 & 0x80)
+    {
+	if (Half)
+	    BLEND_LINE (BlendSub1_2)
+	else
+	    BLEND_LINE (BlendSub)
+    }
+    else
+    {
+	if (Half)
+	    BLEND_LINE (BlendAdd1_2)
+	else
+	    BLEND_LINE (BlendAdd)
+    }
+#undef BLEND_LINE
+#endif
+
+    for (; x < Width; x++)
+    {
+	if (!Mask [x])
+	    continue;
+	if (GFX.r2131 & 0x80)
+	    Dst [x] = Half ? COLOR_SUB1_2 (Main [x], Sub [x]) :
+			     COLOR_SUB (Main [x], Sub [x]);
+	else
+	    Dst [x] = Half ? COLOR_ADD1_2 (Main [x], Sub [x]) :
+			     COLOR_ADD (Main [x], Sub [x]);
+    }
 }
 
-void DrawBGMode7Background16Sub1_2 (uint8 *Screen, int bg)
+/* Mode 7 a span at a time. Mode7Fetch steps the map coordinates of four
+ * pixels at a time with SSE2 or NEON and then gathers their tile and pixel
+ * bytes, so DrawMode7 only has to depth test, colour (or, smoothed,
+ * interpolate) and then blend the span with BlendLine. Off-map pixels and
+ * the sizes of the coordinates follow the old RENDER_BACKGROUND_MODE7
+ * macros, quirks and all: the plain renderer keeps only 16 bits of them,
+ * the smoothed one all 32. */
+
+struct Mode7Span
+{
+    uint32 XPos;		/// Map coordinates of the first pixel, in 1/256ths
+    uint32 YPos;
+    uint32 aa;			/// Step from one pixel to the next
+    uint32 cc;
+    uint32 CoordMask;		/// Bits of the coordinates that count
+    uint8 Tile0 [8];		/// What off-map pixels show, by screen x & 7
+    uint32 Tile0X;		/// Screen x of the first pixel, plus HOffset
+    int dir;
+};
+
+static INLINE uint8 Mode7Pixel (const uint8 *VRAM1, uint32 X, uint32 Y)
 {
-    RENDER_BACKGROUND_MODE7 (uint16, *(d + GFX.DepthDelta) ?
-					(*(d + GFX.DepthDelta) != 1 ?
-					    COLOR_SUB1_2 (GFX.ScreenColors [b & bmask],
-						       p [GFX.Delta]) :
-					    COLOR_SUB (GFX.ScreenColors [b & bmask],
-						       GFX.FixedColour)) :
-					 GFX.ScreenColors [b & bmask]);
+    return VRAM1 [(GFX.VRAM [((Y & ~7) << 5) + ((X >> 2) & ~1)] << 7) +
+		  ((Y & 7) << 4) + ((X & 7) << 1)];
 }
 
-#define RENDER_BACKGROUND_MODE7_i(TYPE,FUNC,COLORFUNC) \
-    CHECK_SOUND(); \
-\
-    uint8 *VRAM1 = Memory.VRAM + 1; \
-    if (GFX.r2130 & 1) \
-    { \
-        if (IPPU.DirectColourMapsNeedRebuild) \
-            S9xBuildDirectColourMaps (); \
-        GFX.ScreenColors = DirectColourMaps [0]; \
-    } \
-    else \
-        GFX.ScreenColors = IPPU.ScreenColors; \
-    \
-    int aa, cc; \
-    int dir; \
-    int startx, endx; \
-    uint32 Left = 0; \
-    uint32 Right = 256; \
-    uint32 ClipCount = GFX.pCurrentClip->Count [bg]; \
-    \
-    if (!ClipCount) \
-        ClipCount = 1; \
-    \
-    Screen += GFX.StartY * GFX.Pitch; \
-    uint8 *Depth = GFX.DB + GFX.StartY * GFX.PPL; \
-    struct SLineMatrixData *l = &LineMatrixData [GFX.StartY]; \
-    bool8_32 allowSimpleCase = FALSE; \
-    if (!l->MatrixB && !l->MatrixC && (l->MatrixA == 0x0100) && (l->MatrixD == 0x0100) \
-        && !LineMatrixData[GFX.EndY].MatrixB && !LineMatrixData[GFX.EndY].MatrixC \
-        && (LineMatrixData[GFX.EndY].MatrixA == 0x0100) && (LineMatrixData[GFX.EndY].MatrixD == 0x0100) \
-        ) \
-        allowSimpleCase = TRUE;  \
-    \
-    for (uint32 Line = GFX.StartY; Line <= GFX.EndY; Line++, Screen += GFX.Pitch, Depth += GFX.PPL, l++) \
-    { \
-        int yy; \
-        \
-        int HOffset = ((int) LineData [Line].BG[0].HOffset << M7) >> M7; \
-        int VOffset = ((int) LineData [Line].BG[0].VOffset << M7) >> M7; \
-        \
-        int CentreX = ((int) l->CentreX << M7) >> M7; \
-        int CentreY = ((int) l->CentreY << M7) >> M7; \
-        \
-        if (PPU.Mode7VFlip) \
-            yy = 261 - (int) Line; \
-        else \
-            yy = Line; \
-        \
-	if (PPU.Mode7Repeat == 0) \
-	    yy += (VOffset - CentreY) % 1023; \
-	else \
-	    yy += VOffset - CentreY; \
-        bool8_32 simpleCase = FALSE; \
-        int BB; \
-        int DD; \
-        /* Make a special case for the identity matrix, since it's a common case and */ \
-        /* can be done much more quickly without special effects */ \
-        if (allowSimpleCase && !l->MatrixB && !l->MatrixC && (l->MatrixA == 0x0100) && (l->MatrixD == 0x0100)) \
-        { \
-            BB = CentreX << 8; \
-            DD = (yy + CentreY) << 8; \
-            simpleCase = TRUE; \
-        } \
-        else \
-        { \
-            BB = l->MatrixB * yy + (CentreX << 8); \
-            DD = l->MatrixD * yy + (CentreY << 8); \
-        } \
-        \
-        for (uint32 clip = 0; clip < ClipCount; clip++) \
-        { \
-            if (GFX.pCurrentClip->Count [bg]) \
-            { \
-                Left = GFX.pCurrentClip->Left [clip][bg]; \
-                Right = GFX.pCurrentClip->Right [clip][bg]; \
-                if (Right <= Left) \
-                    continue; \
-            } \
-            TYPE *p = (TYPE *) Screen + Left; \
-            uint8 *d = Depth + Left; \
-            \
-            if (PPU.Mode7HFlip) \
-            { \
-                startx = Right - 1; \
-                endx = Left - 1; \
-                dir = -1; \
-                aa = -l->MatrixA; \
-                cc = -l->MatrixC; \
-            } \
-            else \
-            { \
-                startx = Left; \
-                endx = Right; \
-                dir = 1; \
-                aa = l->MatrixA; \
-                cc = l->MatrixC; \
-            } \
-            int xx; \
-	    if (PPU.Mode7Repeat == 0) \
-		xx = startx + (HOffset - CentreX) % 1023; \
-	    else \
-		xx = startx + HOffset - CentreX; \
-            int AA, CC = 0; \
-            if (simpleCase) \
-            { \
-                AA = xx << 8; \
-            } \
-            else \
-            { \
-                AA = l->MatrixA * xx; \
-                CC = l->MatrixC * xx; \
-            } \
-            if (simpleCase) \
-            { \
-                if (!PPU.Mode7Repeat) \
-                { \
-                    int x = startx; \
-                    do \
-                    { \
-                        int X = ((AA + BB) >> 8) & 0x3ff; \
-                        int Y = (DD >> 8) & 0x3ff; \
-                        uint8 *TileData = VRAM1 + (Memory.VRAM[((Y & ~7) << 5) + ((X >> 2) & ~1)] << 7); \
-                        uint32 b = *(TileData + ((Y & 7) << 4) + ((X & 7) << 1)); \
-			GFX.Z1 = Mode7Depths [(b & GFX.Mode7PriorityMask) >> 7]; \
-                        if (GFX.Z1 > *d && b) \
-                        { \
-                            TYPE theColor = COLORFUNC; \
-                            *p = (FUNC) | ALPHA_BITS_MASK; \
-                            *d = GFX.Z1; \
-                        } \
-                        AA += aa, p++, d++; \
-			x += dir; \
-                    } while (x != endx); \
-                } \
-                else \
-                { \
-                    int x = startx; \
-                    do { \
-                        int X = (AA + BB) >> 8; \
-                        int Y = DD >> 8; \
-\
-			if(Settings.Dezaemon && PPU.Mode7Repeat == 2) \
-			{ \
-			    X &= 0x7ff; \
-			    Y &= 0x7ff; \
-			} \
-\
-                        if (((X | Y) & ~0x3ff) == 0) \
-                        { \
-                            uint8 *TileData = VRAM1 + (Memory.VRAM[((Y & ~7) << 5) + ((X >> 2) & ~1)] << 7); \
-			    uint32 b = *(TileData + ((Y & 7) << 4) + ((X & 7) << 1)); \
-			    GFX.Z1 = Mode7Depths [(b & GFX.Mode7PriorityMask) >> 7]; \
-                            if (GFX.Z1 > *d && b) \
-                            { \
-                                TYPE theColor = COLORFUNC; \
-                                *p = (FUNC) | ALPHA_BITS_MASK; \
-                                *d = GFX.Z1; \
-                            } \
-                        } \
-                        else if (PPU.Mode7Repeat == 3) \
-                        { \
-                            X = (x + HOffset) & 7; \
-                            Y = (yy + CentreY) & 7; \
-			    uint8 *TileData = VRAM1 + (Memory.VRAM[((Y & ~7) << 5) + ((X >> 2) & ~1)] << 7); \
-			    uint32 b = *(TileData + ((Y & 7) << 4) + ((X & 7) << 1)); \
-			    GFX.Z1 = Mode7Depths [(b & GFX.Mode7PriorityMask) >> 7]; \
-                            if (GFX.Z1 > *d && b) \
-                            { \
-                                TYPE theColor = COLORFUNC; \
-                                *p = (FUNC) | ALPHA_BITS_MASK; \
-                                *d = GFX.Z1; \
-                            } \
-                        } \
-                        AA += aa; p++; d++; \
-			x += dir; \
-                    } while (x != endx); \
-                } \
-            } \
-            else if (!PPU.Mode7Repeat) \
-            { \
-                /* The bilinear interpolator: get the colors at the four points surrounding */ \
-                /* the location of one point in the _sampled_ image, and weight them according */ \
-                /* to their (city block) distance.  It's very smooth, but blurry with "close up" */ \
-                /* points. */ \
-                \
-                /* 460 (slightly less than 2 source pixels per displayed pixel) is an educated */ \
-                /* guess for where bilinear filtering will become a poor method for averaging. */ \
-                /* (When reducing the image, the weighting used by a bilinear filter becomes */ \
-                /* arbitrary, and a simple mean is a better way to represent the source image.) */ \
-                /* You can think of this as a kind of mipmapping. */ \
-                if ((aa < 460 && aa > -460) && (cc < 460 && cc > -460)) \
-                {\
-                    for (int x = startx; x != endx; x += dir, AA += aa, CC += cc, p++, d++) \
-                    { \
-                        uint32 xPos = AA + BB; \
-                        uint32 xPix = xPos >> 8; \
-                        uint32 yPos = CC + DD; \
-                        uint32 yPix = yPos >> 8; \
-                        uint32 X = xPix & 0x3ff; \
-                        uint32 Y = yPix & 0x3ff; \
-                        uint8 *TileData = VRAM1 + (Memory.VRAM[((Y & ~7) << 5) + ((X >> 2) & ~1)] << 7); \
-			uint32 b = *(TileData + ((Y & 7) << 4) + ((X & 7) << 1)); \
-			GFX.Z1 = Mode7Depths [(b & GFX.Mode7PriorityMask) >> 7]; \
-                        if (GFX.Z1 > *d && b) \
-                        { \
-                            /* X10 and Y01 are the X and Y coordinates of the next source point over. */ \
-                            uint32 X10 = (xPix + dir) & 0x3ff; \
-                            uint32 Y01 = (yPix + dir) & 0x3ff; \
-                            uint8 *TileData10 = VRAM1 + (Memory.VRAM[((Y & ~7) << 5) + ((X10 >> 2) & ~1)] << 7); \
-                            uint8 *TileData11 = VRAM1 + (Memory.VRAM[((Y01 & ~7) << 5) + ((X10 >> 2) & ~1)] << 7); \
-                            uint8 *TileData01 = VRAM1 + (Memory.VRAM[((Y01 & ~7) << 5) + ((X >> 2) & ~1)] << 7); \
-                            uint32 p1 = COLORFUNC; \
-                            p1 = (p1 & FIRST_THIRD_COLOR_MASK) | ((p1 & SECOND_COLOR_MASK) << 16); \
-                            b = *(TileData10 + ((Y & 7) << 4) + ((X10 & 7) << 1)); \
-                            uint32 p2 = COLORFUNC; \
-                            p2 = (p2 & FIRST_THIRD_COLOR_MASK) | ((p2 & SECOND_COLOR_MASK) << 16); \
-                            b = *(TileData11 + ((Y01 & 7) << 4) + ((X10 & 7) << 1)); \
-                            uint32 p4 = COLORFUNC; \
-                            p4 = (p4 & FIRST_THIRD_COLOR_MASK) | ((p4 & SECOND_COLOR_MASK) << 16); \
-                            b = *(TileData01 + ((Y01 & 7) << 4) + ((X & 7) << 1)); \
-                            uint32 p3 = COLORFUNC; \
-                            p3 = (p3 & FIRST_THIRD_COLOR_MASK) | ((p3 & SECOND_COLOR_MASK) << 16); \
-                            /* Xdel, Ydel: position (in 1/32nds) between the points */ \
-                            uint32 Xdel = (xPos >> 3) & 0x1F; \
-                            uint32 Ydel = (yPos >> 3) & 0x1F; \
-                            uint32 XY = (Xdel*Ydel) >> 5; \
-                            uint32 area1 = 0x20 + XY - Xdel - Ydel; \
-                            uint32 area2 = Xdel - XY; \
-                            uint32 area3 = Ydel - XY; \
-                            uint32 area4 = XY; \
-                            uint32 tempColor = ((area1 * p1) + \
-                                                (area2 * p2) + \
-                                                (area3 * p3) + \
-                                                (area4 * p4)) >> 5; \
-                            TYPE theColor = (tempColor & FIRST_THIRD_COLOR_MASK) | ((tempColor >> 16) & SECOND_COLOR_MASK); \
-                            *p = (FUNC) | ALPHA_BITS_MASK; \
-                            *d = GFX.Z1; \
-                        } \
-                    } \
-                } \
-                else \
-                    /* The oversampling method: get the colors at four corners of a square */ \
-                    /* in the _displayed_ image, and average them.  It's sharp and clean, but */ \
-                    /* gives the usual huge pixels when the source image gets "close." */ \
-                { \
-                    /* Find the dimensions of the square in the source image whose corners will be examined. */ \
-                    uint32 aaDelX = aa >> 1; \
-                    uint32 ccDelX = cc >> 1; \
-                    uint32 bbDelY = l->MatrixB >> 1; \
-                    uint32 ddDelY = l->MatrixD >> 1; \
-                    /* Offset the location within the source image so that the four sampled points */ \
-                    /* center around where the single point would otherwise have been drawn. */ \
-                    BB -= (bbDelY >> 1); \
-                    DD -= (ddDelY >> 1); \
-                    AA -= (aaDelX >> 1); \
-                    CC -= (ccDelX >> 1); \
-                    uint32 BB10 = BB + aaDelX; \
-                    uint32 BB01 = BB + bbDelY; \
-                    uint32 BB11 = BB + aaDelX + bbDelY; \
-                    uint32 DD10 = DD + ccDelX; \
-                    uint32 DD01 = DD + ddDelY; \
-                    uint32 DD11 = DD + ccDelX + ddDelY; \
-                    for (int x = startx; x != endx; x += dir, AA += aa, CC += cc, p++, d++) \
-                    { \
-                        uint32 X = ((AA + BB) >> 8) & 0x3ff; \
-                        uint32 Y = ((CC + DD) >> 8) & 0x3ff; \
-                        uint8 *TileData = VRAM1 + (Memory.VRAM[((Y & ~7) << 5) + ((X >> 2) & ~1)] << 7); \
-			uint32 b = *(TileData + ((Y & 7) << 4) + ((X & 7) << 1)); \
-			GFX.Z1 = Mode7Depths [(b & GFX.Mode7PriorityMask) >> 7]; \
-                        if (GFX.Z1 > *d && b) \
-                        { \
-                            /* X, Y, X10, Y10, etc. are the coordinates of the four pixels within the */ \
-                            /* source image that we're going to examine. */ \
-                            uint32 X10 = ((AA + BB10) >> 8) & 0x3ff; \
-                            uint32 Y10 = ((CC + DD10) >> 8) & 0x3ff; \
-                            uint32 X01 = ((AA + BB01) >> 8) & 0x3ff; \
-                            uint32 Y01 = ((CC + DD01) >> 8) & 0x3ff; \
-                            uint32 X11 = ((AA + BB11) >> 8) & 0x3ff; \
-                            uint32 Y11 = ((CC + DD11) >> 8) & 0x3ff; \
-                            uint8 *TileData10 = VRAM1 + (Memory.VRAM[((Y10 & ~7) << 5) + ((X10 >> 2) & ~1)] << 7); \
-                            uint8 *TileData01 = VRAM1 + (Memory.VRAM[((Y01 & ~7) << 5) + ((X01 >> 2) & ~1)] << 7); \
-                            uint8 *TileData11 = VRAM1 + (Memory.VRAM[((Y11 & ~7) << 5) + ((X11 >> 2) & ~1)] << 7); \
-                            TYPE p1 = COLORFUNC; \
-                            b = *(TileData10 + ((Y10 & 7) << 4) + ((X10 & 7) << 1)); \
-                            TYPE p2 = COLORFUNC; \
-                            b = *(TileData01 + ((Y01 & 7) << 4) + ((X01 & 7) << 1)); \
-                            TYPE p3 = COLORFUNC; \
-                            b = *(TileData11 + ((Y11 & 7) << 4) + ((X11 & 7) << 1)); \
-                            TYPE p4 = COLORFUNC; \
-                            TYPE theColor = Q_INTERPOLATE(p1, p2, p3, p4); \
-                            *p = (FUNC) | ALPHA_BITS_MASK; \
-                            *d = GFX.Z1; \
-                        } \
-                    } \
-                } \
-            } \
-            else \
-            { \
-                for (int x = startx; x != endx; x += dir, AA += aa, CC += cc, p++, d++) \
-                { \
-                    uint32 xPos = AA + BB; \
-                    uint32 xPix = xPos >> 8; \
-                    uint32 yPos = CC + DD; \
-                    uint32 yPix = yPos >> 8; \
-                    uint32 X = xPix; \
-                    uint32 Y = yPix; \
-                    \
-\
-		    if(Settings.Dezaemon && PPU.Mode7Repeat == 2) \
-		    { \
-			X &= 0x7ff; \
-			Y &= 0x7ff; \
-		    } \
-\
-                    if (((X | Y) & ~0x3ff) == 0) \
-                    { \
-                        uint8 *TileData = VRAM1 + (Memory.VRAM[((Y & ~7) << 5) + ((X >> 2) & ~1)] << 7); \
-			uint32 b = *(TileData + ((Y & 7) << 4) + ((X & 7) << 1)); \
-			GFX.Z1 = Mode7Depths [(b & GFX.Mode7PriorityMask) >> 7]; \
-                        if (GFX.Z1 > *d && b) \
-                        { \
-                            /* X10 and Y01 are the X and Y coordinates of the next source point over. */ \
-                            uint32 X10 = (xPix + dir) & 0x3ff; \
-                            uint32 Y01 = (yPix + dir) & 0x3ff; \
-                            uint8 *TileData10 = VRAM1 + (Memory.VRAM[((Y & ~7) << 5) + ((X10 >> 2) & ~1)] << 7); \
-                            uint8 *TileData11 = VRAM1 + (Memory.VRAM[((Y01 & ~7) << 5) + ((X10 >> 2) & ~1)] << 7); \
-                            uint8 *TileData01 = VRAM1 + (Memory.VRAM[((Y01 & ~7) << 5) + ((X >> 2) & ~1)] << 7); \
-                            uint32 p1 = COLORFUNC; \
-                            p1 = (p1 & FIRST_THIRD_COLOR_MASK) | ((p1 & SECOND_COLOR_MASK) << 16); \
-                            b = *(TileData10 + ((Y & 7) << 4) + ((X10 & 7) << 1)); \
-                            uint32 p2 = COLORFUNC; \
-                            p2 = (p2 & FIRST_THIRD_COLOR_MASK) | ((p2 & SECOND_COLOR_MASK) << 16); \
-                            b = *(TileData11 + ((Y01 & 7) << 4) + ((X10 & 7) << 1)); \
-                            uint32 p4 = COLORFUNC; \
-                            p4 = (p4 & FIRST_THIRD_COLOR_MASK) | ((p4 & SECOND_COLOR_MASK) << 16); \
-                            b = *(TileData01 + ((Y01 & 7) << 4) + ((X & 7) << 1)); \
-                            uint32 p3 = COLORFUNC; \
-                            p3 = (p3 & FIRST_THIRD_COLOR_MASK) | ((p3 & SECOND_COLOR_MASK) << 16); \
-                            /* Xdel, Ydel: position (in 1/32nds) between the points */ \
-                            uint32 Xdel = (xPos >> 3) & 0x1F; \
-                            uint32 Ydel = (yPos >> 3) & 0x1F; \
-                            uint32 XY = (Xdel*Ydel) >> 5; \
-                            uint32 area1 = 0x20 + XY - Xdel - Ydel; \
-                            uint32 area2 = Xdel - XY; \
-                            uint32 area3 = Ydel - XY; \
-                            uint32 area4 = XY; \
-                            uint32 tempColor = ((area1 * p1) + \
-                                                (area2 * p2) + \
-                                                (area3 * p3) + \
-                                                (area4 * p4)) >> 5; \
-                            TYPE theColor = (tempColor & FIRST_THIRD_COLOR_MASK) | ((tempColor >> 16) & SECOND_COLOR_MASK); \
-                            *p = (FUNC) | ALPHA_BITS_MASK; \
-                            *d = GFX.Z1; \
-                        } \
-                    } \
-                    else \
-                    { \
-                        if (PPU.Mode7Repeat == 3) \
-                        { \
-                            X = (x + HOffset) & 7; \
-                            Y = (yy + CentreY) & 7; \
-			    uint32 b = *(VRAM1 + ((Y & 7) << 4) + ((X & 7) << 1)); \
-			    GFX.Z1 = Mode7Depths [(b & GFX.Mode7PriorityMask) >> 7]; \
-                            if (GFX.Z1 > *d && b) \
-                            { \
-                                TYPE theColor = COLORFUNC; \
-                                *p = (FUNC) | ALPHA_BITS_MASK; \
-                                *d = GFX.Z1; \
-                            } \
-                        } \
-                    } \
-                } \
-            } \
-        } \
+/* Sets b to the Width pixels of S, and Off, if any, to 1 where they are
+ * off the map. */
+static INLINE void Mode7Fetch (const struct Mode7Span *S, int Width,
+			const uint8 *VRAM1, uint8 *b, uint8 *Off)
+{
+    uint32 Addr [4];
+    uint32 In [4];
+    uint32 OutMask = S->CoordMask & ~0x3ff;
+    const uint8 *VRAM = GFX.VRAM;
+
+#if defined(__SSE2__)
+    const __m128i cm = _mm_set1_epi32 (S->CoordMask);
+    const __m128i om = _mm_set1_epi32 (OutMask);
+    __m128i xp = _mm_setr_epi32 (S->XPos, S->XPos + S->aa,
+				 S->XPos + 2 * S->aa, S->XPos + 3 * S->aa);
+    __m128i yp = _mm_setr_epi32 (S->YPos, S->YPos + S->cc,
+				 S->YPos + 2 * S->cc, S->YPos + 3 * S->cc);
+    const __m128i xs = _mm_set1_epi32 (4 * S->aa);
+    const __m128i ys = _mm_set1_epi32 (4 * S->cc);
+#elif defined(__ARM_NEON__)
+    const uint32x4_t cm = vdupq_n_u32 (S->CoordMask);
+    const uint32x4_t om = vdupq_n_u32 (OutMask);
+    const uint32 xi [4] = {
+	S->XPos, S->XPos + S->aa, S->XPos + 2 * S->aa, S->XPos + 3 * S->aa
+    };
+    const uint32 yi [4] = {
+	S->YPos, S->YPos + S->cc, S->YPos + 2 * S->cc, S->YPos + 3 * S->cc
+    };
+    int32x4_t xp = vreinterpretq_s32_u32 (vld1q_u32 (xi));
+    int32x4_t yp = vreinterpretq_s32_u32 (vld1q_u32 (yi));
+    const int32x4_t xs = vdupq_n_s32 (4 * S->aa);
+    const int32x4_t ys = vdupq_n_s32 (4 * S->cc);
+#endif
+
+    for (int i = 0; i < Width; i += 4)
+    {
+#if defined(__SSE2__)
+	__m128i X = _mm_and_si128 (_mm_srai_epi32 (xp, 8), cm);
+	__m128i Y = _mm_and_si128 (_mm_srai_epi32 (yp, 8), cm);
+	__m128i map = _mm_or_si128 (
+	    _mm_slli_epi32 (_mm_and_si128 (Y, _mm_set1_epi32 (0x3f8)), 5),
+	    _mm_and_si128 (_mm_srli_epi32 (X, 2), _mm_set1_epi32 (0xfe)));
+	__m128i pix = _mm_or_si128 (
+	    _mm_slli_epi32 (_mm_and_si128 (Y, _mm_set1_epi32 (7)), 4),
+	    _mm_slli_epi32 (_mm_and_si128 (X, _mm_set1_epi32 (7)), 1));
+
+	_mm_storeu_si128 ((__m128i *) Addr,
+			  _mm_or_si128 (map, _mm_slli_epi32 (pix, 16)));
+	_mm_storeu_si128 ((__m128i *) In,
+			  _mm_cmpeq_epi32 (_mm_and_si128 (_mm_or_si128 (X, Y), om),
+					   _mm_setzero_si128 ()));
+	xp = _mm_add_epi32 (xp, xs);
+	yp = _mm_add_epi32 (yp, ys);
+#elif defined(__ARM_NEON__)
+	uint32x4_t X = vandq_u32 (vreinterpretq_u32_s32 (vshrq_n_s32 (xp, 8)), cm);
+	uint32x4_t Y = vandq_u32 (vreinterpretq_u32_s32 (vshrq_n_s32 (yp, 8)), cm);
+	uint32x4_t map = vorrq_u32 (
+	    vshlq_n_u32 (vandq_u32 (Y, vdupq_n_u32 (0x3f8)), 5),
+	    vandq_u32 (vshrq_n_u32 (X, 2), vdupq_n_u32 (0xfe)));
+	uint32x4_t pix = vorrq_u32 (
+	    vshlq_n_u32 (vandq_u32 (Y, vdupq_n_u32 (7)), 4),
+	    vshlq_n_u32 (vandq_u32 (X, vdupq_n_u32 (7)), 1));
+
+	vst1q_u32 (Addr, vorrq_u32 (map, vshlq_n_u32 (pix, 16)));
+	vst1q_u32 (In, vceqq_u32 (vandq_u32 (vorrq_u32 (X, Y), om),
+				  vdupq_n_u32 (0)));
+	xp = vaddq_s32 (xp, xs);
+	yp = vaddq_s32 (yp, ys);
+#else
+	for (int j = 0; j < 4; j++)
+	{
+	    uint32 X = ((int32) (S->XPos + (i + j) * S->aa) >> 8) & S->CoordMask;
+	    uint32 Y = ((int32) (S->YPos + (i + j) * S->cc) >> 8) & S->CoordMask;
+
+	    Addr [j] = ((Y & 0x3f8) << 5) | ((X >> 2) & 0xfe) |
+		       ((((Y & 7) << 4) | ((X & 7) << 1)) << 16);
+	    In [j] = ((X | Y) & OutMask) == 0;
+	}
+#endif
+
+	int n = Width - i < 4 ? Width - i : 4;
+	if (!OutMask)
+	{
+	    // Wrapping round, nothing is ever off the map
+	    for (int j = 0; j < n; j++)
+	    {
+		b [i + j] = VRAM1 [(VRAM [Addr [j] & 0xffff] << 7) +
+				   (Addr [j] >> 16)];
+		if (Off)
+		    Off [i + j] = 0;
+	    }
+	    continue;
+	}
+
+	// Off-map addresses still point into VRAM, so fetch both and pick
+	for (int j = 0; j < n; j++)
+	{
+	    uint8 on = VRAM1 [(VRAM [Addr [j] & 0xffff] << 7) + (Addr [j] >> 16)];
+	    uint8 off = S->Tile0 [(S->Tile0X + (i + j) * S->dir) & 7];
+
+	    b [i + j] = In [j] ? on : off;
+	    if (Off)
+		Off [i + j] = !In [j];
+	}
     }
+}
+
+/* Spreads a colour out so that four of them weighted by up to 32 add up
+ * without carrying from one field into the next. */
+#define MODE7_SPREAD(C) \
+    (((C) & FIRST_THIRD_COLOR_MASK) | (((C) & SECOND_COLOR_MASK) << 16))
 
 STATIC uint32 Q_INTERPOLATE(uint32 A, uint32 B, uint32 C, uint32 D)
 {
@@ -2645,75 +2447,368 @@ STATIC uint32 Q_INTERPOLATE(uint32 A, uint32 B, uint32 C, uint32 D)
     return x+y;
 }
 
-void DrawBGMode7Background16_i (uint8 *Screen, int bg)
+enum
 {
-    RENDER_BACKGROUND_MODE7_i (uint16, theColor, (GFX.ScreenColors[b & GFX.Mode7Mask]));
-}
-
-void DrawBGMode7Background16Add_i (uint8 *Screen, int bg)
+    MODE7_OPAQUE,		// Replace the pixels under it
+    MODE7_MATH,			// Add to or subtract from the sub screen
+    MODE7_MATH_HALF		// ... and halve the result
+};
+
+/* Draws BG bg in Mode 7. Smooth interpolates between the map's pixels:
+ * bilinearly when the screen is magnified, by averaging four samples when
+ * not, and not at all with the identity matrix. */
+template <int Math, bool Smooth>
+static void DrawMode7 (uint8 *Screen, int bg)
 {
-    RENDER_BACKGROUND_MODE7_i (uint16, *(d + GFX.DepthDelta) ?
-					(*(d + GFX.DepthDelta) != 1 ?
-					    (COLOR_ADD (theColor,
-						       p [GFX.Delta])) :
-					    (COLOR_ADD (theColor,
-						       GFX.FixedColour))) :
-					 theColor, (GFX.ScreenColors[b & GFX.Mode7Mask]));
-}
+    CHECK_SOUND();
 
-void DrawBGMode7Background16Add1_2_i (uint8 *Screen, int bg)
-{
-    RENDER_BACKGROUND_MODE7_i (uint16, *(d + GFX.DepthDelta) ?
-					(*(d + GFX.DepthDelta) != 1 ?
-					    COLOR_ADD1_2 (theColor,
-						          p [GFX.Delta]) :
-					    COLOR_ADD (theColor,
-						       GFX.FixedColour)) :
-					 theColor, (GFX.ScreenColors[b & GFX.Mode7Mask]));
-}
+    uint8 * const VRAM1 = GFX.VRAM + 1;
+    if (GFX.r2130 & 1)
+    {
+	if (IPPU.DirectColourMapsNeedRebuild)
+	    S9xBuildDirectColourMaps ();
+	GFX.ScreenColors = DirectColourMaps [0];
+    }
+    else
+	GFX.ScreenColors = IPPU.ScreenColors;
+
+    uint32 Left = 0;
+    uint32 Right = 256;
+    uint32 ClipCount = GFX.pCurrentClip->Count [bg];
+
+    if (!ClipCount)
+	ClipCount = 1;
+
+    Screen += GFX.StartY * GFX.Pitch;
+    uint8 *Depth = GFX.DB + GFX.StartY * GFX.PPL;
+    struct SLineMatrixData *l = &LineMatrixData [GFX.StartY];
+
+    // Make a special case for the identity matrix, since it's a common case
+    // and can be done much more quickly without special effects
+    bool8_32 allowSimpleCase = Smooth &&
+	!l->MatrixB && !l->MatrixC && l->MatrixA == 0x0100 && l->MatrixD == 0x0100 &&
+	!LineMatrixData [GFX.EndY].MatrixB && !LineMatrixData [GFX.EndY].MatrixC &&
+	LineMatrixData [GFX.EndY].MatrixA == 0x0100 &&
+	LineMatrixData [GFX.EndY].MatrixD == 0x0100;
+
+    // The loops store bytes, which could be anything as far as the compiler
+    // knows
+    const uint16 *Colours = GFX.ScreenColors;
+    const uint32 Mask = GFX.Mode7Mask;
+    const uint32 PriorityMask = GFX.Mode7PriorityMask;
+    const uint8 Depths [2] = { Mode7Depths [0], Mode7Depths [1] };
+
+    uint16 Fixed [256];
+    if (Math != MODE7_OPAQUE)
+	for (int x = 0; x < 256; x++)
+	    Fixed [x] = (uint16) GFX.FixedColour;
+
+    for (uint32 Line = GFX.StartY; Line <= GFX.EndY;
+	 Line++, Screen += GFX.Pitch, Depth += GFX.PPL, l++)
+    {
+	int32 HOffset = ((int32) LineData [Line].BG[0].HOffset << M7) >> M7;
+	int32 VOffset = ((int32) LineData [Line].BG[0].VOffset << M7) >> M7;
 
-void DrawBGMode7Background16Sub_i (uint8 *Screen, int bg)
-{
-    RENDER_BACKGROUND_MODE7_i (uint16, *(d + GFX.DepthDelta) ?
-					(*(d + GFX.DepthDelta) != 1 ?
-					    COLOR_SUB (theColor,
-						       p [GFX.Delta]) :
-					    COLOR_SUB (theColor,
-						       GFX.FixedColour)) :
-					 theColor, (GFX.ScreenColors[b & GFX.Mode7Mask]));
-}
+	int32 CentreX = ((int32) l->CentreX << M7) >> M7;
+	int32 CentreY = ((int32) l->CentreY << M7) >> M7;
 
-void DrawBGMode7Background16Sub1_2_i (uint8 *Screen, int bg)
-{
-    RENDER_BACKGROUND_MODE7_i (uint16, *(d + GFX.DepthDelta) ?
-					(*(d + GFX.DepthDelta) != 1 ?
-					    COLOR_SUB1_2 (theColor,
-						       p [GFX.Delta]) :
-					    COLOR_SUB (theColor,
-						       GFX.FixedColour)) :
-					 theColor, (GFX.ScreenColors[b & GFX.Mode7Mask]));
-}
+	int yy = PPU.Mode7VFlip ? 261 - (int) Line : (int) Line;
 
-#define _BUILD_SETUP(F) \
-GFX.BuildPixel = BuildPixel##F; \
-GFX.BuildPixel2 = BuildPixel2##F; \
-GFX.DecomposePixel = DecomposePixel##F; \
-RED_LOW_BIT_MASK = RED_LOW_BIT_MASK_##F; \
-GREEN_LOW_BIT_MASK = GREEN_LOW_BIT_MASK_##F; \
-BLUE_LOW_BIT_MASK = BLUE_LOW_BIT_MASK_##F; \
-RED_HI_BIT_MASK = RED_HI_BIT_MASK_##F; \
-GREEN_HI_BIT_MASK = GREEN_HI_BIT_MASK_##F; \
-BLUE_HI_BIT_MASK = BLUE_HI_BIT_MASK_##F; \
-MAX_RED = MAX_RED_##F; \
-MAX_GREEN = MAX_GREEN_##F; \
-MAX_BLUE = MAX_BLUE_##F; \
-GREEN_HI_BIT = ((MAX_GREEN_##F + 1) >> 1); \
-SPARE_RGB_BIT_MASK = SPARE_RGB_BIT_MASK_##F; \
-RGB_LOW_BITS_MASK = (RED_LOW_BIT_MASK_##F | \
- 		     GREEN_LOW_BIT_MASK_##F | \
-		     BLUE_LOW_BIT_MASK_##F); \
-RGB_HI_BITS_MASK = (RED_HI_BIT_MASK_##F | \
-		    GREEN_HI_BIT_MASK_##F | \
+	if (PPU.Mode7Repeat == 0)
+	    yy += (VOffset - CentreY) % 1023;
+	else
+	    yy += VOffset - CentreY;
+
+	bool8_32 simpleCase = allowSimpleCase && !l->MatrixB && !l->MatrixC &&
+			      l->MatrixA == 0x0100 && l->MatrixD == 0x0100;
+	int BB = l->MatrixB * yy + (CentreX << 8);
+	int DD = l->MatrixD * yy + (CentreY << 8);
+
+	for (uint32 clip = 0; clip < ClipCount; clip++)
+	{
+	    if (GFX.pCurrentClip->Count [bg])
+	    {
+		Left = GFX.pCurrentClip->Left [clip][bg];
+		Right = GFX.pCurrentClip->Right [clip][bg];
+		if (Right <= Left)
+		    continue;
+	    }
+
+	    uint16 *p = (uint16 *) Screen + Left;
+	    uint8 *d = Depth + Left;
+	    int Width = Right - Left;
+	    int startx, dir, aa, cc;
+
+	    if (PPU.Mode7HFlip)
+	    {
+		startx = Right - 1;
+		dir = -1;
+		aa = -l->MatrixA;
+		cc = -l->MatrixC;
+	    }
+	    else
+	    {
+		startx = Left;
+		dir = 1;
+		aa = l->MatrixA;
+		cc = l->MatrixC;
+	    }
+
+	    int xx;
+	    if (PPU.Mode7Repeat == 0)
+		xx = startx + (HOffset - CentreX) % 1023;
+	    else
+		xx = startx + HOffset - CentreX;
+
+	    int AA = l->MatrixA * xx;
+	    int CC = l->MatrixC * xx;
+
+	    // Shrunk, the smoothed screen averages the corners of a square
+	    // centred where the pixel would have been
+	    bool8_32 bilinear = aa < 460 && aa > -460 && cc < 460 && cc > -460;
+	    uint32 BB10 = 0, BB01 = 0, BB11 = 0, DD10 = 0, DD01 = 0, DD11 = 0;
+
+	    if (Smooth && !simpleCase && !PPU.Mode7Repeat && !bilinear)
+	    {
+		uint32 aaDelX = aa >> 1;
+		uint32 ccDelX = cc >> 1;
+		uint32 bbDelY = l->MatrixB >> 1;
+		uint32 ddDelY = l->MatrixD >> 1;
+
+		BB -= (bbDelY >> 1);
+		DD -= (ddDelY >> 1);
+		AA -= (aaDelX >> 1);
+		CC -= (ccDelX >> 1);
+		BB10 = BB + aaDelX;
+		BB01 = BB + bbDelY;
+		BB11 = BB + aaDelX + bbDelY;
+		DD10 = DD + ccDelX;
+		DD01 = DD + ddDelY;
+		DD11 = DD + ccDelX + ddDelY;
+	    }
+
+	    struct Mode7Span S;
+
+	    S.XPos = AA + BB;
+	    S.YPos = CC + DD;
+	    S.aa = aa;
+	    S.cc = cc;
+	    if (PPU.Mode7Repeat == 0)
+		S.CoordMask = 0x3ff;
+	    else
+	    if (Smooth)
+		S.CoordMask = Settings.Dezaemon && PPU.Mode7Repeat == 2 ?
+			      0x7ff : 0xffffffff;
+	    else
+		S.CoordMask = Settings.Dezaemon ? 0x7ff : 0xffff;
+	    for (int x = 0; x < 8; x++)
+		S.Tile0 [x] = PPU.Mode7Repeat != 3 ? 0 :
+			      VRAM1 [(((yy + CentreY) & 7) << 4) + (x << 1)];
+	    S.Tile0X = startx + HOffset;
+	    S.dir = dir;
+
+	    uint8 b [256];
+	    uint8 Off [256];
+	    uint8 Drawn [256];
+
+	    Mode7Fetch (&S, Width, VRAM1, b,
+			Smooth && !simpleCase ? Off : NULL);
+
+	    if (!Smooth || simpleCase)
+	    {
+		for (int x = 0; x < Width; x++)
+		{
+		    uint8 z = Depths [(b [x] & PriorityMask) >> 7];
+		    uint16 c = Colours [b [x] & Mask];
+
+		    Drawn [x] = (z > d [x]) & (b [x] != 0);
+		    d [x] = Drawn [x] ? z : d [x];
+		    p [x] = Drawn [x] ? c : p [x];
+		}
+	    }
+	    else
+	    for (int x = 0; x < Width; x++, AA += aa, CC += cc)
+	    {
+		uint8 z = Depths [(b [x] & PriorityMask) >> 7];
+
+		Drawn [x] = z > d [x] && b [x];
+		if (!Drawn [x])
+		    continue;
+		d [x] = z;
+
+		if (Off [x])
+		{
+		    p [x] = Colours [b [x] & Mask];
+		    continue;
+		}
+
+		if (PPU.Mode7Repeat || bilinear)
+		{
+		    // The bilinear interpolator: get the colours at the four
+		    // points around the one in the map, and weight them by
+		    // their (city block) distance from it
+		    uint32 xPos = AA + BB;
+		    uint32 xPix = xPos >> 8;
+		    uint32 yPos = CC + DD;
+		    uint32 yPix = yPos >> 8;
+		    uint32 X = xPix & 0x3ff;
+		    uint32 Y = yPix & 0x3ff;
+		    uint32 X10 = (xPix + dir) & 0x3ff;
+		    uint32 Y01 = (yPix + dir) & 0x3ff;
+		    uint32 p1 = Colours [b [x] & Mask];
+		    uint32 p2 = Colours [Mode7Pixel (VRAM1, X10, Y) & Mask];
+		    uint32 p4 = Colours [Mode7Pixel (VRAM1, X10, Y01) & Mask];
+		    uint32 p3 = Colours [Mode7Pixel (VRAM1, X, Y01) & Mask];
+
+		    p1 = MODE7_SPREAD(p1);
+		    p2 = MODE7_SPREAD(p2);
+		    p3 = MODE7_SPREAD(p3);
+		    p4 = MODE7_SPREAD(p4);
+
+		    // Xdel, Ydel: position (in 1/32nds) between the points
+		    uint32 Xdel = (xPos >> 3) & 0x1F;
+		    uint32 Ydel = (yPos >> 3) & 0x1F;
+		    uint32 XY = (Xdel*Ydel) >> 5;
+		    uint32 area1 = 0x20 + XY - Xdel - Ydel;
+		    uint32 area2 = Xdel - XY;
+		    uint32 area3 = Ydel - XY;
+		    uint32 area4 = XY;
+		    uint32 tempColor = ((area1 * p1) +
+					(area2 * p2) +
+					(area3 * p3) +
+					(area4 * p4)) >> 5;
+
+		    p [x] = (tempColor & FIRST_THIRD_COLOR_MASK) |
+			    ((tempColor >> 16) & SECOND_COLOR_MASK);
+		}
+		else
+		{
+		    uint32 X10 = ((AA + BB10) >> 8) & 0x3ff;
+		    uint32 Y10 = ((CC + DD10) >> 8) & 0x3ff;
+		    uint32 X01 = ((AA + BB01) >> 8) & 0x3ff;
+		    uint32 Y01 = ((CC + DD01) >> 8) & 0x3ff;
+		    uint32 X11 = ((AA + BB11) >> 8) & 0x3ff;
+		    uint32 Y11 = ((CC + DD11) >> 8) & 0x3ff;
+
+		    p [x] = Q_INTERPOLATE (
+			Colours [b [x] & Mask],
+			Colours [Mode7Pixel (VRAM1, X10, Y10) & Mask],
+			Colours [Mode7Pixel (VRAM1, X01, Y01) & Mask],
+			Colours [Mode7Pixel (VRAM1, X11, Y11) & Mask]);
+		}
+	    }
+
+	    if (Math != MODE7_OPAQUE)
+	    {
+		// Over the fixed colour, the colour math is never halved, so
+		// unless it is halving it can blend with both in one pass
+		uint8 OverSub [256];
+		uint8 OverFixed [256];
+		uint16 Sub [256];
+		uint8 *sd = d + GFX.DepthDelta;
+		uint16 *s = p + GFX.Delta;
+
+		if (Math == MODE7_MATH)
+		{
+		    for (int x = 0; x < Width; x++)
+		    {
+			OverSub [x] = Drawn [x] & (sd [x] != 0);
+			Sub [x] = sd [x] > 1 ? s [x] : Fixed [x];
+		    }
+		    BlendLine (p, p, Sub, OverSub, Width, FALSE);
+		}
+		else
+		{
+		    for (int x = 0; x < Width; x++)
+		    {
+			OverSub [x] = Drawn [x] & (sd [x] > 1);
+			OverFixed [x] = Drawn [x] & (sd [x] == 1);
+		    }
+		    BlendLine (p, p, s, OverSub, Width, TRUE);
+		    BlendLine (p, p, Fixed, OverFixed, Width, FALSE);
+		}
+	    }
+
+	    if (Smooth && ALPHA_BITS_MASK)
+		for (int x = 0; x < Width; x++)
+		    if (Drawn [x])
+			p [x] |= ALPHA_BITS_MASK;
+	}
+    }
+}
+
+#undef MODE7_SPREAD
+
+void DrawBGMode7Background16 (uint8 *Screen, int bg)
+{
+    DrawMode7<MODE7_OPAQUE, false> (Screen, bg);
+}
+
+void DrawBGMode7Background16Add (uint8 *Screen, int bg)
+{
+    DrawMode7<MODE7_MATH, false> (Screen, bg);
+}
+
+void DrawBGMode7Background16Add1_2 (uint8 *Screen, int bg)
+{
+    DrawMode7<MODE7_MATH_HALF, false> (Screen, bg);
+}
+
+void DrawBGMode7Background16Sub (uint8 *Screen, int bg)
+{
+    DrawMode7<MODE7_MATH, false> (Screen, bg);
+}
+
+void DrawBGMode7Background16Sub1_2 (uint8 *Screen, int bg)
+{
+    DrawMode7<MODE7_MATH_HALF, false> (Screen, bg);
+}
+
+void DrawBGMode7Background16_i (uint8 *Screen, int bg)
+{
+    DrawMode7<MODE7_OPAQUE, true> (Screen, bg);
+}
+
+void DrawBGMode7Background16Add_i (uint8 *Screen, int bg)
+{
+    DrawMode7<MODE7_MATH, true> (Screen, bg);
+}
+
+void DrawBGMode7Background16Add1_2_i (uint8 *Screen, int bg)
+{
+    DrawMode7<MODE7_MATH_HALF, true> (Screen, bg);
+}
+
+void DrawBGMode7Background16Sub_i (uint8 *Screen, int bg)
+{
+    DrawMode7<MODE7_MATH, true> (Screen, bg);
+}
+
+void DrawBGMode7Background16Sub1_2_i (uint8 *Screen, int bg)
+{
+    DrawMode7<MODE7_MATH_HALF, true> (Screen, bg);
+}
+
+#define _BUILD_SETUP(F) \
+GFX.BuildPixel = BuildPixel##F; \
+GFX.BuildPixel2 = BuildPixel2##F; \
+GFX.DecomposePixel = DecomposePixel##F; \
+RED_LOW_BIT_MASK = RED_LOW_BIT_MASK_##F; \
+GREEN_LOW_BIT_MASK = GREEN_LOW_BIT_MASK_##F; \
+BLUE_LOW_BIT_MASK = BLUE_LOW_BIT_MASK_##F; \
+RED_HI_BIT_MASK = RED_HI_BIT_MASK_##F; \
+GREEN_HI_BIT_MASK = GREEN_HI_BIT_MASK_##F; \
+BLUE_HI_BIT_MASK = BLUE_HI_BIT_MASK_##F; \
+MAX_RED = MAX_RED_##F; \
+MAX_GREEN = MAX_GREEN_##F; \
+MAX_BLUE = MAX_BLUE_##F; \
+GREEN_HI_BIT = ((MAX_GREEN_##F + 1) >> 1); \
+SPARE_RGB_BIT_MASK = SPARE_RGB_BIT_MASK_##F; \
+RGB_LOW_BITS_MASK = (RED_LOW_BIT_MASK_##F | \
+ 		     GREEN_LOW_BIT_MASK_##F | \
+		     BLUE_LOW_BIT_MASK_##F); \
+RGB_HI_BITS_MASK = (RED_HI_BIT_MASK_##F | \
+		    GREEN_HI_BIT_MASK_##F | \
 		    BLUE_HI_BIT_MASK_##F); \
 RGB_HI_BITS_MASKx2 = ((RED_HI_BIT_MASK_##F | \
 		       GREEN_HI_BIT_MASK_##F | \
@@ -2780,7 +2875,7 @@ void RenderScreen (uint8 *Screen, bool8_32 sub, bool8_32 force_no_add, uint8 D)
 	{
 	    SelectTileRenderer (sub || !SUB_OR_ADD(2));
 	    DrawBackground (PPU.BGMode, 2, D + 3, 
-			    (Memory.FillRAM [0x2105] & 8) == 0 ? D + 6 : D + 17);
+			    (GFX.FillRAM [0x2105] & 8) == 0 ? D + 6 : D + 17);
 	}
 	if (BG3 && PPU.BGMode == 0)
 	{
@@ -2813,11 +2908,11 @@ void RenderScreen (uint8 *Screen, bool8_32 sub, bool8_32 force_no_add, uint8 D)
 	    SelectTileRenderer (sub || !SUB_OR_ADD(4));
 	    DrawOBJS (!sub, D);
 	}
-	if (BG0 || ((Memory.FillRAM [0x2133] & 0x40) && BG1))
+	if (BG0 || ((GFX.FillRAM [0x2133] & 0x40) && BG1))
 	{
 	    int bg;
 
-	    if (Memory.FillRAM [0x2133] & 0x40)
+	    if (GFX.FillRAM [0x2133] & 0x40)
 	    {
 		GFX.Mode7Mask = 0x7f;
 		GFX.Mode7PriorityMask = 0x80;
@@ -2956,79 +3051,585 @@ static void S9xDisplayString(const char *string)
     }
 }
 
-void S9xUpdateScreen () // ~30-50ms! (called from FLUSH_REDRAW())
+/* The line renderer draws the screen a line at a time rather than a layer
+ * at a time. Each layer's line is fetched once as palette indices and
+ * depths, merged through its window into small main and sub screen lines
+ * that keep the index, depth and colour math of the top pixel, and only the
+ * final pass looks the two up in the palette and blends them. It gives what
+ * RenderScreen and the backdrop passes of S9xDrawLines give, fixed colour
+ * and colour window quirks included, without their z-buffers; the modes it
+ * has no line fetch for (mosaic, offset per tile, hi-res, direct colour and
+ * Mode 7) are left to them. */
+
+#define LINE_WIDTH 256
+// Room either side of a fetched line for the tiles it only partly shows
+#define LINE_PAD 8
+
+#define LINE_BYTES(b) ((b) * 0x0101010101010101ULL)
+
+struct LineScreen
 {
-    int32 x2 = 1;
+    uint8 Pixels [LINE_WIDTH];	/// Palette index of the top pixel
+    uint8 Depth [LINE_WIDTH];	/// Depth of the top pixel, 0 (1 for the fixed colour) if none
+    uint8 Math [LINE_WIDTH];	/// 1 if colour math applies to the top pixel
+};
 
-    GFX.S = GFX.Screen;
+struct LineLayer
+{
+    int Layer;			/// 0-3 for BG1-4, 4 for the sprites
+    uint8 Depths [2];		/// Depths of the low and high priority tiles
+    bool8_32 Main;
+    bool8_32 Sub;
+    uint32 MathFrom;		/// Lowest palette index colour math applies to
+    struct SBG BG;
+};
+
+static void LineSetupBackground (struct LineLayer *L, uint32 BGMode, int bg,
+				 uint8 Z1, uint8 Z2)
+{
+    L->Layer = bg;
+    L->Depths [0] = Z1;
+    L->Depths [1] = Z2;
+    L->MathFrom = SUB_OR_ADD(bg) ? 0 : 256;
+
+    L->BG.TileSize = BGSizes [PPU.BG[bg].BGSize];
+    L->BG.BitShift = BitShifts[BGMode][bg];
+    L->BG.TileShift = TileShifts[BGMode][bg];
+    L->BG.TileAddress = PPU.BG[bg].NameBase << 1;
+    L->BG.NameSelect = 0;
+    L->BG.SCBase = PPU.BG[bg].SCBase;
+    L->BG.Buffer = IPPU.TileCache [Depths [BGMode][bg]];
+    L->BG.Buffered = IPPU.TileCached [Depths [BGMode][bg]];
+    L->BG.PaletteShift = PaletteShifts[BGMode][bg];
+    L->BG.PaletteMask = PaletteMasks[BGMode][bg];
+    L->BG.StartPalette = BGMode == 0 ? bg << 5 : 0;
+    L->BG.DirectColourMode = FALSE;
+}
 
-	unsigned char *memoryfillram = Memory.FillRAM;
+static void LineSetupOBJS (struct LineLayer *L)
+{
+    L->Layer = 4;
+    L->Depths [0] = L->Depths [1] = 0;
+    // Only the sprites with palettes 4-7 take part in colour math
+    L->MathFrom = SUB_OR_ADD(4) ? (GFX.Pseudo ? 0 : 128 + (4 << 4)) : 256;
+
+    L->BG.TileSize = 8;
+    L->BG.BitShift = 4;
+    L->BG.TileShift = 5;
+    L->BG.TileAddress = PPU.OBJNameBase;
+    L->BG.NameSelect = PPU.OBJNameSelect;
+    L->BG.SCBase = 0;
+    L->BG.Buffer = IPPU.TileCache [TILE_4BIT];
+    L->BG.Buffered = IPPU.TileCached [TILE_4BIT];
+    L->BG.PaletteShift = 4;
+    L->BG.PaletteMask = 7;
+    L->BG.StartPalette = 128;
+    L->BG.DirectColourMode = FALSE;
+}
 
-	// get local copies of vid registers to be used later
-    GFX.r2131 = memoryfillram [0x2131]; // ADDITION/SUBTRACTION & SUBTRACTION DESIGNATION FOR EACH SCREEN 
-    GFX.r212c = memoryfillram [0x212c]; // MAIN SCREEN, DESIGNATION - used to enable BGS
-    GFX.r212d = memoryfillram [0x212d]; // SUB SCREEN DESIGNATION - used to enable sub BGS
-    GFX.r2130 = memoryfillram [0x2130]; // INITIAL SETTINGS FOR FIXED COLOR ADDITION OR SCREEN ADDITION
-	
-	// If external sync is off and
-	// main screens have not been configured the same as the sub screen and
-	// color addition and subtraction has been diabled then
-	// Pseudo is 1
-	// anything else it is 0
-	GFX.Pseudo = (memoryfillram [0x2133] & 8) != 0 && // Use EXTERNAL SYNCHRONIZATION?
-		 (GFX.r212c & 15) != (GFX.r212d & 15) && // Are the main screens different from the sub screens?
-		 (GFX.r2131 & 0x3f) == 0; // Is colour data addition/subtraction disabled on all BGS?
+/* Returns the 0x01 bytes of v that are not 0. */
+static INLINE uint64_t LineOpaque (uint64_t v)
+{
+    return ((v | ((v & LINE_BYTES(0x7f)) + LINE_BYTES(0x7f))) >> 7) &
+	   LINE_BYTES(0x01);
+}
 
-	// If sprite data has been changed then go through and 
-	// refresh the sprites.
-    if (IPPU.OBJChanged)
-	{	
-		S9xSetupOBJ ();
+/* Returns the 8 pixels of line StartLine (times 8) of Tile the way
+ * RENDER_TILE draws them, as palette indices with 0 for transparent. */
+static INLINE uint64_t LineTile (uint32 Tile, uint32 StartLine)
+{
+    uint8 *bp = GetCachedTile (Tile);
+    uint64_t Pixels;
+
+    if (!bp)
+	return 0;
+
+    memcpy (&Pixels, bp + ((Tile & V_FLIP) ? 56 - StartLine : StartLine), 8);
+    if (Tile & H_FLIP)
+	Pixels = __builtin_bswap64 (Pixels);
+
+    // Palette indices fit a byte, so the palette adds without carries
+    uint32 Palette = (((Tile >> 10) & BG.PaletteMask) << BG.PaletteShift) +
+		     BG.StartPalette;
+    return Pixels + LineOpaque (Pixels) * Palette;
+}
+
+/* Fetches line Y of BG bg the way DrawBackground draws it. Returns FALSE if
+ * none of it shows. */
+static bool8_32 LineBackground (const struct LineLayer *L, uint32 Y,
+				uint8 *Pixels, uint8 *Depth)
+{
+    int bg = L->Layer;
+    uint16 *SC0;
+    uint16 *SC1;
+    uint16 *SC2;
+    uint16 *SC3;
+
+    SC0 = (uint16 *) &GFX.VRAM[L->BG.SCBase << 1];
+
+    if (PPU.BG[bg].SCSize & 1)
+	SC1 = SC0 + 1024;
+    else
+	SC1 = SC0;
+
+    if (PPU.BG[bg].SCSize & 2)
+	SC2 = SC1 + 1024;
+    else
+	SC2 = SC0;
+
+    if (PPU.BG[bg].SCSize & 1)
+	SC3 = SC2 + 1024;
+    else
+	SC3 = SC2;
+
+    uint32 OffsetMask = BG.TileSize == 16 ? 0x3ff : 0x1ff;
+    uint32 OffsetShift = BG.TileSize == 16 ? 4 : 3;
+    uint32 VOffset = LineData [Y].BG[bg].VOffset;
+    uint32 HOffset = LineData [Y].BG[bg].HOffset;
+    uint32 StartLine = ((Y + VOffset) & 7) << 3;
+    uint32 ScreenLine = (VOffset + Y) >> OffsetShift;
+    uint32 t1;
+    uint32 t2;
+
+    if (((VOffset + Y) & 15) > 7)
+    {
+	t1 = 16;
+	t2 = 0;
+    }
+    else
+    {
+	t1 = 0;
+	t2 = 16;
+    }
+
+    uint16 *b1;
+    uint16 *b2;
+
+    if (ScreenLine & 0x20)
+	b1 = SC2, b2 = SC3;
+    else
+	b1 = SC0, b2 = SC1;
+
+    b1 += (ScreenLine & 0x1f) << 5;
+    b2 += (ScreenLine & 0x1f) << 5;
+
+    uint32 Quot = (HOffset & OffsetMask) >> 3;
+    uint32 LastTile = ~0;
+    uint64_t p = 0;
+    uint64_t Shown = 0;
+
+    for (int x = -(int) (HOffset & 7); x < LINE_WIDTH;
+	 x += 8, Quot = (Quot + 1) & (OffsetMask >> 3))
+    {
+	uint32 Tile;
+	uint8 Z;
+
+	if (BG.TileSize == 8)
+	{
+	    Tile = READ_2BYTES((Quot & 0x20 ? b2 : b1) + (Quot & 0x1f));
+	    Z = L->Depths [(Tile & 0x2000) >> 13];
+	}
+	else
+	{
+	    Tile = READ_2BYTES((Quot & 0x40 ? b2 : b1) + ((Quot >> 1) & 0x1f));
+	    Z = L->Depths [(Tile & 0x2000) >> 13];
+	    Tile += ((Tile & V_FLIP) ? t2 : t1) +
+		    ((Tile & H_FLIP) ? 1 - (Quot & 1) : (Quot & 1));
 	}
 
-    if (PPU.RecomputeClipWindows)
+	// Maps are often runs of one tile, the blank one most of all
+	if (Tile != LastTile)
+	{
+	    p = LineTile (Tile, StartLine);
+	    LastTile = Tile;
+	}
+
+	uint64_t d = LINE_BYTES(Z);
+
+	memcpy (Pixels + x, &p, 8);
+	memcpy (Depth + x, &d, 8);
+	Shown |= p;
+    }
+
+    return (Shown != 0);
+}
+
+/* Fetches line Y of the sprites the way DrawOBJS draws it: the first sprite
+ * on the line with a pixel at a position has it, whatever its priority.
+ * Returns FALSE if none of it shows. */
+static bool8_32 LineOBJS (uint32 Y, uint8 *Pixels, uint8 *Depth)
+{
+    const struct SOBJLine *L = &GFX.OBJLines [Y];
+    int After = L->Tiles;
+    bool8_32 Shown = FALSE;
+
+    memset (Pixels - LINE_PAD, 0, LINE_PAD + LINE_WIDTH + LINE_PAD);
+    memset (Depth - LINE_PAD, 0, LINE_PAD + LINE_WIDTH + LINE_PAD);
+
+    for (int I = 0; I < L->Count; I++)
     {
-		ComputeClipWindows ();
-		PPU.RecomputeClipWindows = FALSE;
+	int S = L->OBJ [I];
+	int VPos = GFX.VPositions [S];
+	int Size = GFX.Sizes [S];
+	int Line = (int) Y - VPos;
+	int Limit = OBJTimeLimit (S, &After);
+
+	uint32 BaseTile = PPU.OBJ[S].Name | (PPU.OBJ[S].Palette << 10);
+	int TileInc = 1;
+
+	if (PPU.OBJ[S].HFlip)
+	{
+	    BaseTile += ((Size >> 3) - 1) | H_FLIP;
+	    TileInc = -1;
+	}
+	if (PPU.OBJ[S].VFlip)
+	    BaseTile |= V_FLIP;
+
+	uint32 Tile;
+	if (!PPU.OBJ[S].VFlip)
+	    Tile = BaseTile + ((Line & ~7) << 1);
+	else
+	    Tile = BaseTile + ((Size - (Line & ~7) - 8) << 1);
+
+	uint32 StartLine = (Line & 7) << 3;
+	uint64_t Z = LINE_BYTES((PPU.OBJ[S].Priority + 1) * 4);
+
+	for (int X = PPU.OBJ[S].HPos; X < PPU.OBJ[S].HPos + Size && X < Limit;
+	     X += 8, Tile += TileInc)
+	{
+	    if (X <= -8 || X >= LINE_WIDTH)
+		continue;
+
+	    uint64_t p = LineTile (Tile, StartLine);
+	    if (!p)
+		continue;
+
+	    // Only where the sprites before left the line empty
+	    uint64_t line;
+	    uint64_t depth;
+	    memcpy (&line, Pixels + X, 8);
+	    memcpy (&depth, Depth + X, 8);
+
+	    uint64_t empty = (LineOpaque (line) ^ LINE_BYTES(0x01)) * 0xff;
+	    uint64_t set = LineOpaque (p) * 0xff & empty;
+
+	    line |= p & empty;
+	    depth = (depth & ~set) | (Z & set);
+	    memcpy (Pixels + X, &line, 8);
+	    memcpy (Depth + X, &depth, 8);
+	    Shown = TRUE;
+	}
     }
 
-    GFX.StartY = IPPU.PreviousLine;
-    if ((GFX.EndY = IPPU.CurrentLine - 1) >= PPU.ScreenHeight)
-		GFX.EndY = PPU.ScreenHeight - 1;
+    return (Shown);
+}
 
-    uint32 starty = GFX.StartY;
-    uint32 endy = GFX.EndY;
+/* Puts the pixels of a layer's line inside Window over the screen line's
+ * lower ones. */
+static void LineMerge (const struct LineLayer *L, const uint8 *Window,
+		       const uint8 *Pixels, const uint8 *Depth,
+		       struct LineScreen *Screen)
+{
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i math = _mm_set1_epi8 (L->MathFrom < 256 ? 1 : 0);
+    const __m128i from = _mm_set1_epi8 ((uint8) L->MathFrom);
+
+    for (int x = 0; x < LINE_WIDTH; x += 16)
+    {
+	__m128i p = _mm_loadu_si128 ((const __m128i *) (Pixels + x));
+	__m128i z = _mm_loadu_si128 ((const __m128i *) (Depth + x));
+	__m128i w = _mm_loadu_si128 ((const __m128i *) (Window + x));
+	__m128i *sp = (__m128i *) (Screen->Pixels + x);
+	__m128i *sd = (__m128i *) (Screen->Depth + x);
+	__m128i *sm = (__m128i *) (Screen->Math + x);
+
+	// Depths are below 128, so a signed compare does
+	__m128i over = _mm_andnot_si128 (_mm_cmpeq_epi8 (p, zero),
+		_mm_and_si128 (w, _mm_cmpgt_epi8 (z, _mm_loadu_si128 (sd))));
+	__m128i m = _mm_and_si128 (math,
+		_mm_cmpeq_epi8 (_mm_max_epu8 (p, from), p));
+
+#define LINE_SELECT(dst, src) \
+	_mm_storeu_si128 (dst, _mm_or_si128 (_mm_and_si128 (over, src), \
+			  _mm_andnot_si128 (over, _mm_loadu_si128 (dst))));
+
+	LINE_SELECT (sp, p)
+	LINE_SELECT (sd, z)
+	LINE_SELECT (sm, m)
+#undef LINE_SELECT
+    }
+#elif defined(__ARM_NEON__)
+    const uint8x16_t math = vdupq_n_u8 (L->MathFrom < 256 ? 1 : 0);
+    const uint8x16_t from = vdupq_n_u8 ((uint8) L->MathFrom);
+
+    for (int x = 0; x < LINE_WIDTH; x += 16)
+    {
+	uint8x16_t p = vld1q_u8 (Pixels + x);
+	uint8x16_t z = vld1q_u8 (Depth + x);
+	uint8x16_t over = vandq_u8 (vld1q_u8 (Window + x),
+		vandq_u8 (vtstq_u8 (p, p),
+			  vcgtq_u8 (z, vld1q_u8 (Screen->Depth + x))));
+	uint8x16_t m = vandq_u8 (math, vcgeq_u8 (p, from));
+
+	vst1q_u8 (Screen->Pixels + x,
+		  vbslq_u8 (over, p, vld1q_u8 (Screen->Pixels + x)));
+	vst1q_u8 (Screen->Depth + x,
+		  vbslq_u8 (over, z, vld1q_u8 (Screen->Depth + x)));
+	vst1q_u8 (Screen->Math + x,
+		  vbslq_u8 (over, m, vld1q_u8 (Screen->Math + x)));
+    }
+#else
+    for (int x = 0; x < LINE_WIDTH; x++)
+    {
+	if (Pixels [x] && Window [x] && Depth [x] > Screen->Depth [x])
+	{
+	    Screen->Pixels [x] = Pixels [x];
+	    Screen->Depth [x] = Depth [x];
+	    Screen->Math [x] = Pixels [x] >= L->MathFrom;
+	}
+    }
+#endif
+}
+
+/* Sets Window to Inside within window n of pClip, or on the whole line if
+ * it has none, and to 0 outside it. */
+static void LineWindow (const struct ClipData *pClip, int n, uint8 Inside,
+			uint8 *Window)
+{
+    if (!pClip->Count [n])
+    {
+	memset (Window, Inside, LINE_WIDTH);
+	return;
+    }
+
+    memset (Window, 0, LINE_WIDTH);
+    for (uint32 c = 0; c < pClip->Count [n]; c++)
+    {
+	uint32 Left = pClip->Left [c][n];
+	uint32 Right = pClip->Right [c][n];
+
+	if (Right > LINE_WIDTH)
+	    Right = LINE_WIDTH;
+	if (Right > Left)
+	    memset (Window + Left, Inside, Right - Left);
+    }
+}
+
+#define LINE_BLEND(C, S, HALF) \
+    (GFX.r2131 & 0x80 ? \
+	((HALF) ? COLOR_SUB1_2 (C, S) : COLOR_SUB (C, S)) : \
+	((HALF) ? COLOR_ADD1_2 (C, S) : COLOR_ADD (C, S)))
+
+/* Draws the lines from GFX.StartY to GFX.EndY with the line renderer, if it
+ * can draw them. */
+static bool8_32 DrawLinesIndexed ()
+{
+    if (PPU.ForcedBlanking ||
+	(PPU.BGMode != 0 && PPU.BGMode != 1 && PPU.BGMode != 3) ||
+	(PPU.BGMode == 3 && (GFX.r2130 & 1)))
+	return FALSE;
 
 #ifndef RC_OPTIMIZED
-	if (Settings.SupportHiRes &&
-	  (PPU.BGMode == 5 || PPU.BGMode == 6 || IPPU.LatchedInterlace)) {
-		if (PPU.BGMode == 5 || PPU.BGMode == 6) {
-		    IPPU.RenderedScreenWidth = 512;
-		    x2 = 2;
-		}
+    if (Settings.SupportHiRes &&
+	(IPPU.DoubleWidthPixels || IPPU.LatchedInterlace))
+	return FALSE;
+#endif
 
-		if (IPPU.LatchedInterlace) {
-			starty = GFX.StartY * 2;
-			endy = GFX.EndY * 2 + 1;
-		}
+    for (int bg = 0; bg < 4; bg++)
+	if (PPU.BGMosaic [bg] && PPU.Mosaic > 1)
+	    return FALSE;
 
-		if (!IPPU.DoubleWidthPixels) {
-			// The game has switched from lo-res to hi-res mode part way down
-			// the screen. Scale any existing lo-res pixels on screen
-				for (register uint32 y = 0; y < GFX.StartY; y++) {
-					register uint16 *p =
-						(uint16 *) (GFX.Screen + y * GFX.Pitch) + 255;
-					register uint16 *q =
-						(uint16 *) (GFX.Screen + y * GFX.Pitch) + 510;
-					for (register int x = 255; x >= 0; x--, p--, q -= 2) {
-						*q = *(q + 1) = *p;
-					}
-				}
+    // The same test S9xDrawLines makes for transparency effects
+    bool8_32 math = ADD_OR_SUB_ON_ANYTHING &&
+		    (GFX.r2130 & 0x30) != 0x30 &&
+		    !((GFX.r2130 & 0x30) == 0x10 && IPPU.Clip[1].Count[5] == 0);
 
-			IPPU.DoubleWidthPixels = TRUE;
-		}
+    struct LineLayer Layers [5];
+    int Count = 0;
+    static const uint32 ignore [5] = {
+	GFX_IGNORE_BG0, GFX_IGNORE_BG1, GFX_IGNORE_BG2, GFX_IGNORE_BG3,
+	GFX_IGNORE_OBJ
+    };
+
+    LineSetupOBJS (&Layers [Count++]);
+    if (PPU.BGMode <= 1)
+    {
+	LineSetupBackground (&Layers [Count++], PPU.BGMode, 0, 10, 14);
+	LineSetupBackground (&Layers [Count++], PPU.BGMode, 1, 9, 13);
+	LineSetupBackground (&Layers [Count++], PPU.BGMode, 2, 3,
+			     (GFX.FillRAM [0x2105] & 8) == 0 ? 6 : 17);
+	if (PPU.BGMode == 0)
+	    LineSetupBackground (&Layers [Count++], PPU.BGMode, 3, 2, 5);
+    }
+    else
+    {
+	LineSetupBackground (&Layers [Count++], PPU.BGMode, 0, 5, 13);
+	LineSetupBackground (&Layers [Count++], PPU.BGMode, 1, 2, 9);
+    }
+
+    // Where each layer shows on the main and sub screens
+    uint8 Windows [5][2][LINE_WIDTH];
+
+    for (int i = 0; i < Count; i++)
+    {
+	struct LineLayer *L = &Layers [i];
+	int n = L->Layer;
+
+	L->Main = ON_MAIN (n) && !(Settings.os9x_hack & ignore [n]);
+	L->Sub = math && ON_SUB (n) && !(Settings.os9x_hack & ignore [n]);
+	if (!math)
+	    L->MathFrom = 256;
+
+	if (L->Main)
+	    LineWindow (&IPPU.Clip [0], n, 0xff, Windows [i][0]);
+	if (L->Sub)
+	    LineWindow (&IPPU.Clip [1], n, 0xff, Windows [i][1]);
+    }
+
+    // Inside the colour window the backdrop shows, and the fixed colour is
+    // on the sub screen
+    uint8 BackWindow [LINE_WIDTH];
+    uint8 SubWindow [LINE_WIDTH];
+    bool8_32 BackClipped = IPPU.Clip [0].Count [5] != 0;
+
+    LineWindow (&IPPU.Clip [0], 5, 1, BackWindow);
+    LineWindow (&IPPU.Clip [1], 5, 1, SubWindow);
+
+    struct LineScreen Main;
+    struct LineScreen Sub;
+    uint8 PixelLine [LINE_PAD + LINE_WIDTH + LINE_PAD];
+    uint8 DepthLine [LINE_PAD + LINE_WIDTH + LINE_PAD];
+    uint8 *Pixels = PixelLine + LINE_PAD;
+    uint8 *Depth = DepthLine + LINE_PAD;
+    uint16 *ScreenColors = IPPU.ScreenColors;
+    uint32 back = IPPU.ScreenColors [0];
+
+    GFX.FixedColour = BUILD_PIXEL (IPPU.XB [PPU.FixedColourRed],
+				   IPPU.XB [PPU.FixedColourGreen],
+				   IPPU.XB [PPU.FixedColourBlue]);
+
+    // The final pass looks each pixel up in the palette, in the palette
+    // with the fixed colour added or subtracted, or in the colours the
+    // backdrop shows over none or the fixed colour inside the colour window
+    // or not. The pixels over a sub screen one are then blended with it a
+    // line at a time.
+    uint16 Colours [256 + 256 + 4];
+    bool8_32 BackShows = !SUB_OR_ADD(5);
+    bool8_32 BackBlends = !BackShows && ((GFX.r2131 & 0xc0) || back != 0);
+    bool8_32 BackOver = BackShows || BackBlends;
+
+#define LINE_FIXED 256
+#define LINE_BACK(d, inside) (512 + ((d) << 1) + (inside))
+
+    memcpy (Colours, ScreenColors, 256 * sizeof (uint16));
+    Colours [LINE_BACK(0, 0)] = Colours [LINE_BACK(1, 0)] = BLACK;
+    Colours [LINE_BACK(0, 1)] = (uint16) back;
+    if (BackShows)
+	Colours [LINE_BACK(1, 1)] = (uint16) back;
+    else
+    if (BackBlends)
+	Colours [LINE_BACK(1, 1)] = (uint16) LINE_BLEND (back, GFX.FixedColour, 0);
+    else
+	Colours [LINE_BACK(1, 1)] = BackClipped ? BLACK : (uint16) GFX.FixedColour;
+
+    if (math)
+    {
+	// Halving the fixed colour is for when there is no sub screen
+	bool8_32 half = (GFX.r2131 & 0x40) && !(GFX.r2130 & 2);
+
+	for (int i = 0; i < 256; i++)
+	    Colours [LINE_FIXED + i] = (uint16) LINE_BLEND (ScreenColors [i],
+							    GFX.FixedColour, half);
+    }
+    else
+	memset (Sub.Depth, 0, LINE_WIDTH);
+
+    for (uint32 y = GFX.StartY; y <= GFX.EndY; y++)
+    {
+	memset (Main.Depth, 0, LINE_WIDTH);
+	if (math)
+	    memcpy (Sub.Depth, SubWindow, LINE_WIDTH);
+
+	for (int i = 0; i < Count; i++)
+	{
+	    struct LineLayer *L = &Layers [i];
+
+	    if (!L->Main && !L->Sub)
+		continue;
+
+	    BG = L->BG;
+	    if (L->Layer == 4 ? !LineOBJS (y, Pixels, Depth) :
+		!LineBackground (L, y, Pixels, Depth))
+		continue;
+
+	    if (L->Main)
+		LineMerge (L, Windows [i][0], Pixels, Depth, &Main);
+	    if (L->Sub)
+		LineMerge (L, Windows [i][1], Pixels, Depth, &Sub);
+	}
+
+	uint16 Index [LINE_WIDTH];
+	uint8 Blend [LINE_WIDTH];
+	uint32 Blends = 0;
+
+	for (int x = 0; x < LINE_WIDTH; x++)
+	{
+	    uint32 d = Sub.Depth [x];
+	    uint32 inside = BackWindow [x];
+	    uint32 sub = d > 1;
+	    uint32 main = Main.Pixels [x] | ((Main.Math [x] & (d == 1)) << 8);
+	    uint32 backdrop = sub ? (inside && BackOver ? LINE_BACK(0, 1) :
+				     Sub.Pixels [x]) :
+			      LINE_BACK(d, inside);
+
+	    Index [x] = Main.Depth [x] ? main : backdrop;
+	    Blend [x] = sub & (Main.Depth [x] ? Main.Math [x] : inside & BackBlends);
+	    Blends |= Blend [x];
 	}
-#endif //RC_OPTIMIZED (DONT DO ABOVE)
+
+	uint16 *p = (uint16 *) (GFX.Screen + y * GFX.Pitch);
+
+	for (int x = 0; x < LINE_WIDTH; x++)
+	    p [x] = Colours [Index [x]];
+
+	if (!Blends)
+	    continue;
+
+	uint16 SubColours [LINE_WIDTH];
+
+	for (int x = 0; x < LINE_WIDTH; x++)
+	    SubColours [x] = Colours [Sub.Pixels [x]];
+
+	BlendLine (p, p, SubColours, Blend, LINE_WIDTH, GFX.r2131 & 0x40);
+    }
+
+#undef LINE_FIXED
+#undef LINE_BACK
+
+    return TRUE;
+}
+
+/* Draws the lines from GFX.StartY to GFX.EndY that S9xRenderUpdate has set
+ * up, with the GFX and BG of the thread it is called on. */
+void S9xDrawLines ()
+{
+    int32 x2 = 1;
+    uint32 starty = GFX.StartY;
+    uint32 endy = GFX.EndY;
+
+#ifndef RC_OPTIMIZED
+    if (Settings.SupportHiRes)
+    {
+	if (PPU.BGMode == 5 || PPU.BGMode == 6)
+	    x2 = 2;
+	if (IPPU.LatchedInterlace)
+	{
+	    starty = GFX.StartY * 2;
+	    endy = GFX.EndY * 2 + 1;
+	}
+    }
+#endif
 
     uint32 black = BLACK | (BLACK << 16);
 
@@ -3037,12 +3638,15 @@ void S9xUpdateScreen () // ~30-50ms! (called from FLUSH_REDRAW())
 		if (GFX.Pseudo)
 		{
 			GFX.r2131 = 0x5f;  //0101 1111 - enable addition/subtraction on all BGS and sprites and "1/2 OF COLOR DATA" DESIGNATION
-			GFX.r212d = (Memory.FillRAM [0x212c] ^ // any BGS which are set as main and as sub then switch off the sub
-				 Memory.FillRAM [0x212d]) & 15;
+			GFX.r212d = (GFX.FillRAM [0x212c] ^ // any BGS which are set as main and as sub then switch off the sub
+				 GFX.FillRAM [0x212d]) & 15;
 			GFX.r212c &= ~GFX.r212d;  // make sure the main BG reg is the reverse of the sub BG reg
 			GFX.r2130 |= 2; // enable ADDITION/SUBTRACTION FOR SUB SCREEN
 		}
 
+		if (Settings.LineRenderer && DrawLinesIndexed ())
+			return;
+
 		// Check to see if any transparency effects are currently in use
 		if (!PPU.ForcedBlanking && ADD_OR_SUB_ON_ANYTHING &&
 			(GFX.r2130 & 0x30) != 0x30 &&
@@ -3269,122 +3873,27 @@ void S9xUpdateScreen () // ~30-50ms! (called from FLUSH_REDRAW())
 					continue;
 				}
 
-				if (GFX.r2131 & 0x80)
-				{
-				    if (GFX.r2131 & 0x40)
-				    {
-					// Subtract, halving the result.
-					register uint16 *p = (uint16 *) (GFX.Screen + y * GFX.Pitch) + Left;
-					register uint8 *d = GFX.ZBuffer + y * GFX.ZPitch;
-					register uint8 *s = GFX.SubZBuffer + y * GFX.ZPitch + Left;
-					register uint8 *e = d + Right;
-					uint16 back_fixed = COLOR_SUB (back, GFX.FixedColour);
-
-					d += Left;
-					while (d < e)
-					{
-					    if (*d == 0)
-					    {
-						if (*s)
-						{
-						    if (*s != 1)
-							*p = COLOR_SUB1_2 (back, *(p + GFX.Delta));
-						    else
-							*p = back_fixed;
-						}
-						else
-						    *p = (uint16) back;
-					    }
-					    d++;
-					    p++;
-					    s++;
-					}
-				    }
-				    else
-				    {
-					// Subtract
-					register uint16 *p = (uint16 *) (GFX.Screen + y * GFX.Pitch) + Left;
-					register uint8 *s = GFX.SubZBuffer + y * GFX.ZPitch + Left;
-					register uint8 *d = GFX.ZBuffer + y * GFX.ZPitch;
-					register uint8 *e = d + Right;
-					uint16 back_fixed = COLOR_SUB (back, GFX.FixedColour);
-
-					d += Left;
-					while (d < e)
-					{
-					    if (*d == 0)
-					    {
-						if (*s)
-						{
-						    if (*s != 1)
-							*p = COLOR_SUB (back, *(p + GFX.Delta));
-						    else
-							*p = back_fixed;
-						}
-						else
-						    *p = (uint16) back;
-					    }
-					    d++;
-					    p++;
-					    s++;
-					}
-				    }
-				}
-				else
-				if (GFX.r2131 & 0x40)
-				{
-				    register uint16 *p = (uint16 *) (GFX.Screen + y * GFX.Pitch) + Left;
-				    register uint8 *d = GFX.ZBuffer + y * GFX.ZPitch;
-				    register uint8 *s = GFX.SubZBuffer + y * GFX.ZPitch + Left;
-				    register uint8 *e = d + Right;
-				    uint16 back_fixed = COLOR_ADD (back, GFX.FixedColour);
-				    d += Left;
-				    while (d < e)
-				    {
-					if (*d == 0)
-					{
-					    if (*s)
-					    {
-						if (*s != 1)
-						    *p = COLOR_ADD1_2 (back, *(p + GFX.Delta));
-						else
-						    *p = back_fixed;
-					    }
-					    else
-						*p = (uint16) back;
-					}
-					d++;
-					p++;
-					s++;
-				    }
-				}
-				else
-				if (back != 0)
+				if ((GFX.r2131 & 0xc0) || back != 0)
 				{
-				    register uint16 *p = (uint16 *) (GFX.Screen + y * GFX.Pitch) + Left;
-				    register uint8 *d = GFX.ZBuffer + y * GFX.ZPitch;
-				    register uint8 *s = GFX.SubZBuffer + y * GFX.ZPitch + Left;
-				    register uint8 *e = d + Right;
-				    uint16 back_fixed = COLOR_ADD (back, GFX.FixedColour);
-				    d += Left;
-				    while (d < e)
+				    // Fill the backdrop in, then blend the part
+				    // of it over the sub screen in one go
+				    uint16 *p = (uint16 *) (GFX.Screen + y * GFX.Pitch) + Left;
+				    uint8 *d = GFX.ZBuffer + y * GFX.ZPitch + Left;
+				    uint8 *s = GFX.SubZBuffer + y * GFX.ZPitch + Left;
+				    uint16 back_fixed = GFX.r2131 & 0x80 ?
+					COLOR_SUB (back, GFX.FixedColour) :
+					COLOR_ADD (back, GFX.FixedColour);
+				    uint8 Blend [256 * 2];
+				    int Width = Right - Left;
+
+				    for (int x = 0; x < Width; x++)
 				    {
-					if (*d == 0)
-					{
-					    if (*s)
-					    {
-						if (*s != 1)
-						    *p = COLOR_ADD (back, *(p + GFX.Delta));
-						else	
-						    *p = back_fixed;
-					    }
-					    else
-						*p = (uint16) back;
-					}
-					d++;
-					p++;
-					s++;
+					Blend [x] = d [x] == 0 && s [x] > 1;
+					if (d [x] == 0)
+					    p [x] = s [x] == 1 ? back_fixed : (uint16) back;
 				    }
+				    BlendLine (p, p, p + GFX.Delta, Blend, Width,
+					       GFX.r2131 & 0x40);
 				}
 				else
 				{
@@ -3605,7 +4114,7 @@ void S9xUpdateScreen () // ~30-50ms! (called from FLUSH_REDRAW())
 	{
 		    // get back colour to be used in clearing the screen
 			register uint32 back;
-			if (!(Memory.FillRAM [0x2131] & 0x80) &&(Memory.FillRAM[0x2131] & 0x20) &&
+			if (!(GFX.FillRAM [0x2131] & 0x80) &&(GFX.FillRAM[0x2131] & 0x20) &&
 					(PPU.FixedColourRed || PPU.FixedColourGreen || PPU.FixedColourBlue))
 			{
 				back = (IPPU.XB[PPU.FixedColourRed]<<11) |
@@ -3692,7 +4201,7 @@ else \
 				{
 				    FIXCLIP(2);
 				    DrawBackground (PPU.BGMode, 2, 3,
-						    (Memory.FillRAM [0x2105] & 8) == 0 ? 6 : 17);
+						    (GFX.FillRAM [0x2105] & 8) == 0 ? 6 : 17);
 				}
 				if (BG3 && PPU.BGMode == 0)
 				{
@@ -3727,11 +4236,11 @@ else \
 				    FIXCLIP(4);
 				    DrawOBJS ();
 				}
-				if (BG0 || ((Memory.FillRAM [0x2133] & 0x40) && BG1))
+				if (BG0 || ((GFX.FillRAM [0x2133] & 0x40) && BG1))
 				{
 				    int bg;
 				    FIXCLIP(0);
-				    if (Memory.FillRAM [0x2133] & 0x40)
+				    if (GFX.FillRAM [0x2133] & 0x40)
 				    {
 					GFX.Mode7Mask = 0x7f;
 					GFX.Mode7PriorityMask = 0x80;
@@ -3790,7 +4299,93 @@ else \
 	}
     }
 #endif
+}
+
+/* Sets up and draws the lines from IPPU.PreviousLine to IPPU.CurrentLine,
+ * on the thread the screen is drawn on. */
+void S9xRenderUpdate ()
+{
+    GFX.S = GFX.Screen;
+
+	unsigned char *memoryfillram = GFX.FillRAM;
+
+	// get local copies of vid registers to be used later
+    GFX.r2131 = memoryfillram [0x2131]; // ADDITION/SUBTRACTION & SUBTRACTION DESIGNATION FOR EACH SCREEN 
+    GFX.r212c = memoryfillram [0x212c]; // MAIN SCREEN, DESIGNATION - used to enable BGS
+    GFX.r212d = memoryfillram [0x212d]; // SUB SCREEN DESIGNATION - used to enable sub BGS
+    GFX.r2130 = memoryfillram [0x2130]; // INITIAL SETTINGS FOR FIXED COLOR ADDITION OR SCREEN ADDITION
+	
+	// If external sync is off and
+	// main screens have not been configured the same as the sub screen and
+	// color addition and subtraction has been diabled then
+	// Pseudo is 1
+	// anything else it is 0
+	GFX.Pseudo = (memoryfillram [0x2133] & 8) != 0 && // Use EXTERNAL SYNCHRONIZATION?
+		 (GFX.r212c & 15) != (GFX.r212d & 15) && // Are the main screens different from the sub screens?
+		 (GFX.r2131 & 0x3f) == 0; // Is colour data addition/subtraction disabled on all BGS?
+
+	// Decode the tiles VRAM DMAs have written since the last update
+	// before drawing any of them
+	S9xDecodeQueuedTiles ();
+
+	// If sprite data has been changed then go through and 
+	// refresh the sprites.
+    if (IPPU.OBJChanged)
+	{	
+		S9xSetupOBJ ();
+	}
+
+    if (PPU.RecomputeClipWindows)
+    {
+		ComputeClipWindows ();
+		PPU.RecomputeClipWindows = FALSE;
+    }
+
+    GFX.StartY = IPPU.PreviousLine;
+    if ((GFX.EndY = IPPU.CurrentLine - 1) >= PPU.ScreenHeight)
+		GFX.EndY = PPU.ScreenHeight - 1;
+
+#ifndef RC_OPTIMIZED
+	if (Settings.SupportHiRes &&
+	  (PPU.BGMode == 5 || PPU.BGMode == 6 || IPPU.LatchedInterlace)) {
+		if (PPU.BGMode == 5 || PPU.BGMode == 6) {
+		    IPPU.RenderedScreenWidth = 512;
+		}
+
+		if (!IPPU.DoubleWidthPixels) {
+			// The game has switched from lo-res to hi-res mode part way down
+			// the screen. Scale any existing lo-res pixels on screen
+				for (register uint32 y = 0; y < GFX.StartY; y++) {
+					register uint16 *p =
+						(uint16 *) (GFX.Screen + y * GFX.Pitch) + 255;
+					register uint16 *q =
+						(uint16 *) (GFX.Screen + y * GFX.Pitch) + 510;
+					for (register int x = 255; x >= 0; x--, p--, q -= 2) {
+						*q = *(q + 1) = *p;
+					}
+				}
+
+			IPPU.DoubleWidthPixels = TRUE;
+		}
+	}
+#endif //RC_OPTIMIZED (DONT DO ABOVE)
+
+    // Draw the lines in bands on the render threads, or all of them here
+    if (!S9xRenderThreadsDraw ())
+	S9xDrawLines ();
+}
+
+void S9xUpdateScreen () // ~30-50ms! (called from FLUSH_REDRAW())
+{
+    PROFILE_ENTER(PROFILE_RENDER);
+
+    // With the render pipeline the lines are only recorded here, to be
+    // drawn with the rest of the frame while the next one is emulated
+    if (!S9xRenderPipelineRecord ())
+	S9xRenderUpdate ();
+
     IPPU.PreviousLine = IPPU.CurrentLine;
+    PROFILE_LEAVE();
 }
 
 #ifdef GFX_MULTI_FORMAT
@@ -43,6 +43,27 @@
 
 #include "port.h"
 
+/* With CONF_RENDER_THREADS the state the renderer works in is kept per
+ * thread, so that bands of the same screen update can be drawn at once
+ * (Settings.RenderThreads) and a frame can be drawn while the next one is
+ * emulated (Settings.RenderPipeline). */
+#ifdef CONF_RENDER_THREADS
+#define GFX_THREAD_LOCAL __thread
+#else
+#define GFX_THREAD_LOCAL
+#endif
+
+/* The sprites on a screen line, as the PPU would find them */
+struct SOBJLine {
+    uint8  Count;		/// Sprites in OBJ, at most 32
+    uint8  Flags;		/// OBJ_RANGE_OVER and OBJ_TIME_OVER, as $213E has them
+    uint16 Tiles;		/// Tiles of them on the screen, however many
+    uint8  OBJ [32];		/// In the order GFX.OBJList has them
+};
+
+#define OBJ_RANGE_OVER	0x40	/// More than 32 sprites on the line
+#define OBJ_TIME_OVER	0x80	/// More than 34 of their tiles
+
 struct SGFX {
 	// Initialize these variables
 	uint8  *Screen;
@@ -51,14 +72,16 @@ struct SGFX {
 	uint8  *SubZBuffer;
 	uint32 Pitch;		/// Width of surface in bytes
 	uint32 ZPitch;   	/// Pitch of ZBuffer
-	uint32 Delta;		/// Set to (GFX.SubScreen - GFX.Screen) >> 1
-    uint32 DepthDelta;	/// Set to GFX.SubZBuffer - GFX.ZBuffer
+	intptr_t Delta;		/// Set to (GFX.SubScreen - GFX.Screen) >> 1
+    intptr_t DepthDelta;	/// Set to GFX.SubZBuffer - GFX.ZBuffer
     uint32 PPL;			/// Number of pixels per line (= pitch in pixels)
 
     // Setup in call to S9xGraphicsInit()
     uint16 *X2;
     uint16 *ZERO_OR_X2;
     uint16 *ZERO;
+    uint8  *VRAM;		/// Memory.VRAM, or the copy this thread draws from
+    uint8  *FillRAM;		/// Memory.FillRAM, or the PPU registers copy
 
     uint8  *S;
     uint8  *DB;
@@ -77,6 +100,7 @@ struct SGFX {
     int	   OBJList [129];
     uint32 Sizes [129];
     int    VPositions [129];
+    struct SOBJLine OBJLines [240];
 
     uint8  r212c;
     uint8  r212d;
@@ -136,7 +160,9 @@ extern uint32 odd_high [4][16];
 extern uint32 odd_low [4][16];
 extern uint32 even_high [4][16];
 extern uint32 even_low [4][16];
-extern SBG BG;
+extern GFX_THREAD_LOCAL SBG BG;
+extern GFX_THREAD_LOCAL struct SLineData LineData [240];
+extern GFX_THREAD_LOCAL struct SLineMatrixData LineMatrixData [240];
 extern uint16 DirectColourMaps [8][256];
 
 //extern uint8 add32_32 [32][32];
@@ -209,18 +235,37 @@ typedef void (*LargePixelRenderer) (uint32 Tile, uint32 Offset,
 				    uint32 StartPixel, uint32 Pixels,
 				    uint32 StartLine, uint32 LineCount);
 
+extern GFX_THREAD_LOCAL NormalTileRenderer DrawTilePtr;
+extern GFX_THREAD_LOCAL ClippedTileRenderer DrawClippedTilePtr;
+extern GFX_THREAD_LOCAL NormalTileRenderer DrawHiResTilePtr;
+extern GFX_THREAD_LOCAL ClippedTileRenderer DrawHiResClippedTilePtr;
+extern GFX_THREAD_LOCAL LargePixelRenderer DrawLargePixelPtr;
+extern GFX_THREAD_LOCAL uint8 Mode7Depths [2];
+
 START_EXTERN_C
 void S9xStartScreenRefresh ();
 void S9xDrawScanLine (uint8 Line);
 void S9xEndScreenRefresh ();
 void S9xSetupOBJ (struct SOBJ *);
 void S9xUpdateScreen ();
+void S9xDrawLines ();
+void S9xDecodeQueuedTiles ();
+void S9xRenderThreadsStart ();
+void S9xRenderThreadsStop ();
+bool8 S9xRenderThreadsDraw ();
+void S9xRenderUpdate ();
+void S9xShowScreen ();
+void S9xRenderPipelineStart ();
+void S9xRenderPipelineStop ();
+bool8 S9xRenderPipelineRecord ();
+bool8 S9xRenderPipelineEndFrame ();
+void S9xRenderPipelineFlush ();
 void RenderLine (uint8 line);
 void S9xBuildDirectColourMaps ();
 
 // External port interface which must be implemented or initialised for each
 // port.
-extern struct SGFX GFX;
+extern GFX_THREAD_LOCAL struct SGFX GFX;
 
 bool8_32 S9xGraphicsInit ();
 void S9xGraphicsDeinit();
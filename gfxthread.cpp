@@ -0,0 +1,647 @@
+/* Draws screen updates on threads of their own.
+ *
+ * With Settings.RenderThreads, S9xRenderUpdate splits the lines from
+ * GFX.StartY to GFX.EndY into horizontal bands instead of drawing them
+ * with S9xDrawLines: the calling thread draws the first and the render
+ * threads the others, each with a copy of the GFX, BG, PPU and tile
+ * renderer state the caller had, which CONF_RENDER_THREADS makes per
+ * thread. A line only depends on its own LineData and LineMatrixData and
+ * on PPU state that does not change during the update, and the bands write
+ * disjoint lines of the screen and depth buffers, so the picture is the
+ * same as drawn on one thread. The caller waits for all the bands before
+ * it goes on.
+ *
+ * With Settings.RenderPipeline, S9xUpdateScreen does not draw at all but
+ * records what S9xRenderUpdate would draw with: the PPU and IPPU, the PPU
+ * registers, the frame's LineData and, when VRAM has been written since the
+ * last update, a copy of VRAM. At the end of the frame the record goes to
+ * the pipeline thread, which draws it while the next frame is emulated and
+ * recorded, with a VRAM copy and tile cache of its own. The frame is shown
+ * at the end of the next one, or when S9xRenderPipelineFlush asks for it. */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "snes9x.h"
+#include "memmap.h"
+#include "ppu.h"
+#include "gfx.h"
+
+#ifdef CONF_RENDER_THREADS
+
+#define RENDER_MAX_THREADS	8
+/* Bands of fewer lines are not worth waking a thread for; updates flushed
+ * by mid-frame register writes are often a line or two */
+#define RENDER_MIN_LINES	16
+/* How many times a thread looks for work before it gives up the core */
+#define RENDER_THREAD_SPINS	(1 << 14)
+
+#if defined(__i386__) || defined(__x86_64__)
+#define PAUSE()		__builtin_ia32_pause ()
+#else
+#define PAUSE()
+#endif
+
+static struct {
+	// Written by the updating thread
+	volatile uint32 Posted __attribute__ ((aligned (64)));
+	int Threads;		// Render threads running
+	int Bands;		// Bands in the posted update, its own included
+	uint32 StartY [RENDER_MAX_THREADS + 1];
+	uint32 EndY [RENDER_MAX_THREADS + 1];
+	volatile bool8 Quit;
+
+	// The updating thread's renderer state, for the bands to start from
+	struct SGFX GFX;
+	struct SBG BG;
+	struct SPPU PPU;
+	struct InternalPPU IPPU;
+	struct SLineData LineData [240];
+	struct SLineMatrixData LineMatrixData [240];
+	NormalTileRenderer DrawTilePtr;
+	ClippedTileRenderer DrawClippedTilePtr;
+	NormalTileRenderer DrawHiResTilePtr;
+	ClippedTileRenderer DrawHiResClippedTilePtr;
+	LargePixelRenderer DrawLargePixelPtr;
+	uint8 Mode7Depths [2];
+
+	// Written by the render threads
+	volatile uint32 Done __attribute__ ((aligned (64)));
+	volatile int Sleeping __attribute__ ((aligned (64)));
+} Pool;
+
+static pthread_t ThreadIds [RENDER_MAX_THREADS];
+static uint32 StartPosted;	// Pool.Posted when the threads were started
+static pthread_mutex_t Lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t Wake = PTHREAD_COND_INITIALIZER;
+
+static void WakeUp ()
+{
+	__sync_synchronize ();
+	if (Pool.Sleeping) {
+		pthread_mutex_lock (&Lock);
+		pthread_cond_broadcast (&Wake);
+		pthread_mutex_unlock (&Lock);
+	}
+}
+
+static void Sleep (uint32 seen)
+{
+	pthread_mutex_lock (&Lock);
+	__sync_fetch_and_add (&Pool.Sleeping, 1);
+	__sync_synchronize ();
+	while (Pool.Posted == seen && !Pool.Quit)
+		pthread_cond_wait (&Wake, &Lock);
+	__sync_fetch_and_sub (&Pool.Sleeping, 1);
+	pthread_mutex_unlock (&Lock);
+}
+
+static void *Run (void *arg)
+{
+	int band = (int) (intptr_t) arg;
+	uint32 seen = StartPosted;
+	int spins = 0;
+
+	for (;;) {
+		uint32 posted = Pool.Posted;
+		__sync_synchronize ();
+
+		if (posted == seen) {
+			if (Pool.Quit)
+				break;
+			if (++spins < RENDER_THREAD_SPINS)
+				PAUSE ();
+			else {
+				Sleep (seen);
+				spins = 0;
+			}
+			continue;
+		}
+
+		seen = posted;
+		spins = 0;
+		if (band >= Pool.Bands)
+			continue;
+
+		GFX = Pool.GFX;
+		BG = Pool.BG;
+		PPU = Pool.PPU;
+		IPPU = Pool.IPPU;
+		memcpy (LineData, Pool.LineData, sizeof (LineData));
+		memcpy (LineMatrixData, Pool.LineMatrixData, sizeof (LineMatrixData));
+		DrawTilePtr = Pool.DrawTilePtr;
+		DrawClippedTilePtr = Pool.DrawClippedTilePtr;
+		DrawHiResTilePtr = Pool.DrawHiResTilePtr;
+		DrawHiResClippedTilePtr = Pool.DrawHiResClippedTilePtr;
+		DrawLargePixelPtr = Pool.DrawLargePixelPtr;
+		Mode7Depths [0] = Pool.Mode7Depths [0];
+		Mode7Depths [1] = Pool.Mode7Depths [1];
+
+		GFX.StartY = Pool.StartY [band];
+		GFX.EndY = Pool.EndY [band];
+		S9xDrawLines ();
+
+		__sync_fetch_and_add (&Pool.Done, 1);
+	}
+	return NULL;
+}
+
+bool8 S9xRenderThreadsDraw ()
+{
+	uint32 lines;
+	int bands, band, spins = 0;
+
+	if (!Pool.Threads || GFX.EndY < GFX.StartY)
+		return FALSE;
+
+	lines = GFX.EndY - GFX.StartY + 1;
+	bands = lines / RENDER_MIN_LINES;
+	if (bands > Pool.Threads + 1)
+		bands = Pool.Threads + 1;
+	if (bands < 2)
+		return FALSE;
+
+	// Built on first use otherwise, which the bands would race to do
+	if (IPPU.DirectColourMapsNeedRebuild)
+		S9xBuildDirectColourMaps ();
+
+	for (band = 0; band < bands; band++) {
+		Pool.StartY [band] = GFX.StartY + lines * band / bands;
+		Pool.EndY [band] = GFX.StartY + lines * (band + 1) / bands - 1;
+	}
+	Pool.Bands = bands;
+	Pool.GFX = GFX;
+	Pool.BG = BG;
+	Pool.PPU = PPU;
+	Pool.IPPU = IPPU;
+	memcpy (Pool.LineData, LineData, sizeof (LineData));
+	memcpy (Pool.LineMatrixData, LineMatrixData, sizeof (LineMatrixData));
+	Pool.DrawTilePtr = DrawTilePtr;
+	Pool.DrawClippedTilePtr = DrawClippedTilePtr;
+	Pool.DrawHiResTilePtr = DrawHiResTilePtr;
+	Pool.DrawHiResClippedTilePtr = DrawHiResClippedTilePtr;
+	Pool.DrawLargePixelPtr = DrawLargePixelPtr;
+	Pool.Mode7Depths [0] = Mode7Depths [0];
+	Pool.Mode7Depths [1] = Mode7Depths [1];
+	Pool.Done = 0;
+	__sync_synchronize ();
+	Pool.Posted++;
+	WakeUp ();
+
+	// The first band is drawn here, leaving GFX as the serial update would
+	uint32 endy = GFX.EndY;
+	GFX.EndY = Pool.EndY [0];
+	S9xDrawLines ();
+	GFX.EndY = endy;
+
+	while (Pool.Done != (uint32) bands - 1) {
+		if (++spins < RENDER_THREAD_SPINS)
+			PAUSE ();
+		else
+			sched_yield ();
+	}
+	__sync_synchronize ();
+	return TRUE;
+}
+
+void S9xRenderThreadsStart ()
+{
+	long cores = sysconf (_SC_NPROCESSORS_ONLN);
+	int threads = Settings.RenderThreads - 1;
+
+	// With one core the threads would only take turns at it
+	if (Pool.Threads || threads < 1 || cores < 2)
+		return;
+	if (threads > cores - 1)
+		threads = cores - 1;
+	if (threads > RENDER_MAX_THREADS)
+		threads = RENDER_MAX_THREADS;
+
+	Pool.Quit = FALSE;
+	Pool.Bands = 0;
+	StartPosted = Pool.Posted;
+	for (int i = 0; i < threads; i++) {
+		if (pthread_create (&ThreadIds [i], NULL, Run,
+				    (void *) (intptr_t) (i + 1)) != 0)
+			break;
+		Pool.Threads++;
+	}
+}
+
+void S9xRenderThreadsStop ()
+{
+	if (!Pool.Threads)
+		return;
+
+	Pool.Quit = TRUE;
+	WakeUp ();
+	for (int i = 0; i < Pool.Threads; i++)
+		pthread_join (ThreadIds [i], NULL);
+	Pool.Threads = 0;
+}
+
+/* What S9xRenderUpdate draws with, as S9xUpdateScreen left it */
+struct Update {
+	struct SPPU PPU;
+	struct InternalPPU IPPU;
+	uint8 Regs [0x100];	// $2100-$21ff
+	int VRAM;		// The frame's VRAM copy to draw with, -1 for the last
+};
+
+struct Frame {
+	struct Update *Updates;
+	int Count;
+	int Size;
+	uint8 **VRAM;
+	int VRAMCount;
+	int VRAMSize;
+	struct SLineData LineData [240];
+	struct SLineMatrixData LineMatrixData [240];
+	struct SGFX GFX;	// The emulating thread's, for the screen buffers
+
+	// Written by the pipeline thread, for S9xShowScreen
+	int RenderedScreenWidth;
+	int RenderedScreenHeight;
+	bool8 DoubleWidthPixels;
+};
+
+static struct {
+	// Written by the emulating thread
+	volatile uint32 Posted __attribute__ ((aligned (64)));
+	bool8 Running;		// The thread exists
+	bool8 Pending;		// A frame has been posted and not shown yet
+	volatile bool8 Quit;
+	int Recording;		// The frame S9xUpdateScreen records into
+	struct Frame Frames [2];
+
+	NormalTileRenderer DrawTilePtr;
+	ClippedTileRenderer DrawClippedTilePtr;
+	NormalTileRenderer DrawHiResTilePtr;
+	ClippedTileRenderer DrawHiResClippedTilePtr;
+	LargePixelRenderer DrawLargePixelPtr;
+
+	// Written by the pipeline thread
+	volatile uint32 Done __attribute__ ((aligned (64)));
+	volatile bool8 Sleeping __attribute__ ((aligned (64)));
+} Pipe;
+
+static pthread_t PipeId;
+static pthread_mutex_t PipeLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t PipeWake = PTHREAD_COND_INITIALIZER;
+
+// The pipeline thread's own VRAM, PPU registers and tile cache
+static uint8 *PipeVRAM;
+static uint8 *PipeRegs;
+static uint8 *PipeTileCache [3];
+static uint8 *PipeTileCached [3];
+static const int PipeTiles [3] = {
+	MAX_2BIT_TILES, MAX_4BIT_TILES, MAX_8BIT_TILES
+};
+
+static void PipeWakeUp ()
+{
+	__sync_synchronize ();
+	if (Pipe.Sleeping) {
+		pthread_mutex_lock (&PipeLock);
+		pthread_cond_signal (&PipeWake);
+		pthread_mutex_unlock (&PipeLock);
+	}
+}
+
+static void PipeSleep (uint32 done)
+{
+	pthread_mutex_lock (&PipeLock);
+	Pipe.Sleeping = TRUE;
+	__sync_synchronize ();
+	while (Pipe.Posted == done && !Pipe.Quit)
+		pthread_cond_wait (&PipeWake, &PipeLock);
+	Pipe.Sleeping = FALSE;
+	pthread_mutex_unlock (&PipeLock);
+}
+
+static void PipeWait ()
+{
+	int spins = 0;
+
+	while (Pipe.Done != Pipe.Posted) {
+		if (++spins < RENDER_THREAD_SPINS)
+			PAUSE ();
+		else
+			sched_yield ();
+	}
+	__sync_synchronize ();
+}
+
+// Only the tiles of the 16 byte blocks that differ need decoding again
+static void LoadVRAM (const uint8 *vram)
+{
+	for (uint32 a = 0; a < 0x10000; a += 16) {
+		if (memcmp (PipeVRAM + a, vram + a, 16) == 0)
+			continue;
+		memcpy (PipeVRAM + a, vram + a, 16);
+		IPPU.TileCached [TILE_2BIT][a >> 4] = FALSE;
+		IPPU.TileCached [TILE_4BIT][a >> 5] = FALSE;
+		IPPU.TileCached [TILE_8BIT][a >> 6] = FALSE;
+	}
+}
+
+static void LoadUpdate (const struct Frame *f, const struct Update *u,
+			bool8 first)
+{
+	// What the updates drawn before have left for this one
+	bool8 recompute = PPU.RecomputeClipWindows;
+	bool8 objchanged = IPPU.OBJChanged;
+	bool8 rebuild = IPPU.DirectColourMapsNeedRebuild;
+	bool8 doublewidth = IPPU.DoubleWidthPixels;
+	int width = IPPU.RenderedScreenWidth;
+	struct ClipData clip [2];
+
+	memcpy (clip, IPPU.Clip, sizeof (clip));
+	PPU = u->PPU;
+	IPPU = u->IPPU;
+	memcpy (IPPU.Clip, clip, sizeof (clip));
+	for (int t = 0; t < 3; t++) {
+		IPPU.TileCache [t] = PipeTileCache [t];
+		IPPU.TileCached [t] = PipeTileCached [t];
+	}
+
+	PPU.RecomputeClipWindows |= recompute;
+	IPPU.DirectColourMapsNeedRebuild |= rebuild;
+	if (first) {
+		// GFX holds the emulating thread's sprite lists now
+		IPPU.OBJChanged = TRUE;
+	} else {
+		IPPU.OBJChanged |= objchanged;
+		IPPU.DoubleWidthPixels = doublewidth;
+		IPPU.RenderedScreenWidth = width;
+	}
+
+	memcpy (PipeRegs + 0x2100, u->Regs, sizeof (u->Regs));
+	if (u->VRAM >= 0)
+		LoadVRAM (f->VRAM [u->VRAM]);
+
+	int start = IPPU.PreviousLine;
+	int end = IPPU.CurrentLine < 240 ? IPPU.CurrentLine : 240;
+	if (start < end) {
+		memcpy (&LineData [start], &f->LineData [start],
+			(end - start) * sizeof (struct SLineData));
+		memcpy (&LineMatrixData [start], &f->LineMatrixData [start],
+			(end - start) * sizeof (struct SLineMatrixData));
+	}
+}
+
+static void DrawFrame (struct Frame *f)
+{
+	GFX = f->GFX;
+	GFX.VRAM = PipeVRAM;
+	GFX.FillRAM = PipeRegs;
+
+	for (int i = 0; i < f->Count; i++) {
+		LoadUpdate (f, &f->Updates [i], i == 0);
+		S9xRenderUpdate ();
+	}
+
+	f->RenderedScreenWidth = IPPU.RenderedScreenWidth;
+	f->RenderedScreenHeight = IPPU.RenderedScreenHeight;
+	f->DoubleWidthPixels = IPPU.DoubleWidthPixels;
+}
+
+static void *PipeRun (void *)
+{
+	uint32 done = Pipe.Done;
+	int spins = 0;
+
+	DrawTilePtr = Pipe.DrawTilePtr;
+	DrawClippedTilePtr = Pipe.DrawClippedTilePtr;
+	DrawHiResTilePtr = Pipe.DrawHiResTilePtr;
+	DrawHiResClippedTilePtr = Pipe.DrawHiResClippedTilePtr;
+	DrawLargePixelPtr = Pipe.DrawLargePixelPtr;
+
+	for (;;) {
+		uint32 posted = Pipe.Posted;
+		__sync_synchronize ();
+
+		if (posted == done) {
+			if (Pipe.Quit)
+				break;
+			if (++spins < RENDER_THREAD_SPINS)
+				PAUSE ();
+			else {
+				PipeSleep (done);
+				spins = 0;
+			}
+			continue;
+		}
+
+		spins = 0;
+		DrawFrame (&Pipe.Frames [Pipe.Recording ^ 1]);
+		__sync_synchronize ();
+		Pipe.Done = ++done;
+	}
+	return NULL;
+}
+
+bool8 S9xRenderPipelineRecord ()
+{
+	struct Frame *f = &Pipe.Frames [Pipe.Recording];
+	struct Update *u;
+
+	if (!Pipe.Running)
+		return FALSE;
+
+	if (f->Count == f->Size) {
+		f->Size = f->Size ? f->Size * 2 : 16;
+		f->Updates = (struct Update *)
+			realloc (f->Updates, f->Size * sizeof (struct Update));
+	}
+	u = &f->Updates [f->Count++];
+	u->PPU = PPU;
+	u->IPPU = IPPU;
+	memcpy (u->Regs, &Memory.FillRAM [0x2100], sizeof (u->Regs));
+
+	// Nothing draws with this thread's tile cache now, so the flags of its
+	// 2 bit tiles only tell which VRAM has been written since the last copy
+	if (memchr (IPPU.TileCached [TILE_2BIT], FALSE, MAX_2BIT_TILES)) {
+		if (f->VRAMCount == f->VRAMSize) {
+			f->VRAMSize = f->VRAMSize ? f->VRAMSize * 2 : 2;
+			f->VRAM = (uint8 **)
+				realloc (f->VRAM, f->VRAMSize * sizeof (uint8 *));
+			for (int i = f->VRAMCount; i < f->VRAMSize; i++)
+				f->VRAM [i] = (uint8 *) malloc (0x10000);
+		}
+		memcpy (f->VRAM [f->VRAMCount], Memory.VRAM, 0x10000);
+		u->VRAM = f->VRAMCount++;
+		memset (IPPU.TileCached [TILE_2BIT], TRUE, MAX_2BIT_TILES);
+	} else
+		u->VRAM = -1;
+
+	int start = IPPU.PreviousLine;
+	int end = IPPU.CurrentLine < 240 ? IPPU.CurrentLine : 240;
+	if (start < end) {
+		memcpy (&f->LineData [start], &LineData [start],
+			(end - start) * sizeof (struct SLineData));
+		memcpy (&f->LineMatrixData [start], &LineMatrixData [start],
+			(end - start) * sizeof (struct SLineMatrixData));
+	}
+
+	// Done with as far as this thread is concerned, as drawing would have
+	PPU.RecomputeClipWindows = FALSE;
+	IPPU.OBJChanged = FALSE;
+	IPPU.DirectColourMapsNeedRebuild = FALSE;
+	return TRUE;
+}
+
+void S9xRenderPipelineFlush ()
+{
+	struct Frame *f = &Pipe.Frames [Pipe.Recording ^ 1];
+
+	if (!Pipe.Pending)
+		return;
+
+	PipeWait ();
+	Pipe.Pending = FALSE;
+
+	IPPU.RenderedScreenWidth = f->RenderedScreenWidth;
+	IPPU.RenderedScreenHeight = f->RenderedScreenHeight;
+	IPPU.DoubleWidthPixels = f->DoubleWidthPixels;
+	S9xShowScreen ();
+}
+
+bool8 S9xRenderPipelineEndFrame ()
+{
+	struct Frame *f;
+
+	if (!Pipe.Running)
+		return FALSE;
+
+	// The frame before has to be drawn and shown before its buffers and
+	// the screen can be used for this one
+	S9xRenderPipelineFlush ();
+
+	f = &Pipe.Frames [Pipe.Recording];
+	f->GFX = GFX;
+	Pipe.Recording ^= 1;
+	Pipe.Pending = TRUE;
+	__sync_synchronize ();
+	Pipe.Posted++;
+	PipeWakeUp ();
+
+	f = &Pipe.Frames [Pipe.Recording];
+	f->Count = 0;
+	f->VRAMCount = 0;
+	return TRUE;
+}
+
+void S9xRenderPipelineStart ()
+{
+	// With one core the threads would only take turns at it
+	if (Pipe.Running || sysconf (_SC_NPROCESSORS_ONLN) < 2)
+		return;
+
+	PipeVRAM = (uint8 *) calloc (1, 0x10000);
+	PipeRegs = (uint8 *) calloc (1, 0x2200);
+	for (int t = 0; t < 3; t++) {
+		PipeTileCache [t] = (uint8 *) malloc (PipeTiles [t] * 64);
+		PipeTileCached [t] = (uint8 *) calloc (1, PipeTiles [t]);
+	}
+
+	Pipe.DrawTilePtr = DrawTilePtr;
+	Pipe.DrawClippedTilePtr = DrawClippedTilePtr;
+	Pipe.DrawHiResTilePtr = DrawHiResTilePtr;
+	Pipe.DrawHiResClippedTilePtr = DrawHiResClippedTilePtr;
+	Pipe.DrawLargePixelPtr = DrawLargePixelPtr;
+
+	Pipe.Posted = 0;
+	Pipe.Done = 0;
+	Pipe.Pending = FALSE;
+	Pipe.Quit = FALSE;
+	Pipe.Recording = 0;
+	Pipe.Frames [0].Count = Pipe.Frames [1].Count = 0;
+	Pipe.Frames [0].VRAMCount = Pipe.Frames [1].VRAMCount = 0;
+
+	// Have the first update copy VRAM
+	memset (IPPU.TileCached [TILE_2BIT], FALSE, MAX_2BIT_TILES);
+
+	Pipe.Running = TRUE;
+	if (pthread_create (&PipeId, NULL, PipeRun, NULL) != 0)
+		Pipe.Running = FALSE;
+}
+
+void S9xRenderPipelineStop ()
+{
+	if (!Pipe.Running)
+		return;
+
+	PipeWait ();
+	Pipe.Quit = TRUE;
+	PipeWakeUp ();
+	pthread_join (PipeId, NULL);
+	Pipe.Running = FALSE;
+	Pipe.Pending = FALSE;
+
+	for (int i = 0; i < 2; i++) {
+		struct Frame *f = &Pipe.Frames [i];
+
+		for (int v = 0; v < f->VRAMSize; v++)
+			free (f->VRAM [v]);
+		free (f->VRAM);
+		free (f->Updates);
+		memset (f, 0, sizeof (*f));
+	}
+	for (int t = 0; t < 3; t++) {
+		free (PipeTileCache [t]);
+		free (PipeTileCached [t]);
+	}
+	free (PipeVRAM);
+	free (PipeRegs);
+
+	// What this thread's tile cache and flags were not kept up to date for
+	memset (IPPU.TileCached [TILE_2BIT], FALSE, MAX_2BIT_TILES);
+	memset (IPPU.TileCached [TILE_4BIT], FALSE, MAX_4BIT_TILES);
+	memset (IPPU.TileCached [TILE_8BIT], FALSE, MAX_8BIT_TILES);
+	PPU.RecomputeClipWindows = TRUE;
+	IPPU.OBJChanged = TRUE;
+	IPPU.DirectColourMapsNeedRebuild = TRUE;
+}
+
+#else
+
+bool8 S9xRenderThreadsDraw ()
+{
+	return FALSE;
+}
+
+void S9xRenderThreadsStart ()
+{
+}
+
+void S9xRenderThreadsStop ()
+{
+}
+
+bool8 S9xRenderPipelineRecord ()
+{
+	return FALSE;
+}
+
+bool8 S9xRenderPipelineEndFrame ()
+{
+	return FALSE;
+}
+
+void S9xRenderPipelineFlush ()
+{
+}
+
+void S9xRenderPipelineStart ()
+{
+}
+
+void S9xRenderPipelineStop ()
+{
+}
+
+#endif
@@ -52,6 +52,7 @@
 #include "soundux.h"
 #include "cheats.h"
 #include "sa1.h"
+#include "profile.h"
 
 #ifdef NETPLAY_SUPPORT
 #include "netplay.h"
@@ -64,6 +65,10 @@ struct Missing missing;
 
 struct SICPU ICPU;
 
+#if CONF_PROFILE
+volatile uint8 S9xProfileSection = PROFILE_OTHER;
+#endif
+
 struct SCPUState CPU;
 
 //struct SRegisters Registers;
@@ -117,26 +122,26 @@ uint8 *SFXPlotTable = NULL;
 END_EXTERN_C
 #endif
 
-struct SPPU PPU;
-struct InternalPPU IPPU;
+GFX_THREAD_LOCAL struct SPPU PPU;
+GFX_THREAD_LOCAL struct InternalPPU IPPU;
 
 struct SDMA DMA[8];
 
 uint8 *HDMAMemPointers [8];
 uint8 *HDMABasePointers [8];
 
-struct SBG BG;
+GFX_THREAD_LOCAL struct SBG BG;
 
-struct SGFX GFX;
-struct SLineData LineData[240];
-struct SLineMatrixData LineMatrixData [240];
+GFX_THREAD_LOCAL struct SGFX GFX;
+GFX_THREAD_LOCAL struct SLineData LineData [240];
+GFX_THREAD_LOCAL struct SLineMatrixData LineMatrixData [240];
 
-uint8 Mode7Depths [2];
-NormalTileRenderer DrawTilePtr = NULL;
-ClippedTileRenderer DrawClippedTilePtr = NULL;
-NormalTileRenderer DrawHiResTilePtr = NULL;
-ClippedTileRenderer DrawHiResClippedTilePtr = NULL;
-LargePixelRenderer DrawLargePixelPtr = NULL;
+GFX_THREAD_LOCAL uint8 Mode7Depths [2];
+GFX_THREAD_LOCAL NormalTileRenderer DrawTilePtr = NULL;
+GFX_THREAD_LOCAL ClippedTileRenderer DrawClippedTilePtr = NULL;
+GFX_THREAD_LOCAL NormalTileRenderer DrawHiResTilePtr = NULL;
+GFX_THREAD_LOCAL ClippedTileRenderer DrawHiResClippedTilePtr = NULL;
+GFX_THREAD_LOCAL LargePixelRenderer DrawLargePixelPtr = NULL;
 
 uint32 odd_high[4][16];
 uint32 odd_low[4][16];
@@ -1,13 +1,30 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <zlib.h>
 
 #include "snes9x.h"
 #include "hacks.h"
 #include "memmap.h"
+#if !CONF_BUILD_ASM_CPU
+#include "cpublocks.h"
+#endif
 
 #define kLineBufferSize 4095
+#define kMaxPatches 64
+#define kMaxPatchBytes 4
+
+/** CRC of the ROM as loaded, before any patch. */
+static unsigned long romCrc;
+
+/** Patches found while running, see S9xHacksAddPatch. */
+static struct {
+	unsigned long addr;
+	int len;
+	unsigned char bytes[kMaxPatchBytes];
+} patches[kMaxPatches];
+static int patchCount;
 
 static inline unsigned long parseCrc32(const char * s)
 {
@@ -136,6 +153,11 @@ void S9xHacksLoadFile(const char * file)
 	char * line;
 	FILE * fp;
 
+	patchCount = 0;
+	if (Settings.HacksEnabled || Settings.HacksAuto) {
+		romCrc = getGameCrc32();
+	}
+
 	if (!Settings.HacksEnabled) goto no_hacks;
 	if (!file) goto no_hacks;
 
@@ -146,8 +168,7 @@ void S9xHacksLoadFile(const char * file)
 		goto no_hacks;
 	}
 
-	// Get current ROM CRC
-	gameCrc = getGameCrc32();
+	gameCrc = romCrc;
 
 	line = (char*) malloc(kLineBufferSize + 1);
 	do {
@@ -160,6 +181,10 @@ void S9xHacksLoadFile(const char * file)
 		if (gameCrc == parseCrc32(line)) {
 			// Hit! This line's CRC matches our current ROM CRC.
 			int res = loadHacks(pos + 1);
+#if !CONF_BUILD_ASM_CPU
+			// The patched ROM may already have been decoded
+			S9xCPUBlocksFlush();
+#endif
 			if (res > 0) {
 				printf("Hacks: searched %s for crc %lX, %d byte%s patched\n",
 					file, gameCrc, res, (res == 1 ? "" : "s"));
@@ -186,6 +211,103 @@ hacks_found:
 
 	return;
 no_hacks:
-	printf("Hacks: disabled\n");
+	if (Settings.HacksAuto) {
+		printf("Hacks: idle loop detection only\n");
+	} else {
+		printf("Hacks: disabled\n");
+	}
+}
+
+void S9xHacksAddPatch(unsigned long addr, const unsigned char * bytes, int len)
+{
+	printf("Hacks: patched idle loop at ROM[0x%lx]\n", addr);
+
+	if (patchCount == kMaxPatches || len > kMaxPatchBytes) return;
+
+	patches[patchCount].addr = addr;
+	patches[patchCount].len = len;
+	memcpy(patches[patchCount].bytes, bytes, len);
+	patchCount++;
 }
 
+void S9xHacksSaveFile(const char * file)
+{
+	char * line;
+	char * others = 0;
+	char * own = 0;
+	size_t othersLen = 0;
+	FILE * fp;
+
+	if (!file || !patchCount) return;
+
+	// Keep the lines for other games, and the one for ours to extend it
+	fp = fopen(file, "r");
+	if (fp) {
+		line = (char*) malloc(kLineBufferSize + 1);
+		while (fgets(line, kLineBufferSize, fp)) {
+			size_t len = strlen(line);
+			if (len && line[len - 1] != '\n') {
+				line[len++] = '\n';
+				line[len] = '\0';
+			}
+
+			if (strchr(line, '|') && parseCrc32(line) == romCrc) {
+				free(own);
+				own = strdup(line);
+				continue;
+			}
+
+			others = (char*) realloc(others, othersLen + len);
+			memcpy(others + othersLen, line, len);
+			othersLen += len;
+		}
+		free(line);
+		fclose(fp);
+	}
+
+	fp = fopen(file, "w");
+	if (!fp) {
+		fprintf(stderr, "Can't write hacks file %s: %s\n", file, strerror(errno));
+		free(others);
+		free(own);
+		return;
+	}
+
+	if (othersLen) fwrite(others, 1, othersLen, fp);
+
+	const char * sep = "";
+	if (own) {
+		int fields = 0;
+		own[strlen(own) - 1] = '\0';
+		for (char * c = strchr(own, '|'); c; c = strchr(c + 1, '|')) {
+			fields++;
+		}
+		// Lines with patches get more of them, lines without get the field
+		if (fields == 2 || fields == 8) {
+			sep = ",";
+		} else if (fields == 1 || fields == 7) {
+			sep = "|";
+		} else {
+			free(own);
+			own = 0;
+		}
+	}
+	if (own) {
+		fputs(own, fp);
+	} else {
+		fprintf(fp, "%08lX|%s|", romCrc, Memory.ROMName);
+	}
+	for (int i = 0; i < patchCount; i++) {
+		fprintf(fp, "%s%lX=", i ? "," : sep, patches[i].addr);
+		for (int j = 0; j < patches[i].len; j++) {
+			fprintf(fp, "%02X", patches[i].bytes[j]);
+		}
+	}
+	fputc('\n', fp);
+	fclose(fp);
+	free(others);
+	free(own);
+
+	printf("Hacks: saved %d patch%s for crc %lX to %s\n",
+		patchCount, (patchCount == 1 ? "" : "es"), romCrc, file);
+}
@@ -2,5 +2,10 @@
 #define _HACKS_H_
 
 void S9xHacksLoadFile(const char * file);
+/** Writes the patches found while running to a speedhacks file, replacing
+  * any line for the current ROM there. */
+void S9xHacksSaveFile(const char * file);
+/** Records a patch made to ROM[addr..addr + len - 1] for S9xHacksSaveFile. */
+void S9xHacksAddPatch(unsigned long addr, const unsigned char * bytes, int len);
 
 #endif
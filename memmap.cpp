@@ -171,9 +171,9 @@ bool8_32 CMemory::Init ()
   ROM     = (uint8 *) malloc (MAX_ROM_SIZE + 0x200 + 0x8000);
   FillRAM = NULL;
 
-  IPPU.TileCache [TILE_2BIT] = (uint8 *) malloc (MAX_2BIT_TILES * 128);
-  IPPU.TileCache [TILE_4BIT] = (uint8 *) malloc (MAX_4BIT_TILES * 128);
-  IPPU.TileCache [TILE_8BIT] = (uint8 *) malloc (MAX_8BIT_TILES * 128);
+  IPPU.TileCache [TILE_2BIT] = (uint8 *) malloc (MAX_2BIT_TILES * 64);
+  IPPU.TileCache [TILE_4BIT] = (uint8 *) malloc (MAX_4BIT_TILES * 64);
+  IPPU.TileCache [TILE_8BIT] = (uint8 *) malloc (MAX_8BIT_TILES * 64);
 
   IPPU.TileCached [TILE_2BIT] = (uint8 *) malloc (MAX_2BIT_TILES);
   IPPU.TileCached [TILE_4BIT] = (uint8 *) malloc (MAX_4BIT_TILES);
@@ -224,6 +224,12 @@ bool8_32 CMemory::Init ()
 
 void CMemory::Deinit ()
 {
+#ifdef USE_SA1
+  S9xSA1ThreadStop ();
+#endif
+#ifdef SUPER_FX
+  S9xSuperFXThreadStop ();
+#endif
   if (RAM)
   {
     free ((char *) RAM);
@@ -2130,6 +2136,13 @@ void CMemory::ApplyROMFixes ()
     strcmp (ROMName, "DIRT RACER") == 0 ||
     strcmp (ROMName, "Stunt Race FX") == 0 ||
     Settings.StarfoxHack;
+  // The GSU clock is 10.74 MHz and an instruction takes about 2.4 clocks;
+  // these games are known to want a little more.
+  if (Settings.WinterGold)
+    SuperFX.speedPerLine = 350;
+  else
+    SuperFX.speedPerLine = 10738635 / (ROMFramesPerSecond *
+      (Settings.PAL ? SNES_MAX_PAL_VCOUNTER : SNES_MAX_NTSC_VCOUNTER)) * 10 / 24;
   Settings.ChuckRock = strcmp (ROMName, "CHUCK ROCK") == 0;
   Settings.Dezaemon = strcmp (ROMName, "DEZAEMON") == 0;
 
@@ -2217,6 +2230,7 @@ void CMemory::ApplyROMFixes ()
   SA1.WaitAddress = NULL;
   SA1.WaitByteAddress1 = NULL;
   SA1.WaitByteAddress2 = NULL;
+  SA1.IdleLoop = NULL;
 
   /* Bass Fishing */
   if (strcmp (ROMId, "ZBPJ") == 0)
@@ -43,11 +43,47 @@
 
 #include "snes9x.h"
 
-#ifdef FAST_LSB_WORD_ACCESS
-#define READ_WORD(s) (*(uint16 *) (s))
-#define READ_DWORD(s) (*(uint32 *) (s))
-#define WRITE_WORD(s, d) (*(uint16 *) (s) = (d)
-#define WRITE_DWORD(s, d) (*(uint32 *) (s) = (d)
+#ifdef LSB_FIRST
+/* SNES words are little endian like the host, so they are read and written
+ * with one access that may be unaligned. memcpy of a constant size compiles
+ * to a single load or store wherever the CPU allows unaligned ones. */
+static inline uint16 S9xReadWord (const void *s)
+{
+    uint16 w;
+    memcpy (&w, s, sizeof (w));
+    return w;
+}
+static inline uint32 S9xRead3Word (const void *s)
+{
+    uint32 w = 0;
+    memcpy (&w, s, 3);
+    return w;
+}
+static inline uint32 S9xReadDWord (const void *s)
+{
+    uint32 w;
+    memcpy (&w, s, sizeof (w));
+    return w;
+}
+static inline void S9xWriteWord (void *s, uint16 d)
+{
+    memcpy (s, &d, sizeof (d));
+}
+static inline void S9xWrite3Word (void *s, uint32 d)
+{
+    memcpy (s, &d, 3);
+}
+static inline void S9xWriteDWord (void *s, uint32 d)
+{
+    memcpy (s, &d, sizeof (d));
+}
+
+#define READ_WORD(s) S9xReadWord (s)
+#define READ_3WORD(s) S9xRead3Word (s)
+#define READ_DWORD(s) S9xReadDWord (s)
+#define WRITE_WORD(s, d) S9xWriteWord ((s), (uint16) (d))
+#define WRITE_3WORD(s, d) S9xWrite3Word ((s), (uint32) (d))
+#define WRITE_DWORD(s, d) S9xWriteDWord ((s), (uint32) (d))
 #else
 #define READ_WORD(s) ( *(uint8 *) (s) |\
 		      (*((uint8 *) (s) + 1) << 8))
@@ -67,7 +103,6 @@
 #define READ_3WORD(s) ( *(uint8 *) (s) |\
                        (*((uint8 *) (s) + 1) << 8) |\
                        (*((uint8 *) (s) + 2) << 16))
-                          
 #endif
 
 #define MEMMAP_BLOCK_SIZE (0x1000)
@@ -125,7 +160,10 @@ public:
     enum {
 	MAP_PPU, MAP_CPU, MAP_DSP, MAP_LOROM_SRAM, MAP_HIROM_SRAM,
 	MAP_NONE, MAP_DEBUG, MAP_C4, MAP_BWRAM, MAP_BWRAM_BITMAP,
-	MAP_BWRAM_BITMAP2, MAP_SA1RAM, MAP_LAST
+	MAP_BWRAM_BITMAP2, MAP_SA1RAM,
+	MAP_SA1_SHARED,	// Shared with the SA-1 thread, see sa1thread.cpp
+	MAP_SUPERFX_SHARED,	// Shared with the GSU thread, see fxthread.cpp
+	MAP_LAST
     };
     enum { MAX_ROM_SIZE = 0x600000 };
     
@@ -183,6 +221,7 @@ END_EXTERN_C
 #ifdef NO_INLINE_SET_GET
 uint8 S9xGetByte (uint32 Address);
 uint16 S9xGetWord (uint32 Address);
+uint32 S9xGetLong (uint32 Address);
 void S9xSetByte (uint8 Byte, uint32 Address);
 void S9xSetWord (uint16 Byte, uint32 Address);
 void S9xSetPCBase (uint32 Address);
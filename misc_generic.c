@@ -0,0 +1,37 @@
+/* Generic memory routines, for targets without hand-written ones
+ * (see misc_armel.s and misc_i386.s for the assembler versions). */
+
+#include <string.h>
+#include <stdint.h>
+
+#include "misc.h"
+
+void memcpy16(void *dest, const void *src, int count)
+{
+	memcpy(dest, src, count * 2);
+}
+
+/* dest must be halfword aligned, src can be unaligned */
+void memcpy16bswap(void *dest, const void *src, int count)
+{
+	uint16_t *d = (uint16_t *) dest;
+	const uint8_t *s = (const uint8_t *) src;
+
+	while (count--) {
+		*d++ = (s[0] << 8) | s[1];
+		s += 2;
+	}
+}
+
+void memcpy32(void *dest, const void *src, int count)
+{
+	memcpy(dest, src, count * 4);
+}
+
+void memset32(void *dest, int c, int count)
+{
+	uint32_t *d = (uint32_t *) dest;
+
+	while (count--)
+		*d++ = c;
+}
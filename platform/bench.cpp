@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "platform.h"
+#include "snes9x.h"
+#include "memmap.h"
+#include "profile.h"
+#include "null.h"
+
+/** Frame throughput benchmark.
+	Runs the headless core for a fixed number of frames and prints a JSON
+	report with the frame rate and how wall time splits across subsystems.
+	The split comes from sampling S9xProfileSection (see profile.h) from a
+	high resolution timer, so the hot paths only pay for a byte store.
+ */
+
+#define kDefaultFrames		600
+#define kSampleIntervalNs	250000	// 4KHz, cheap enough not to skew the fps
+
+static const char * sectionNames[PROFILE_SECTIONS] = {
+	"other", "cpu", "apu", "render", "mix", "dma"
+};
+
+static volatile unsigned long samples[PROFILE_SECTIONS];
+
+static void sampleHandler(int sig)
+{
+	samples[S9xProfileSection]++;
+}
+
+static timer_t startSampling()
+{
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = sampleHandler;
+	sa.sa_flags = SA_RESTART;
+	sigaction(SIGPROF, &sa, 0);
+
+	struct sigevent sev;
+	memset(&sev, 0, sizeof(sev));
+	sev.sigev_notify = SIGEV_SIGNAL;
+	sev.sigev_signo = SIGPROF;
+
+	timer_t timer;
+	if (timer_create(CLOCK_MONOTONIC, &sev, &timer) != 0) {
+		perror("timer_create");
+		return 0;
+	}
+
+	struct itimerspec its;
+	its.it_interval.tv_sec = its.it_value.tv_sec = 0;
+	its.it_interval.tv_nsec = its.it_value.tv_nsec = kSampleIntervalNs;
+	timer_settime(timer, 0, &its, 0);
+
+	return timer;
+}
+
+static void stopSampling(timer_t timer)
+{
+	if (timer) timer_delete(timer);
+	signal(SIGPROF, SIG_IGN);
+}
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+/** Prints a string as a JSON string literal. */
+static void printJSONString(const char * s)
+{
+	putchar('"');
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\') {
+			printf("\\%c", *s);
+		} else if ((unsigned char) *s < 0x20) {
+			printf("\\u%04x", *s);
+		} else {
+			putchar(*s);
+		}
+	}
+	putchar('"');
+}
+
+static void printReport(double elapsed)
+{
+	unsigned long total = 0;
+	for (int i = 0; i < PROFILE_SECTIONS; i++)
+		total += samples[i];
+
+	printf("{\n");
+	printf("  \"rom\": "); printJSONString(Memory.ROMName); printf(",\n");
+	printf("  \"crc32\": \"%08lx\",\n",
+		crc32(crc32(0L, Z_NULL, 0), Memory.ROM, Memory.CalculatedSize));
+	printf("  \"frames\": %u,\n", Headless.frame);
+	printf("  \"seconds\": %.6f,\n", elapsed);
+	printf("  \"fps\": %.3f,\n", elapsed > 0 ? Headless.frame / elapsed : 0.0);
+	printf("  \"ms_per_frame\": %.6f,\n",
+		Headless.frame ? elapsed * 1000.0 / Headless.frame : 0.0);
+	printf("  \"samples\": %lu,\n", total);
+	printf("  \"sections\": {\n");
+	for (int i = 0; i < PROFILE_SECTIONS; i++) {
+		double share = total ? (double) samples[i] / total : 0.0;
+		printf("    \"%s\": { \"seconds\": %.6f, \"percent\": %.2f }%s\n",
+			sectionNames[i], elapsed * share, share * 100.0,
+			i + 1 < PROFILE_SECTIONS ? "," : "");
+	}
+	printf("  }\n");
+	printf("}\n");
+}
+
+int main(int argc, char ** argv)
+{
+	// Keep stdout for the report; the core chats on it while loading.
+	int report = dup(STDOUT_FILENO);
+	dup2(STDERR_FILENO, STDOUT_FILENO);
+
+	S9xHeadlessInit(argc, argv);
+	if (!Headless.frames)
+		Headless.frames = kDefaultFrames;
+
+	timer_t timer = startSampling();
+	const double start = now();
+	do {
+		S9xHeadlessRunFrame();
+	} while (Config.running && Headless.frame != Headless.frames);
+	const double elapsed = now() - start;
+	stopSampling(timer);
+
+	fflush(stdout);
+	dup2(report, STDOUT_FILENO);
+	close(report);
+	printReport(elapsed);
+	fflush(stdout);
+	dup2(STDERR_FILENO, STDOUT_FILENO);
+
+	return S9xHeadlessDeinit() ? 0 : 1;
+}
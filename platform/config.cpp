@@ -68,6 +68,24 @@ static struct poptOption commonOptionsTable[] = {
 	"enable all speedhacks (may break sound)", 0 },
 	{ "saver", 'R', POPT_ARG_NONE, 0, 20,
 	"save&exit when the emulator window is unfocused", 0 },
+	{ "auto-hacks", 'A', POPT_ARG_NONE, 0, 21,
+	"find and patch idle loops while running", 0 },
+	{ "fast-upload", 'U', POPT_ARG_NONE, 0, 22,
+	"skip the sound CPU during sound program uploads (changes timing)", 0 },
+	{ "sa1-thread", 'T', POPT_ARG_NONE, 0, 23,
+	"run the SA-1 coprocessor on a second core", 0 },
+	{ "superfx-thread", 'G', POPT_ARG_NONE, 0, 24,
+	"run the SuperFX coprocessor on a second core", 0 },
+	{ "predecode", 'P', POPT_ARG_NONE, 0, 25,
+	"decode the tiles VRAM DMAs write before drawing", 0 },
+	{ "render-threads", 'W', POPT_ARG_INT, 0, 26,
+	"draw the screen in bands on NUM threads", "NUM" },
+	{ "render-pipeline", 'L', POPT_ARG_NONE, 0, 27,
+	"draw each frame on a thread while the next is emulated", 0 },
+	{ "line-renderer", 'I', POPT_ARG_NONE, 0, 28,
+	"compose each line as palette indices, then blend it", 0 },
+	{ "mode7-smooth", 'M', POPT_ARG_NONE, 0, 29,
+	"smooth Mode 7 by interpolating between its pixels", 0 },
 	POPT_TABLEEND
 };
 
@@ -82,6 +100,8 @@ static struct poptOption configOptionsTable[] = {
 	"emulator action to do (fullscreen, quit, ...)", "action" },
 	{ "hacks-file", '\0', POPT_ARG_STRING, 0, 200,
 	"path to snesadvance.dat file", "FILE" },
+	{ "hacks-export", '\0', POPT_ARG_STRING, 0, 201,
+	"speedhacks file to save the idle loops found to", "FILE" },
 	POPT_TABLEEND
 };
 
@@ -402,6 +422,33 @@ static void parseArgs(poptContext optCon)
 			case 20:
 				Config.saver = true;
 				break;
+			case 21:
+				Settings.HacksAuto = TRUE;
+				break;
+			case 22:
+				Settings.APUFastUpload = TRUE;
+				break;
+			case 23:
+				Settings.ThreadedSA1 = TRUE;
+				break;
+			case 24:
+				Settings.ThreadedSuperFX = TRUE;
+				break;
+			case 25:
+				Settings.PreDecodeTiles = TRUE;
+				break;
+			case 26:
+				Settings.RenderThreads = atoi(poptGetOptArg(optCon));
+				break;
+			case 27:
+				Settings.RenderPipeline = TRUE;
+				break;
+			case 28:
+				Settings.LineRenderer = TRUE;
+				break;
+			case 29:
+				Settings.Mode7Interpolate = TRUE;
+				break;
 			case 100:
 				scancode = atoi(poptGetOptArg(optCon));
 				break;
@@ -423,6 +470,10 @@ static void parseArgs(poptContext optCon)
 				free(Config.hacksFile);
 				Config.hacksFile = strdup(poptGetOptArg(optCon));
 				break;
+			case 201:
+				free(Config.hacksExportFile);
+				Config.hacksExportFile = strdup(poptGetOptArg(optCon));
+				break;
 			default:
 				DIE("Invalid popt argument (this is a bug): %d", rc);
 				break;
@@ -477,5 +528,9 @@ void S9xUnloadConfig()
 		free(Config.hacksFile);
 		Config.hacksFile = 0;
 	}
+	if (Config.hacksExportFile) {
+		free(Config.hacksExportFile);
+		Config.hacksExportFile = 0;
+	}
 }
 
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <zlib.h>
+
+#include "platform.h"
+#include "snes9x.h"
+#include "memmap.h"
+#include "ppu.h"
+#include "gfx.h"
+#include "null.h"
+
+/** Golden output hashes.
+	A golden file holds one "FRAME VIDEO AUDIO" line per emulated frame,
+	where VIDEO is the CRC32 of the visible part of GFX.Screen and AUDIO the
+	CRC32 of the samples mixed during that frame. Recording one before a
+	refactor and checking against it afterwards catches any output change.
+ */
+
+struct GoldenEntry {
+	uint32 video;
+	uint32 audio;
+};
+
+static struct {
+	FILE * fp;
+	bool record;
+	GoldenEntry * entries;
+	unsigned int count;
+	bool failed;
+} golden;
+
+static uint32 hashScreen()
+{
+	uLong crc = crc32(0L, Z_NULL, 0);
+	const int width = IPPU.RenderedScreenWidth;
+	const int height = IPPU.RenderedScreenHeight;
+	const uint8 * line = GFX.Screen;
+
+	// Only the rendered area, line by line: the rest of the buffer and the
+	// pitch padding are not output and may hold anything.
+	for (int y = 0; y < height; y++, line += GFX.Pitch) {
+		crc = crc32(crc, line, width * sizeof(uint16));
+	}
+
+	return crc;
+}
+
+static uint32 hashAudio(const int16 * samples, int count)
+{
+	uLong crc = crc32(0L, Z_NULL, 0);
+	if (samples && count > 0) {
+		crc = crc32(crc, (const Bytef *) samples, count * sizeof(int16));
+	}
+	return crc;
+}
+
+static bool loadGolden(FILE * fp)
+{
+	char line[128];
+	unsigned int size = 0;
+
+	while (fgets(line, sizeof(line), fp)) {
+		unsigned int frame;
+		GoldenEntry e;
+
+		if (line[0] == '#' || line[0] == '\n') continue;
+		if (sscanf(line, "%u %x %x", &frame, &e.video, &e.audio) != 3 ||
+			frame != golden.count) {
+			fprintf(stderr, "Bad golden line: %s", line);
+			return false;
+		}
+
+		if (golden.count == size) {
+			size = size ? size * 2 : 1024;
+			golden.entries = (GoldenEntry *)
+				realloc(golden.entries, size * sizeof(GoldenEntry));
+		}
+		golden.entries[golden.count++] = e;
+	}
+
+	return true;
+}
+
+bool S9xGoldenOpen(const char * file, bool record)
+{
+	golden.record = record;
+	golden.failed = false;
+	golden.count = 0;
+
+	if (record) {
+		golden.fp = fopen(file, "w");
+		if (!golden.fp) return false;
+		fprintf(golden.fp, "# %s %08lx\n", Memory.ROMName,
+			crc32(crc32(0L, Z_NULL, 0), Memory.ROM, Memory.CalculatedSize));
+		return true;
+	}
+
+	FILE * fp = fopen(file, "r");
+	if (!fp) return false;
+	bool ok = loadGolden(fp);
+	fclose(fp);
+
+	return ok;
+}
+
+unsigned int S9xGoldenFrames()
+{
+	return golden.record ? 0 : golden.count;
+}
+
+bool S9xGoldenFrame(unsigned int frame, const int16 * samples, int count)
+{
+	GoldenEntry e;
+
+	e.video = hashScreen();
+	e.audio = hashAudio(samples, count);
+
+	if (golden.record) {
+		fprintf(golden.fp, "%u %08x %08x\n", frame, e.video, e.audio);
+		return true;
+	}
+
+	if (frame >= golden.count) {
+		fprintf(stderr, "Golden run ends before frame %u\n", frame);
+		golden.failed = true;
+		return false;
+	}
+
+	const GoldenEntry& g = golden.entries[frame];
+	if (g.video != e.video) {
+		fprintf(stderr, "Frame %u: video differs (expected %08x, got %08x)\n",
+			frame, g.video, e.video);
+		golden.failed = true;
+	}
+	if (g.audio != e.audio) {
+		fprintf(stderr, "Frame %u: audio differs (expected %08x, got %08x)\n",
+			frame, g.audio, e.audio);
+		golden.failed = true;
+	}
+
+	return !golden.failed;
+}
+
+bool S9xGoldenClose()
+{
+	if (golden.fp) {
+		fclose(golden.fp);
+		golden.fp = 0;
+	}
+
+	free(golden.entries);
+	golden.entries = 0;
+	golden.count = 0;
+
+	return !golden.failed;
+}
@@ -0,0 +1,32 @@
+#include <stdio.h>
+#include <sys/time.h>
+
+#include "platform.h"
+#include "snes9x.h"
+#include "null.h"
+
+static double now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+int main(int argc, char ** argv)
+{
+	S9xHeadlessInit(argc, argv);
+
+	// No frameSync() here: run as fast as the host allows.
+	const double start = now();
+	do {
+		S9xHeadlessRunFrame();
+	} while (Config.running && Headless.frame != Headless.frames);
+	const double elapsed = now() - start;
+
+	if (Headless.verbose)
+		printf("%u frames in %.3f s: %.2f fps\n",
+			Headless.frame, elapsed,
+			elapsed > 0 ? Headless.frame / elapsed : 0.0);
+
+	return S9xHeadlessDeinit() ? 0 : 1;
+}
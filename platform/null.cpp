@@ -0,0 +1,383 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "platform.h"
+#include "port.h"
+#include "snes9x.h"
+#include "memmap.h"
+#include "ppu.h"
+#include "cpuexec.h"
+#include "display.h"
+#include "gfx.h"
+#include "soundux.h"
+#include "snapshot.h"
+#include "hacks.h"
+#include "null.h"
+
+#define DIE(format, ...) do { \
+		fprintf(stderr, "Died at %s:%d: ", __FILE__, __LINE__ ); \
+		fprintf(stderr, format "\n", ## __VA_ARGS__); \
+		abort(); \
+	} while (0);
+
+struct config Config;
+struct headless Headless;
+
+/** Options normally owned by the WebOS option menu (see Options.cpp). */
+int soundMute = false;
+int showSpeed = false;
+int UseTransparency = true;
+
+/** Path to current rom file, with extension. */
+static char * romFile;
+/** Path to rom file, without extension. */
+static char * basePath;
+
+void S9xMessage(int type, int number, const char * message)
+{
+	if (Headless.verbose)
+		printf("%s\n", message);
+}
+
+void S9xAutoSaveSRAM()
+{
+	// Nothing: the headless build never writes to disk behind our back.
+}
+
+const char * S9xGetFilename(FileTypes file)
+{
+	static char filename[PATH_MAX + 1];
+	const char * ext;
+	switch (file) {
+		case FILE_ROM:
+			return romFile;
+		case FILE_SRAM:
+			ext = "srm";
+			break;
+		case FILE_FREEZE:
+			ext = "frz.gz";
+			break;
+		case FILE_CHT:
+			ext = "cht";
+			break;
+		case FILE_IPS:
+			ext = "ips";
+			break;
+		case FILE_SCREENSHOT:
+			ext = "png";
+			break;
+		case FILE_SDD1_DAT:
+			ext = "dat";
+			break;
+		default:
+			ext = "???";
+			break;
+	}
+
+	snprintf(filename, PATH_MAX, "%s.%s", basePath, ext);
+	return filename;
+}
+
+const char * S9xGetQuickSaveFilename(unsigned int slot)
+{
+	static char filename[PATH_MAX + 1];
+	snprintf(filename, PATH_MAX, "%s.frz.%u.gz", basePath, slot);
+	return filename;
+}
+
+void S9xSetRomFile(const char * path)
+{
+	if (romFile) {
+		free(romFile);
+		free(basePath);
+	}
+
+	romFile = strndup(path, PATH_MAX);
+	basePath = strdup(romFile);
+
+	// Truncate base path at the last '.' char, ignoring a trailing .gz
+	char * c = strrchr(basePath, '.');
+	if (c) {
+		if (strcasecmp(c, ".gz") == 0) {
+			*c = '\0';
+			c = strrchr(basePath, '.');
+		}
+		if (c && !strchr(c, '/')) {
+			*c = '\0';
+		}
+	}
+}
+
+static void loadDefaults()
+{
+	ZeroMemory(&Settings, sizeof(Settings));
+	ZeroMemory(&Config, sizeof(Config));
+	ZeroMemory(&Headless, sizeof(Headless));
+
+	romFile = 0;
+	basePath = 0;
+
+	Config.enableAudio = true;
+	Config.joypad1Enabled = true;
+
+	Settings.SoundPlaybackRate = 22050;
+	Settings.Stereo = TRUE;
+	Settings.SoundBufferSize = 512; // in samples
+	Settings.CyclesPercentage = 100;
+	Settings.APUEnabled = FALSE;		// We'll enable it later
+	Settings.H_Max = SNES_CYCLES_PER_SCANLINE;
+	Settings.SkipFrames = 1;
+	Settings.Shutdown = Settings.ShutdownMaster = TRUE;
+	Settings.FrameTimePAL = 20;	// in msecs
+	Settings.FrameTimeNTSC = 16;
+	Settings.FrameTime = Settings.FrameTimeNTSC;
+	Settings.ControllerOption = SNES_JOYPAD;
+	Settings.TurboMode = TRUE;	// There is no frameSync to sleep in anyway
+
+	Settings.HBlankStart = (256 * Settings.H_Max) / SNES_HCOUNTER_MAX;
+
+	Settings.AutoSaveDelay = 0;
+}
+
+static void usage(const char * argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [options] ROM\n"
+		"  -a        disable audio emulation and mixing\n"
+		"  -f NUM    emulate NUM frames then exit (default: run forever)\n"
+		"  -s NUM    render only 1 in every NUM frames\n"
+		"  -p        run in PAL mode\n"
+		"  -n        run in NTSC mode\n"
+		"  -H FILE   load speedhacks from FILE\n"
+		"  -A        find and patch idle loops while running\n"
+		"  -E FILE   save the idle loops found to speedhacks FILE on exit\n"
+		"  -U        skip the SPC700 during IPL uploads (changes timing)\n"
+		"  -T        run the SA-1 on a second thread\n"
+		"  -G        run the SuperFX on a second thread\n"
+		"  -P        decode the tiles VRAM DMAs write before drawing\n"
+		"  -W NUM    draw the screen in bands on NUM threads\n"
+		"  -L        draw each frame on a thread while the next is emulated\n"
+		"  -I        compose each line as palette indices, then blend it\n"
+		"  -M        smooth Mode 7 by interpolating between its pixels\n"
+		"  -S FILE   unfreeze snapshot FILE after loading the ROM\n"
+		"  -i FILE   replay joypad input script FILE\n"
+		"  -g FILE   record per frame video/audio hashes to golden FILE\n"
+		"  -c FILE   check video/audio against golden FILE\n"
+		"  -v        print emulator messages and timing\n",
+		argv0);
+	exit(2);
+}
+
+void S9xLoadConfig(int argc, char ** argv)
+{
+	int opt;
+
+	loadDefaults();
+
+	while ((opt = getopt(argc, argv, "af:s:pnH:AE:UTGPW:LIMS:i:g:c:v")) != -1) {
+		switch (opt) {
+			case 'a':
+				Config.enableAudio = false;
+				break;
+			case 'f':
+				Headless.frames = strtoul(optarg, 0, 10);
+				break;
+			case 's':
+				Settings.SkipFrames = atoi(optarg);
+				if (Settings.SkipFrames < 1) Settings.SkipFrames = 1;
+				break;
+			case 'p':
+				Settings.ForcePAL = TRUE;
+				break;
+			case 'n':
+				Settings.ForceNTSC = TRUE;
+				break;
+			case 'H':
+				free(Config.hacksFile);
+				Config.hacksFile = strdup(optarg);
+				Settings.HacksEnabled = TRUE;
+				break;
+			case 'A':
+				Settings.HacksAuto = TRUE;
+				break;
+			case 'E':
+				free(Config.hacksExportFile);
+				Config.hacksExportFile = strdup(optarg);
+				break;
+			case 'U':
+				Settings.APUFastUpload = TRUE;
+				break;
+			case 'T':
+				Settings.ThreadedSA1 = TRUE;
+				break;
+			case 'G':
+				Settings.ThreadedSuperFX = TRUE;
+				break;
+			case 'P':
+				Settings.PreDecodeTiles = TRUE;
+				break;
+			case 'W':
+				Settings.RenderThreads = atoi(optarg);
+				break;
+			case 'L':
+				Settings.RenderPipeline = TRUE;
+				break;
+			case 'I':
+				Settings.LineRenderer = TRUE;
+				break;
+			case 'M':
+				Settings.Mode7Interpolate = TRUE;
+				break;
+			case 'S':
+				free(Headless.stateFile);
+				Headless.stateFile = strdup(optarg);
+				break;
+			case 'i':
+				free(Headless.inputFile);
+				Headless.inputFile = strdup(optarg);
+				break;
+			case 'g':
+			case 'c':
+				free(Headless.goldenFile);
+				Headless.goldenFile = strdup(optarg);
+				Headless.goldenRecord = opt == 'g';
+				break;
+			case 'v':
+				Headless.verbose = true;
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+
+	if (optind != argc - 1)
+		usage(argv[0]);
+
+	S9xSetRomFile(argv[optind]);
+}
+
+void S9xUnloadConfig()
+{
+	free(romFile); romFile = 0;
+	free(basePath); basePath = 0;
+	free(Config.hacksFile); Config.hacksFile = 0;
+	free(Config.hacksExportFile); Config.hacksExportFile = 0;
+	free(Headless.stateFile); Headless.stateFile = 0;
+	free(Headless.inputFile); Headless.inputFile = 0;
+	free(Headless.goldenFile); Headless.goldenFile = 0;
+}
+
+static void S9xInit()
+{
+	if (!Memory.Init () || !S9xInitAPU())
+		DIE("Memory or APU failed");
+
+	if (!S9xInitSound ())
+		DIE("Sound failed");
+	S9xSetSoundMute (TRUE);
+
+	Settings.PAL = Settings.ForcePAL;
+
+	Settings.FrameTime = Settings.PAL?Settings.FrameTimePAL:Settings.FrameTimeNTSC;
+	Memory.ROMFramesPerSecond = Settings.PAL?50:60;
+
+	IPPU.RenderThisFrame = TRUE;
+}
+
+static void loadRom()
+{
+	const char * file = S9xGetFilename(FILE_ROM);
+
+	if (!Memory.LoadROM(file))
+		DIE("Loading ROM failed: %s", file);
+
+	if (Headless.stateFile && !S9xUnfreezeGame(Headless.stateFile))
+		DIE("Unfreezing %s failed", Headless.stateFile);
+
+	if (Headless.inputFile && !S9xInputScriptLoad(Headless.inputFile))
+		DIE("Loading input script %s failed", Headless.inputFile);
+
+	if (Headless.goldenFile) {
+		if (!S9xGoldenOpen(Headless.goldenFile, Headless.goldenRecord))
+			DIE("Opening golden file %s failed", Headless.goldenFile);
+		// When checking, run as long as the golden run did by default
+		if (!Headless.frames)
+			Headless.frames = S9xGoldenFrames();
+	}
+}
+
+void S9xHeadlessInit(int argc, char ** argv)
+{
+	S9xLoadConfig(argc, argv);
+
+	S9xInitDisplay(argc, argv);
+	S9xInitAudioOutput();
+	S9xInitInputDevices();
+
+	S9xInit();
+	S9xReset();
+
+	loadRom();
+
+	S9xHacksLoadFile(Config.hacksFile);
+	if (!S9xGraphicsInit())
+		DIE("S9xGraphicsInit failed");
+	S9xAudioOutputEnable(true);
+	S9xVideoReset();
+
+	Config.running = true;
+
+	if (Headless.verbose)
+		printf("ROM: %s (%s)\n", Memory.ROMName, Memory.MapType());
+}
+
+bool S9xHeadlessDeinit()
+{
+	bool matched = S9xGoldenClose();
+	S9xHacksSaveFile(Config.hacksExportFile);
+
+	S9xGraphicsDeinit();
+	Memory.Deinit();
+	S9xDeinitAPU();
+
+	S9xAudioOutputEnable(false);
+	S9xDeinitInputDevices();
+	S9xDeinitAudioOutput();
+	S9xDeinitDisplay();
+
+	S9xUnloadConfig();
+
+	return matched;
+}
+
+void S9xHeadlessRunFrame()
+{
+	static unsigned int skipped = 0;
+
+	IPPU.RenderThisFrame = ++skipped >= Settings.SkipFrames;
+	if (IPPU.RenderThisFrame)
+		skipped = 0;
+
+	S9xInputScriptFrame(Headless.frame);
+	S9xMainLoop();
+
+	const int16 * samples = 0;
+	int count = 0;
+	if (Config.enableAudio) {
+		samples = S9xAudioOutputPull(&count);
+	}
+
+	// The golden hashes are of the frame just emulated, which the render
+	// pipeline would otherwise only show at the end of the next one
+	if (Headless.goldenFile)
+		S9xRenderPipelineFlush();
+
+	if (Headless.goldenFile &&
+			!S9xGoldenFrame(Headless.frame, samples, count)) {
+		Config.running = false;
+	}
+
+	Headless.frame++;
+}
@@ -0,0 +1,68 @@
+#ifndef _PLATFORM_NULL_H_
+#define _PLATFORM_NULL_H_
+
+#include "port.h"
+
+/** Headless ("null") platform layer.
+	Implements the platform.h video/audio/input entry points without touching
+	any host device, so that the core can run on a build machine as fast as
+	the host allows.
+ */
+
+extern struct headless {
+	/** Number of frames to emulate, 0 to run forever */
+	unsigned int frames;
+	/** Frames emulated so far */
+	unsigned int frame;
+	/** Print emulator messages and timing to stdout */
+	bool verbose;
+	/** Snapshot to unfreeze right after loading the ROM, or NULL */
+	char * stateFile;
+	/** Scripted joypad input to replay, or NULL */
+	char * inputFile;
+	/** Golden output hashes to record or check against, or NULL */
+	char * goldenFile;
+	/** Whether goldenFile is being recorded rather than checked */
+	bool goldenRecord;
+} Headless;
+
+/** Initializes the core, loads the ROM and optional snapshot and input. */
+void S9xHeadlessInit(int argc, char ** argv);
+/** @return false if the output diverged from the golden file. */
+bool S9xHeadlessDeinit();
+
+/** Runs exactly one emulated frame and pulls that frame's audio.
+	Stops the run (Config.running) at the first frame that diverges from
+	the golden file being checked.
+ */
+void S9xHeadlessRunFrame();
+
+/** Mixes one frame worth of audio, like the SDL audio callback would.
+	@param count receives the number of 16 bit samples mixed
+	@return the mixed samples, valid until the next call
+ */
+const int16 * S9xAudioOutputPull(int * count);
+
+/** Loads a joypad input script.
+	Each line reads "FRAME PAD1 [PAD2]": from FRAME onwards the pads hold the
+	given buttons, either a hex mask or names joined by '+' (e.g. "A+START"),
+	or '-' for none. Lines starting with '#' are ignored.
+	@return false if the file cannot be read or parsed.
+ */
+bool S9xInputScriptLoad(const char * file);
+/** Applies the script entries that start at the given frame. */
+void S9xInputScriptFrame(unsigned int frame);
+
+/** Opens a golden file, either for writing or to check later frames. */
+bool S9xGoldenOpen(const char * file, bool record);
+/** @return number of frames in the golden file being checked, or 0. */
+unsigned int S9xGoldenFrames();
+/** Hashes the frame just emulated and records or checks it.
+	@param samples audio mixed during the frame, or NULL if none
+	@return false if the frame diverged from the golden file.
+ */
+bool S9xGoldenFrame(unsigned int frame, const int16 * samples, int count);
+/** @return false if any checked frame diverged. */
+bool S9xGoldenClose();
+
+#endif
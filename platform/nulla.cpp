@@ -0,0 +1,59 @@
+#include <stdio.h>
+
+#include "platform.h"
+#include "snes9x.h"
+#include "memmap.h"
+#include "soundux.h"
+#include "null.h"
+
+/** Holds one frame worth of mixed audio; sized for 48KHz stereo at 50Hz. */
+static int16 buffer[2 * 48000 / 50];
+
+void S9xInitAudioOutput()
+{
+	if (!Config.enableAudio) goto no_audio;
+
+	if (Settings.SoundPlaybackRate > 48000)
+		Settings.SoundPlaybackRate = 48000;
+
+	Settings.APUEnabled = TRUE;
+	Settings.SixteenBitSound = TRUE;
+
+	return;
+
+no_audio:
+	Settings.APUEnabled = FALSE;
+	return;
+}
+
+void S9xDeinitAudioOutput()
+{
+	// Nothing
+}
+
+void S9xAudioOutputEnable(bool enable)
+{
+	if (!Config.enableAudio) return;
+	if (enable)	{
+		CPU.APU_APUExecuting = Settings.APUEnabled = TRUE;
+		so.stereo = Settings.Stereo;
+		so.playback_rate = Settings.SoundPlaybackRate;
+		S9xSetPlaybackRate(so.playback_rate);
+		S9xSetSoundMute(FALSE);
+	} else {
+		S9xSetSoundMute(TRUE);
+	}
+}
+
+const int16 * S9xAudioOutputPull(int * count)
+{
+	// Pull what a real output device would have consumed during one frame.
+	int samples = Settings.SoundPlaybackRate / Memory.ROMFramesPerSecond;
+	if (Settings.Stereo)
+		samples *= 2;
+
+	S9xMixSamples(buffer, samples);
+
+	*count = samples;
+	return buffer;
+}
@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "platform.h"
+#include "snes9x.h"
+#include "display.h"
+#include "null.h"
+
+static uint32 joypads[2];
+
+/** One line of an input script: pad state from a given frame onwards. */
+struct InputScriptEntry {
+	unsigned int frame;
+	uint32 pads[2];
+};
+
+static struct {
+	InputScriptEntry * entries;
+	unsigned int count;
+	unsigned int next;
+} script;
+
+static const struct {
+	const char * name;
+	uint32 mask;
+} buttonNames[] = {
+	{ "A", SNES_A_MASK }, { "B", SNES_B_MASK },
+	{ "X", SNES_X_MASK }, { "Y", SNES_Y_MASK },
+	{ "L", SNES_TL_MASK }, { "R", SNES_TR_MASK },
+	{ "UP", SNES_UP_MASK }, { "DOWN", SNES_DOWN_MASK },
+	{ "LEFT", SNES_LEFT_MASK }, { "RIGHT", SNES_RIGHT_MASK },
+	{ "START", SNES_START_MASK }, { "SELECT", SNES_SELECT_MASK }
+};
+
+static bool parseButtons(char * s, uint32 * mask)
+{
+	char * end;
+
+	*mask = 0;
+	if (strcmp(s, "-") == 0) return true;
+
+	*mask = strtoul(s, &end, 16);
+	if (*end == '\0') return true;
+
+	*mask = 0;
+	for (char * name = strtok(s, "+"); name; name = strtok(0, "+")) {
+		unsigned int i;
+		for (i = 0; i < sizeof(buttonNames) / sizeof(buttonNames[0]); i++) {
+			if (strcasecmp(name, buttonNames[i].name) == 0) break;
+		}
+		if (i == sizeof(buttonNames) / sizeof(buttonNames[0])) {
+			fprintf(stderr, "Bad button name: %s\n", name);
+			return false;
+		}
+		*mask |= buttonNames[i].mask;
+	}
+
+	return true;
+}
+
+bool S9xInputScriptLoad(const char * file)
+{
+	char line[256];
+	unsigned int size = 0;
+	FILE * fp = fopen(file, "r");
+	if (!fp) return false;
+
+	free(script.entries);
+	script.entries = 0;
+	script.count = script.next = 0;
+
+	while (fgets(line, sizeof(line), fp)) {
+		char pad1[128], pad2[128] = "-";
+		InputScriptEntry e;
+
+		if (line[0] == '#' || line[0] == '\n') continue;
+		if (sscanf(line, "%u %127s %127s", &e.frame, pad1, pad2) < 2 ||
+			!parseButtons(pad1, &e.pads[0]) || !parseButtons(pad2, &e.pads[1])) {
+			fprintf(stderr, "Bad input script line: %s", line);
+			fclose(fp);
+			return false;
+		}
+
+		if (script.count == size) {
+			size = size ? size * 2 : 64;
+			script.entries = (InputScriptEntry *)
+				realloc(script.entries, size * sizeof(InputScriptEntry));
+		}
+		script.entries[script.count++] = e;
+	}
+
+	fclose(fp);
+	return true;
+}
+
+void S9xInputScriptFrame(unsigned int frame)
+{
+	while (script.next < script.count &&
+			script.entries[script.next].frame <= frame) {
+		const InputScriptEntry& e = script.entries[script.next++];
+		for (int i = 0; i < 2; i++) {
+			joypads[i] = (joypads[i] & 0x80000000UL) | e.pads[i];
+		}
+	}
+}
+
+void S9xInitInputDevices()
+{
+	joypads[0] = Config.joypad1Enabled ? 0x80000000UL : 0;
+	joypads[1] = Config.joypad2Enabled ? 0x80000000UL : 0;
+}
+
+void S9xDeinitInputDevices()
+{
+	joypads[0] = joypads[1] = 0;
+
+	free(script.entries);
+	script.entries = 0;
+	script.count = script.next = 0;
+}
+
+void S9xInputScreenChanged()
+{
+	// Nothing
+}
+
+void S9xInputScreenDraw(int pixelSize, void * buffer, int pitch)
+{
+	// Nothing
+}
+
+/** Nothing to poll; joypads hold whatever the input script says. */
+void S9xProcessEvents(bool block)
+{
+	// Nothing
+}
+
+uint32 S9xReadJoypad (int which)
+{
+	if (which < 0 || which >= 2) {
+		return 0;
+	}
+
+	return joypads[which];
+}
+
+bool8 S9xReadMousePosition(int which1, int& x, int& y, uint32& buttons)
+{
+	return FALSE;
+}
+
+bool8 S9xReadSuperScopePosition(int& x, int& y, uint32& buttons)
+{
+	return FALSE;
+}
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "snes9x.h"
+#include "platform.h"
+#include "display.h"
+#include "gfx.h"
+#include "ppu.h"
+
+struct gui GUI;
+
+void S9xSetTitle(const char *title)
+{
+	// Nothing
+}
+
+static void freeVideoSurface()
+{
+	free(GFX.Screen); GFX.Screen = 0;
+	free(GFX.SubScreen); GFX.SubScreen = 0;
+	free(GFX.ZBuffer); GFX.ZBuffer = 0;
+	free(GFX.SubZBuffer); GFX.SubZBuffer = 0;
+}
+
+static void setupVideoSurface()
+{
+	const unsigned gameWidth = IMAGE_WIDTH;
+	const unsigned gameHeight = IMAGE_HEIGHT;
+
+	GUI.Width = GUI.RenderW = gameWidth;
+	GUI.Height = GUI.RenderH = gameHeight;
+	GUI.RenderX = GUI.RenderY = 0;
+	GUI.ScaleX = GUI.ScaleY = 1.0;
+
+	// gfx & tile.cpp depend on the zbuffer pitch being always half of the
+	// color buffer pitch.
+	GFX.Pitch = gameWidth * 2;
+	GFX.ZPitch = GFX.Pitch / 2;
+
+	GFX.Screen = (uint8 *) calloc(1, GFX.Pitch * gameHeight);
+	GFX.SubScreen = (uint8 *) calloc(1, GFX.Pitch * gameHeight);
+	GFX.ZBuffer = (uint8 *) calloc(1, GFX.ZPitch * gameHeight);
+	GFX.SubZBuffer = (uint8 *) calloc(1, GFX.ZPitch * gameHeight);
+
+	GFX.Delta = (GFX.SubScreen - GFX.Screen) >> 1;
+	GFX.DepthDelta = GFX.SubZBuffer - GFX.ZBuffer;
+	GFX.PPL = GFX.Pitch / 2;
+}
+
+void S9xVideoReset()
+{
+	memset(GFX.Screen, 0, GFX.Pitch * IMAGE_HEIGHT);
+	memset(GFX.SubScreen, 0, GFX.Pitch * IMAGE_HEIGHT);
+	memset(GFX.ZBuffer, 0, GFX.ZPitch * IMAGE_HEIGHT);
+	memset(GFX.SubZBuffer, 0, GFX.ZPitch * IMAGE_HEIGHT);
+}
+
+void S9xInitDisplay(int argc, char ** argv)
+{
+	setupVideoSurface();
+}
+
+void S9xDeinitDisplay()
+{
+	freeVideoSurface();
+}
+
+void S9xVideoToggleFullscreen()
+{
+	// Nothing
+}
+
+void S9xVideoTakeScreenshot(void)
+{
+	// Nothing
+}
+
+void S9xSetPalette ()
+{
+	// Nothing
+}
+
+/** Called before rendering a frame.
+	GFX.Screen was allocated when initializing video output.
+	@return TRUE if we should render the frame.
+ */
+bool8_32 S9xInitUpdate ()
+{
+	return TRUE;
+}
+
+/** Called once a complete SNES screen has been rendered into GFX.Screen.
+	There is nowhere to show it, so it is simply left there for whoever
+	drives the headless core to inspect.
+ */
+bool8_32 S9xDeinitUpdate (int width, int height)
+{
+	return TRUE;
+}
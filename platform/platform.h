@@ -24,6 +24,8 @@ extern struct config {
 	bool saver;
 	/** Speedhacks file to use */
 	char * hacksFile;
+	/** Speedhacks file to save the idle loops found to on exit */
+	char * hacksExportFile;
 	/** Enable player 1 joypad */
 	bool joypad1Enabled;
 	/** Enable player 2 joypad */
@@ -301,6 +301,7 @@ int main(int argc, char ** argv) {
 
     // Save state
     Memory.SaveSRAM(S9xGetFilename(FILE_SRAM));
+    S9xHacksSaveFile(Config.hacksExportFile);
     pauseGame();
     Memory.Deinit();
     S9xDeinitAPU();
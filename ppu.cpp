@@ -85,42 +85,19 @@ void S9xUpdateHTimer ()
 	    if (PPU.HTimerPosition < CPU.Cycles)
 	    {
 		// Missed the IRQ on this line already
-		if (CPU.WhichEvent == HBLANK_END_EVENT ||
-		    CPU.WhichEvent == HTIMER_AFTER_EVENT)
-		{
-		    CPU.WhichEvent = HBLANK_END_EVENT;
-		    CPU.NextEvent = Settings.H_Max;
-		}
-		else
-		{
-		    CPU.WhichEvent = HBLANK_START_EVENT;
-		    CPU.NextEvent = Settings.HBlankStart;
-		}
+		S9xCancelEvent (HTIMER_BEFORE_EVENT);
+		S9xCancelEvent (HTIMER_AFTER_EVENT);
 	    }
 	    else
+	    if (S9xEventPending (HBLANK_START_EVENT))
 	    {
-			if (CPU.WhichEvent == HTIMER_BEFORE_EVENT ||
-				CPU.WhichEvent == HBLANK_START_EVENT)
-			{
-				if (PPU.HTimerPosition > Settings.HBlankStart)
-				{
-					// HTimer was to trigger before h-blank start,
-					// now triggers after start of h-blank
-					CPU.NextEvent = Settings.HBlankStart;
-					CPU.WhichEvent = HBLANK_START_EVENT;
-				}
-				else
-				{
-					CPU.NextEvent = PPU.HTimerPosition;
-					CPU.WhichEvent = HTIMER_BEFORE_EVENT;
-				}
-			}
-			else
-			{
-				CPU.WhichEvent = HTIMER_AFTER_EVENT;
-				CPU.NextEvent = PPU.HTimerPosition;
-			}
+		S9xCancelEvent (HTIMER_BEFORE_EVENT);
+		// An H-IRQ after the start of h-blank is queued then
+		if (PPU.HTimerPosition < Settings.HBlankStart)
+		    S9xScheduleEvent (HTIMER_BEFORE_EVENT, PPU.HTimerPosition);
 	    }
+	    else
+		S9xScheduleEvent (HTIMER_AFTER_EVENT, PPU.HTimerPosition);
 	}
     }
 }
@@ -867,6 +844,7 @@ void S9xSetPPU(uint8 Byte, uint16 Address)
 				_SPCInPB(Address & 3, Byte);
 #else
 				//	CPU.Flags |= DEBUG_MODE_FLAG;
+				S9xAPUCatchUp ();
 				Memory.FillRAM[Address] = Byte;
 				IAPU.RAM[(Address & 3) + 0xf4] = Byte;
 	#ifdef SPC700_SHUTDOWN
@@ -899,7 +877,10 @@ void S9xSetPPU(uint8 Byte, uint16 Address)
 		if (Settings.SA1)
 		{
 			if (Address >= 0x2200 && Address < 0x23ff)
+			{
+				S9xSA1Sync();
 				S9xSetSA1(Byte, Address);
+			}
 			else
 				Memory.FillRAM[Address] = Byte;
 			return;
@@ -929,6 +910,7 @@ void S9xSetPPU(uint8 Byte, uint16 Address)
 				if (!Settings.SuperFX)
 					return;
 
+					S9xSuperFXSync();
 					switch (Address)
 					{
 						case 0x3030 :
@@ -1300,6 +1282,7 @@ uint8 S9xGetPPU(uint16 Address)
 				return ((uint8) _SPCOutP[Address & 3]);
 #else
 				//	CPU.Flags |= DEBUG_MODE_FLAG;
+				S9xAPUCatchUp ();
 	#ifdef SPC700_SHUTDOWN
 				CPU.APU_APUExecuting =	Settings.APUEnabled;
 				IAPU.WaitCounter++;
@@ -1318,6 +1301,11 @@ uint8 S9xGetPPU(uint16 Address)
 							((rand() & 0xff00) >> 8) : (rand() & 0xff));
 					}
 
+					if (Settings.APUFastUpload)
+						S9xAPUFastUpload ();
+	#ifdef CPU_SHUTDOWN
+					S9xAPUWaitRead ();
+	#endif
 					return (APU.OutPorts[Address & 3]);
 				}
 
@@ -1373,7 +1361,10 @@ uint8 S9xGetPPU(uint16 Address)
 	{
 #ifdef USE_SA1
 		if (Settings.SA1)
+		{
+			S9xSA1Sync();
 			return (S9xGetSA1(Address));
+		}
 #endif
 		if (Address <= 0x2fff || Address >= 0x3000 + 768)
 		{
@@ -1405,6 +1396,7 @@ uint8 S9xGetPPU(uint16 Address)
 
 		if (!Settings.SuperFX)
 			return (0x30);
+			S9xSuperFXSync();
 			byte = Memory.FillRAM[Address];
 
 		//if (Address != 0x3030 && Address != 0x3031)
@@ -2609,23 +2601,34 @@ void S9xUpdateJoypads()
 }
 
 #ifndef ZSNES_FX
+void S9xSuperFXStopped()
+{
+	int GSUStatus = Memory.FillRAM[0x3000
+			+ GSU_SFR] | (Memory.FillRAM[0x3000 + GSU_SFR + 1] << 8);
+	if ((GSUStatus & (FLG_G | FLG_IRQ)) == FLG_IRQ)
+	{
+		// Trigger a GSU IRQ.
+		S9xSetIRQ(GSU_IRQ_SOURCE);
+	}
+}
+
 void S9xSuperFXExec()
 {
 #if 1
 	if (Settings.SuperFX)
 	{
+		S9xSuperFXSync();
 		if ((Memory.FillRAM[0x3000 + GSU_SFR] & FLG_G)
 			&& (Memory.FillRAM[0x3000 + GSU_SCMR] & 0x18) == 0x18)
 		{
-			if (!Settings.WinterGold)
-				FxEmulate(~0);
-			else FxEmulate((Memory.FillRAM[0x3000 + GSU_CLSR] & 1) ? 700 : 350);
-			int GSUStatus = Memory.FillRAM[0x3000
-					+ GSU_SFR] | (Memory.FillRAM[0x3000 + GSU_SFR + 1] << 8);
-			if ((GSUStatus & (FLG_G | FLG_IRQ)) == FLG_IRQ)
+			// A scanline's worth, twice as much at 21 MHz
+			uint32 instructions = SuperFX.speedPerLine;
+			if (Memory.FillRAM[0x3000 + GSU_CLSR] & 1)
+				instructions <<= 1;
+			if (!S9xSuperFXThreadRun(instructions))
 			{
-				// Trigger a GSU IRQ.
-				S9xSetIRQ(GSU_IRQ_SOURCE);
+				FxEmulate(instructions);
+				S9xSuperFXStopped();
 			}
 		}
 	}
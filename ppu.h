@@ -41,6 +41,8 @@
 #ifndef _PPU_H_
 #define _PPU_H_
 
+#include "gfx.h"
+
 #define FIRST_VISIBLE_LINE 1
 
 extern uint8 GetBank;
@@ -240,9 +242,23 @@ START_EXTERN_C
 void S9xUpdateScreen ();
 void S9xResetPPU ();
 void S9xFixColourBrightness ();
+void S9xInvalidateTiles (uint32 address, uint32 bytes);
 void S9xUpdateJoypads ();
 void S9xProcessMouse(int which1);
 void S9xSuperFXExec ();
+void S9xSuperFXStopped ();
+
+void S9xSuperFXSync ();
+bool8 S9xSuperFXThreadRun (uint32 instructions);
+void S9xSuperFXThreadStart ();
+void S9xSuperFXThreadStop ();
+uint8 S9xSuperFXSharedGetByte (uint32);
+uint16 S9xSuperFXSharedGetWord (uint32);
+void S9xSuperFXSharedSetByte (uint8, uint32);
+void S9xSuperFXSharedSetWord (uint16, uint32);
+uint8 *S9xSuperFXSharedBasePointer (uint32);
+uint8 *S9xSuperFXSharedMemPointer (uint32);
+void S9xSuperFXSharedSetPCBase (uint32);
 
 void S9xSetPPU (uint8 Byte, uint16 Address);
 uint8 S9xGetPPU (uint16 Address);
@@ -255,12 +271,11 @@ uint8 S9xGetC4 (uint16 Address);
 void S9xSetC4RAM (uint8 Byte, uint16 Address);
 uint8 S9xGetC4RAM (uint16 Address);
 
-extern struct SPPU PPU;
+extern GFX_THREAD_LOCAL struct SPPU PPU;
 extern struct SDMA DMA [8];
-extern struct InternalPPU IPPU;
+extern GFX_THREAD_LOCAL struct InternalPPU IPPU;
 END_EXTERN_C
 
-#include "gfx.h"
 #include "memmap.h"
 
 STATIC INLINE uint8 REGISTER_4212()
@@ -476,6 +491,22 @@ STATIC INLINE void REGISTER_2119_linear (uint8 Byte)
 //    Memory.FillRAM [0x2119] = Byte;
 }
 
+// The _linear writes for DMAs, which invalidate the tiles of their whole
+// range at the end with S9xInvalidateTiles
+STATIC INLINE void REGISTER_2118_dma (uint8 Byte)
+{
+    Memory.VRAM[(PPU.VMA.Address << 1) & 0xFFFF] = Byte;
+    if (!PPU.VMA.High)
+	PPU.VMA.Address += PPU.VMA.Increment;
+}
+
+STATIC INLINE void REGISTER_2119_dma (uint8 Byte)
+{
+    Memory.VRAM[((PPU.VMA.Address << 1) + 1) & 0xFFFF] = Byte;
+    if (PPU.VMA.High)
+	PPU.VMA.Address += PPU.VMA.Increment;
+}
+
 STATIC INLINE void REGISTER_2122(uint8 Byte)
 {
     // CG-RAM (palette) write
@@ -0,0 +1,33 @@
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include "port.h"
+
+/* Coarse attribution of host time to emulated subsystems.
+ * The core stores the subsystem it is currently running into
+ * S9xProfileSection; a frontend samples that variable from a timer
+ * (see platform/bench.cpp). Without CONF_PROFILE the markers vanish. */
+enum {
+	PROFILE_OTHER = 0,	// Frontend and anything not marked below
+	PROFILE_CPU,		// 65c816 (and SA-1) execution
+	PROFILE_APU,		// SPC700 execution
+	PROFILE_RENDER,		// S9xUpdateScreen
+	PROFILE_MIX,		// S9xMixSamples
+	PROFILE_DMA,		// DMA and HDMA transfers
+	PROFILE_SECTIONS
+};
+
+#if CONF_PROFILE
+EXTERN_C volatile uint8 S9xProfileSection;
+
+#define PROFILE_ENTER(section) \
+	uint8 _profile_saved = S9xProfileSection; \
+	S9xProfileSection = (section)
+#define PROFILE_LEAVE() \
+	S9xProfileSection = _profile_saved
+#else
+#define PROFILE_ENTER(section)
+#define PROFILE_LEAVE()
+#endif
+
+#endif
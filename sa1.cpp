@@ -52,8 +52,27 @@ static void S9xSA1CharConv2 ();
 static void S9xSA1DMA ();
 static void S9xSA1ReadVariableLengthData (bool8 inc, bool8 no_shift);
 
+/* The IRQs the SA-1 raises on the S-CPU. From the SA-1 thread they go
+ * through the S-CPU thread, which owns CPU.IRQActive. */
+static void SetCPUIRQ (uint32 source)
+{
+    if (S9xSA1ThreadSide ())
+	S9xSA1ThreadSignal (source);
+    else
+	S9xSetIRQ (source);
+}
+
+static void ClearCPUIRQ (uint32 source)
+{
+    if (S9xSA1ThreadSide ())
+	S9xSA1ThreadSignal (source);
+    else
+	S9xClearIRQ (source);
+}
+
 void S9xSA1Init ()
 {
+    S9xSA1ThreadStop ();
     SA1.NMIActive = FALSE;
     SA1.IRQActive = FALSE;
     SA1.WaitingForInterrupt = FALSE;
@@ -72,6 +91,17 @@ void S9xSA1Init ()
     SA1.arithmetic_op = 0;
     SA1.sum = 0;
     SA1.overflow = FALSE;
+    if (!SA1.WaitAddress)
+    {
+	// Forget the loop S9xSA1IdleBranch was watching
+	SA1.IdleLoop = NULL;
+	SA1.WaitByteAddress1 = NULL;
+	SA1.WaitByteAddress2 = NULL;
+    }
+#if !CONF_BUILD_ASM_CPU
+    if (Settings.SA1 && Settings.ThreadedSA1)
+	S9xSA1ThreadStart ();
+#endif
 }
 
 void S9xSA1Reset ()
@@ -160,7 +190,7 @@ uint8 S9xSA1GetByte (uint32 address)
     if (GetAddress >= (uint8 *) CMemory::MAP_LAST)
 	return (*(GetAddress + (address & 0xffff)));
 
-    switch ((int) GetAddress)
+    switch ((intptr_t) GetAddress)
     {
     case CMemory::MAP_PPU:
 	return (S9xGetSA1 (address & 0xffff));
@@ -197,6 +227,11 @@ uint16 S9xSA1GetWord (uint32 address)
     return (S9xSA1GetByte (address) | (S9xSA1GetByte (address + 1) << 8));
 }
 
+uint32 S9xSA1GetLong (uint32 address)
+{
+    return (S9xSA1GetWord (address) | (S9xSA1GetByte (address + 2) << 16));
+}
+
 void S9xSA1SetByte (uint8 byte, uint32 address)
 {
     uint8 *Setaddress = SA1.WriteMap [(address >> MEMMAP_SHIFT) & MEMMAP_MASK];
@@ -207,7 +242,7 @@ void S9xSA1SetByte (uint8 byte, uint32 address)
 	return;
     }
 
-    switch ((int) Setaddress)
+    switch ((intptr_t) Setaddress)
     {
     case CMemory::MAP_PPU:
 	S9xSetSA1 (byte, address & 0xffff);
@@ -269,7 +304,7 @@ void S9xSA1SetPCBase (uint32 address)
 	return;
     }
 
-    switch ((int) GetAddress)
+    switch ((intptr_t) GetAddress)
     {
     case CMemory::MAP_PPU:
 	SA1.PCBase = Memory.FillRAM - 0x2000;
@@ -333,6 +368,8 @@ void S9xSetSA1MemMap (uint32 which1, uint8 map)
     int c;
     int start = which1 * 0x100 + 0xc00;
     int start2 = which1 * 0x200;
+    // The S-CPU thread switches its own banks when signalled
+    bool8 cpu = !S9xSA1ThreadSide ();
 
     if (which1 >= 2)
 	start2 += 0x400;
@@ -343,7 +380,11 @@ void S9xSetSA1MemMap (uint32 which1, uint8 map)
 	int i;
 
 	for (i = c; i < c + 16; i++)
-	    Memory.Map [start + i] = SA1.Map [start + i] = block;
+	{
+	    SA1.Map [start + i] = block;
+	    if (cpu)
+		Memory.Map [start + i] = block;
+	}
     }
     
     for (c = 0; c < 0x200; c += 16)
@@ -352,7 +393,11 @@ void S9xSetSA1MemMap (uint32 which1, uint8 map)
 	int i;
 
 	for (i = c + 8; i < c + 16; i++)
-	    Memory.Map [start2 + i] = SA1.Map [start2 + i] = block;
+	{
+	    SA1.Map [start2 + i] = block;
+	    if (cpu)
+		Memory.Map [start2 + i] = block;
+	}
     }
 }
 
@@ -362,6 +407,13 @@ uint8 S9xGetSA1 (uint32 address)
     switch (address)
     {
     case 0x2300:
+	if (S9xSA1ThreadSide ())
+	{
+	    // CPU.IRQActive belongs to the S-CPU thread
+	    return ((uint8) ((Memory.FillRAM [0x2209] & 0x5f) |
+		     (Memory.FillRAM [0x2300] & Memory.FillRAM [0x2201] &
+		      (SA1_IRQ_SOURCE | SA1_DMA_IRQ_SOURCE))));
+	}
 	return ((uint8) ((Memory.FillRAM [0x2209] & 0x5f) | 
 		 (CPU.IRQActive & (SA1_IRQ_SOURCE | SA1_DMA_IRQ_SOURCE))));
     case 0x2301:
@@ -437,24 +489,24 @@ void S9xSetSA1 (uint8 byte, uint32 address)
 	if (((byte ^ Memory.FillRAM [0x2201]) & 0x80) &&
 	    (Memory.FillRAM [0x2300] & byte & 0x80))
 	{
-	    S9xSetIRQ (SA1_IRQ_SOURCE);
+	    SetCPUIRQ (SA1_IRQ_SOURCE);
 	}
 	if (((byte ^ Memory.FillRAM [0x2201]) & 0x20) &&
 	    (Memory.FillRAM [0x2300] & byte & 0x20))
 	{
-	    S9xSetIRQ (SA1_DMA_IRQ_SOURCE);
+	    SetCPUIRQ (SA1_DMA_IRQ_SOURCE);
 	}
 	break;
     case 0x2202:
 	if (byte & 0x80)
 	{
 	    Memory.FillRAM [0x2300] &= ~0x80;
-	    S9xClearIRQ (SA1_IRQ_SOURCE);
+	    ClearCPUIRQ (SA1_IRQ_SOURCE);
 	}
 	if (byte & 0x20)
 	{
 	    Memory.FillRAM [0x2300] &= ~0x20;
-	    S9xClearIRQ (SA1_DMA_IRQ_SOURCE);
+	    ClearCPUIRQ (SA1_DMA_IRQ_SOURCE);
 	}
 	break;
     case 0x2203:
@@ -485,7 +537,7 @@ void S9xSetSA1 (uint8 byte, uint32 address)
 
 	if (byte & Memory.FillRAM [0x2201] & 0x80)
 	{
-	    S9xSetIRQ (SA1_IRQ_SOURCE);
+	    SetCPUIRQ (SA1_IRQ_SOURCE);
 	}
 	break;
     case 0x220a:
@@ -590,6 +642,8 @@ void S9xSetSA1 (uint8 byte, uint32 address)
     case 0x2221:
     case 0x2222:
     case 0x2223:
+	if (S9xSA1ThreadSide ())
+	    S9xSA1ThreadSignal (SA1_THREAD_MEMMAP);
 	S9xSetSA1MemMap (address - 0x2220, byte);
 //	printf ("MMC: %02x\n", byte);
 	break;
@@ -662,7 +716,7 @@ void S9xSetSA1 (uint8 byte, uint32 address)
 	{
 	    Memory.FillRAM [0x2300] |= 0x20;
 	    if (Memory.FillRAM [0x2201] & 0x20)
-		S9xSetIRQ (SA1_DMA_IRQ_SOURCE);
+		SetCPUIRQ (SA1_DMA_IRQ_SOURCE);
 	    SA1.in_char_dma = TRUE;
 	}
 	break;
@@ -94,6 +94,11 @@ struct SSA1 {
     uint8   VirtualBitmapFormat;
     bool8   in_char_dma;
     uint8   variable_bit_pos;
+    bool8   Threaded;	// Running on its own thread, see sa1thread.cpp
+    uint8   *IdleLoop;	// Branch S9xSA1IdleBranch last looked at
+    struct  SOpcodes *IdleOpcodes;
+    uint32  IdleShiftedDB;
+    uint16  IdleD;
 };
 
 extern struct SSA1Registers SA1Registers;
@@ -121,6 +126,7 @@ END_EXTERN_C
 START_EXTERN_C
 uint8 S9xSA1GetByte (uint32);
 uint16 S9xSA1GetWord (uint32);
+uint32 S9xSA1GetLong (uint32);
 void S9xSA1SetByte (uint8, uint32);
 void S9xSA1SetWord (uint16, uint32);
 void S9xSA1SetPCBase (uint32);
@@ -136,12 +142,49 @@ void S9xSA1MainLoop ();
 void S9xSA1Init ();
 void S9xFixSA1AfterSnapshotLoad ();
 void S9xSA1ExecuteDuringSleep ();
+void S9xSetSA1MemMap (uint32 which1, uint8 map);
+
+void S9xSA1ThreadStart ();
+void S9xSA1ThreadStop ();
+void S9xSA1ThreadTick ();
+void S9xSA1ThreadSync ();
+void S9xSA1ThreadPause ();
+bool8 S9xSA1ThreadSide ();
+void S9xSA1ThreadSignal (uint8 what);
+
+uint8 S9xSA1SharedGetByte (uint32 address);
+uint16 S9xSA1SharedGetWord (uint32 address);
+void S9xSA1SharedSetByte (uint8 byte, uint32 address);
+void S9xSA1SharedSetWord (uint16 word, uint32 address);
+uint8 *S9xSA1SharedBasePointer (uint32 address);
+uint8 *S9xSA1SharedMemPointer (uint32 address);
+void S9xSA1SharedSetPCBase (uint32 address);
 END_EXTERN_C
 
+// Runs the SA-1 for the S-CPU opcode just done
+STATIC inline void S9xSA1Step ()
+{
+    if (SA1.Threaded)
+	S9xSA1ThreadTick ();
+    else
+    if (SA1.Executing)
+	S9xSA1MainLoop ();
+}
+
+// Catches the SA-1 thread up before the S-CPU looks at its state
+STATIC inline void S9xSA1Sync ()
+{
+    if (SA1.Threaded)
+	S9xSA1ThreadSync ();
+}
+
 #define SNES_IRQ_SOURCE	    (1 << 7)
 #define TIMER_IRQ_SOURCE    (1 << 6)
 #define DMA_IRQ_SOURCE	    (1 << 5)
 
+// S9xSA1ThreadSignal: the $2220-$2223 ROM banks changed
+#define SA1_THREAD_MEMMAP   (1 << 0)
+
 STATIC inline void S9xSA1UnpackStatus()
 {
     SA1._Zero = (SA1Registers.PL & Zero) == 0;
@@ -49,6 +49,9 @@
 #include "ppu.h"
 #include "cpuexec.h"
 #include "sa1.h"
+#if !CONF_BUILD_ASM_CPU
+#include "cpuidle.h"
+#endif
 
 #define CPU SA1
 #define ICPU SA1
@@ -58,6 +61,7 @@
 #define Registers SA1Registers
 #define S9xGetByte S9xSA1GetByte
 #define S9xGetWord S9xSA1GetWord
+#define S9xGetLong S9xSA1GetLong
 #define S9xSetByte S9xSA1SetByte
 #define S9xSetWord S9xSA1SetWord
 #define S9xSetPCBase S9xSA1SetPCBase
@@ -128,7 +132,13 @@ void S9xSA1MainLoop ()
 				SA1.PC++;
 			}
 			if (!SA1CheckFlag (IRQ))
+			{
 				S9xSA1Opcode_IRQ ();
+#ifdef CPU_SHUTDOWN
+				// The handler may change what a wait loop polls
+				SA1.WaitCounter = 0;
+#endif
+			}
 		}
 		else
 			SA1.Flags &= ~IRQ_PENDING_FLAG;
@@ -0,0 +1,393 @@
+/* Runs the SA-1 on a thread of its own (Settings.ThreadedSA1).
+ *
+ * The serial core runs S9xSA1MainLoop after every S-CPU opcode; call that
+ * the tick of the opcode. Here the S-CPU counts its ticks and publishes the
+ * count, and the SA-1 thread runs the ticks published so far, up to
+ * SA1_THREAD_LEAD of them behind. Every S-CPU access to memory both CPUs
+ * can reach ($2200-$23ff, I-RAM, BW-RAM) first waits until the SA-1 has run
+ * all the ticks before it, so it sees the SA-1 exactly where the serial core
+ * would have it, and the SA-1 only sees S-CPU writes at the same ticks too.
+ * The main map tags those blocks MAP_SA1_SHARED to get the accesses here.
+ *
+ * The SA-1 cannot change S-CPU state itself; what it would do there (its
+ * IRQs to the S-CPU, ROM bank switches) is signalled instead and done by the
+ * S-CPU SA1_THREAD_LEAD ticks later, which is the one timing difference from
+ * the serial core. It only depends on the tick counts, so the emulation
+ * stays deterministic. */
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "snes9x.h"
+
+#ifdef USE_SA1
+
+#include "memmap.h"
+#include "ppu.h"
+#include "cpuexec.h"
+#if !CONF_BUILD_ASM_CPU
+#include "cpublocks.h"
+#endif
+#include "sa1.h"
+
+/* How many ticks the S-CPU may run ahead of the SA-1 */
+#define SA1_THREAD_LEAD		64
+/* How many times a thread looks for the other before it gives up the core */
+#define SA1_THREAD_SPINS	(1 << 14)
+
+#if defined(__i386__) || defined(__x86_64__)
+// Stores are not reordered with each other, nor loads with each other
+#define BARRIER()	__asm__ __volatile__ ("" : : : "memory")
+#define PAUSE()		__builtin_ia32_pause ()
+#else
+#define BARRIER()	__sync_synchronize ()
+#define PAUSE()
+#endif
+
+// Whether tick a comes before tick b, across the wrap
+#define BEFORE(a, b)	((int32) ((a) - (b)) < 0)
+
+static struct {
+	// Written by the S-CPU
+	volatile uint32 Published __attribute__ ((aligned (64)));
+	uint32 Count;
+	uint32 NextCheck;
+	bool8 Lockstep;		// Running code from shared memory
+	uint8 *LockstepBase;
+	volatile bool8 Quit;
+
+	// Written by the SA-1
+	volatile uint32 Done __attribute__ ((aligned (64)));
+	volatile uint32 SignalTick;
+	volatile uint8 Signal;
+
+	volatile bool8 Sleeping __attribute__ ((aligned (64)));
+} Thread;
+
+static pthread_t ThreadId;
+static pthread_mutex_t Lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t Wake = PTHREAD_COND_INITIALIZER;
+
+// The main map entries of the blocks tagged MAP_SA1_SHARED
+static uint8 *SharedMap [MEMMAP_NUM_BLOCKS];
+static uint8 *SharedWriteMap [MEMMAP_NUM_BLOCKS];
+
+static bool8 SharedBlock (int block)
+{
+	int bank = block / MEMMAP_BLOCKS_PER_BANK;
+	int page = block % MEMMAP_BLOCKS_PER_BANK;
+
+	// I-RAM at $3000 and the BW-RAM window at $6000 of banks 00-3f/80-bf
+	if (bank < 0x40 || (bank >= 0x80 && bank < 0xc0))
+		return page == 3 || page == 6 || page == 7;
+	// BW-RAM in banks 40-7d
+	return bank < 0x7e;
+}
+
+static void TagShared ()
+{
+	for (int block = 0; block < MEMMAP_NUM_BLOCKS; block++) {
+		if (!SharedBlock (block))
+			continue;
+		SharedMap [block] = Memory.Map [block];
+		SharedWriteMap [block] = Memory.WriteMap [block];
+		Memory.Map [block] = (uint8 *) CMemory::MAP_SA1_SHARED;
+		Memory.WriteMap [block] = (uint8 *) CMemory::MAP_SA1_SHARED;
+	}
+}
+
+static void UntagShared ()
+{
+	// A ROM loaded since has built a map of its own
+	for (int block = 0; block < MEMMAP_NUM_BLOCKS; block++) {
+		if (Memory.Map [block] == (uint8 *) CMemory::MAP_SA1_SHARED)
+			Memory.Map [block] = SharedMap [block];
+		if (Memory.WriteMap [block] == (uint8 *) CMemory::MAP_SA1_SHARED)
+			Memory.WriteMap [block] = SharedWriteMap [block];
+	}
+}
+
+static void WakeUp ()
+{
+	__sync_synchronize ();
+	if (Thread.Sleeping) {
+		pthread_mutex_lock (&Lock);
+		pthread_cond_signal (&Wake);
+		pthread_mutex_unlock (&Lock);
+	}
+}
+
+static void Sleep (uint32 done)
+{
+	pthread_mutex_lock (&Lock);
+	Thread.Sleeping = TRUE;
+	__sync_synchronize ();
+	while (Thread.Published == done && !Thread.Quit)
+		pthread_cond_wait (&Wake, &Lock);
+	Thread.Sleeping = FALSE;
+	pthread_mutex_unlock (&Lock);
+}
+
+static void *Run (void *)
+{
+	uint32 done = Thread.Done;
+	int spins = 0;
+
+	for (;;) {
+		uint32 target = Thread.Published;
+		BARRIER ();
+
+		if (target == done) {
+			if (Thread.Quit)
+				break;
+			if (++spins < SA1_THREAD_SPINS)
+				PAUSE ();
+			else {
+				Sleep (done);
+				spins = 0;
+			}
+			continue;
+		}
+
+		spins = 0;
+		do {
+			if (SA1.Executing)
+				S9xSA1MainLoop ();
+			BARRIER ();
+			Thread.Done = ++done;
+		} while (done != target);
+	}
+	return NULL;
+}
+
+/* Waits until the SA-1 has run the ticks up to target.
+ * @return The ticks it has run. */
+static uint32 WaitFor (uint32 target)
+{
+	uint32 done;
+	int spins = 0;
+
+	while (BEFORE (done = Thread.Done, target)) {
+		WakeUp ();
+		if (++spins < SA1_THREAD_SPINS)
+			PAUSE ();
+		else
+			sched_yield ();
+	}
+	BARRIER ();
+	return done;
+}
+
+static void ApplySignal ()
+{
+	uint8 signal = Thread.Signal;
+	uint8 *fill = Memory.FillRAM;
+
+	Thread.Signal = 0;
+	if (signal & SA1_THREAD_MEMMAP) {
+		for (int i = 0; i < 4; i++)
+			S9xSetSA1MemMap (i, fill [0x2220 + i]);
+	}
+	for (int source = SA1_DMA_IRQ_SOURCE; source <= SA1_IRQ_SOURCE; source <<= 2) {
+		if (!(signal & source))
+			continue;
+		if (fill [0x2300] & fill [0x2201] & source)
+			S9xSetIRQ (source);
+		else if (!(fill [0x2300] & source))
+			S9xClearIRQ (source);
+	}
+}
+
+static void Check ()
+{
+	uint32 count = Thread.Count;
+	uint32 done, next;
+
+	if (Thread.Lockstep && CPU.PCBase != Thread.LockstepBase)
+		Thread.Lockstep = FALSE;
+
+	done = WaitFor (Thread.Lockstep ? count : count - SA1_THREAD_LEAD);
+	if (Thread.Signal) {
+		BARRIER ();
+		if (!BEFORE (count, Thread.SignalTick + SA1_THREAD_LEAD)) {
+			done = WaitFor (count);
+			ApplySignal ();
+		}
+	}
+
+	if (Thread.Lockstep)
+		next = count + 1;
+	else {
+		next = done + SA1_THREAD_LEAD + 1;
+		if (Thread.Signal && BEFORE (Thread.SignalTick + SA1_THREAD_LEAD, next))
+			next = Thread.SignalTick + SA1_THREAD_LEAD;
+	}
+	Thread.NextCheck = next;
+}
+
+void S9xSA1ThreadTick ()
+{
+	BARRIER ();
+	Thread.Published = ++Thread.Count;
+	if (!BEFORE (Thread.Count, Thread.NextCheck))
+		Check ();
+}
+
+void S9xSA1ThreadSync ()
+{
+	WaitFor (Thread.Count);
+}
+
+void S9xSA1ThreadPause ()
+{
+	WaitFor (Thread.Count);
+	if (Thread.Signal)
+		ApplySignal ();
+}
+
+bool8 S9xSA1ThreadSide ()
+{
+	return SA1.Threaded && pthread_equal (pthread_self (), ThreadId);
+}
+
+void S9xSA1ThreadSignal (uint8 what)
+{
+	if (!Thread.Signal)
+		Thread.SignalTick = Thread.Done + 1;
+	BARRIER ();
+	Thread.Signal |= what;
+}
+
+void S9xSA1ThreadStart ()
+{
+	// With one core the threads would only take turns at it
+	if (SA1.Threaded || sysconf (_SC_NPROCESSORS_ONLN) < 2)
+		return;
+
+	Thread.Count = 0;
+	Thread.Published = 0;
+	Thread.Done = 0;
+	Thread.Signal = 0;
+	Thread.NextCheck = SA1_THREAD_LEAD + 1;
+	Thread.Lockstep = FALSE;
+	Thread.Quit = FALSE;
+
+	TagShared ();
+	SA1.Threaded = TRUE;
+	if (pthread_create (&ThreadId, NULL, Run, NULL) != 0) {
+		SA1.Threaded = FALSE;
+		UntagShared ();
+	}
+#if !CONF_BUILD_ASM_CPU
+	// Translated blocks call the SA-1 the way they were built to
+	S9xCPUBlocksFlush ();
+#endif
+}
+
+void S9xSA1ThreadStop ()
+{
+	if (!SA1.Threaded)
+		return;
+
+	Thread.Quit = TRUE;
+	WakeUp ();
+	pthread_join (ThreadId, NULL);
+	SA1.Threaded = FALSE;
+	UntagShared ();
+#if !CONF_BUILD_ASM_CPU
+	S9xCPUBlocksFlush ();
+#endif
+}
+
+/* The S-CPU accesses to MAP_SA1_SHARED blocks: wait for the SA-1, then
+ * make the access with the block's own map entry. */
+
+uint8 S9xSA1SharedGetByte (uint32 address)
+{
+	int block = (address >> MEMMAP_SHIFT) & MEMMAP_MASK;
+	uint8 byte;
+
+	S9xSA1ThreadSync ();
+	Memory.Map [block] = SharedMap [block];
+	byte = S9xGetByte (address);
+	Memory.Map [block] = (uint8 *) CMemory::MAP_SA1_SHARED;
+
+	return byte;
+}
+
+uint16 S9xSA1SharedGetWord (uint32 address)
+{
+	int block = (address >> MEMMAP_SHIFT) & MEMMAP_MASK;
+	uint16 word;
+
+	S9xSA1ThreadSync ();
+	Memory.Map [block] = SharedMap [block];
+	word = S9xGetWord (address);
+	Memory.Map [block] = (uint8 *) CMemory::MAP_SA1_SHARED;
+
+	return word;
+}
+
+void S9xSA1SharedSetByte (uint8 byte, uint32 address)
+{
+	int block = (address >> MEMMAP_SHIFT) & MEMMAP_MASK;
+
+	S9xSA1ThreadSync ();
+	Memory.WriteMap [block] = SharedWriteMap [block];
+	S9xSetByte (byte, address);
+	Memory.WriteMap [block] = (uint8 *) CMemory::MAP_SA1_SHARED;
+}
+
+void S9xSA1SharedSetWord (uint16 word, uint32 address)
+{
+	int block = (address >> MEMMAP_SHIFT) & MEMMAP_MASK;
+
+	S9xSA1ThreadSync ();
+	Memory.WriteMap [block] = SharedWriteMap [block];
+	S9xSetWord (word, address);
+	Memory.WriteMap [block] = (uint8 *) CMemory::MAP_SA1_SHARED;
+}
+
+uint8 *S9xSA1SharedBasePointer (uint32 address)
+{
+	int block = (address >> MEMMAP_SHIFT) & MEMMAP_MASK;
+	uint8 *ptr;
+
+	S9xSA1ThreadSync ();
+	Memory.Map [block] = SharedMap [block];
+	ptr = GetBasePointer (address);
+	Memory.Map [block] = (uint8 *) CMemory::MAP_SA1_SHARED;
+
+	return ptr;
+}
+
+uint8 *S9xSA1SharedMemPointer (uint32 address)
+{
+	int block = (address >> MEMMAP_SHIFT) & MEMMAP_MASK;
+	uint8 *ptr;
+
+	S9xSA1ThreadSync ();
+	Memory.Map [block] = SharedMap [block];
+	ptr = S9xGetMemPointer (address);
+	Memory.Map [block] = (uint8 *) CMemory::MAP_SA1_SHARED;
+
+	return ptr;
+}
+
+void S9xSA1SharedSetPCBase (uint32 address)
+{
+	int block = (address >> MEMMAP_SHIFT) & MEMMAP_MASK;
+
+	S9xSA1ThreadSync ();
+	Memory.Map [block] = SharedMap [block];
+	S9xSetPCBase (address);
+	Memory.Map [block] = (uint8 *) CMemory::MAP_SA1_SHARED;
+
+	// The SA-1 may write the code, so run it a tick at a time
+	Thread.Lockstep = TRUE;
+	Thread.LockstepBase = CPU.PCBase;
+	Thread.NextCheck = Thread.Count + 1;
+}
+
+#endif
@@ -462,6 +462,10 @@ static void Freeze ()
 #ifdef ZSNES_FX
     if (Settings.SuperFX)
 	S9xSuperFXPreSaveState ();
+#else
+    // Let the GSU finish its slice before its RAM and registers are saved
+    if (Settings.SuperFX)
+	S9xSuperFXSync ();
 #endif
 
     S9xSRTCPreSaveState ();
@@ -529,6 +533,10 @@ static int Unfreeze()
 
     int version;
     int len = strlen (SNAPSHOT_MAGIC) + 1 + 4 + 1;
+#ifndef ZSNES_FX
+    if (Settings.SuperFX)
+	S9xSuperFXSync ();
+#endif
     if (READ_STREAM(buffer, len, ss_st) != len)
     {
 		printf("%s: Failed to read header\n", __func__);
@@ -203,6 +203,7 @@ struct SCPUState{
     bool8	APU_APUExecuting;		//122
     bool8	_ARM_asm_padding2;		//123
 	int32	APU_Cycles;				//124 notaz
+	uint8*	APUWaitAddress;			//128 last opcode to read an APU port
 };
 
 
@@ -345,6 +346,14 @@ struct SSettings{
 // Hacks
 	bool8	HacksEnabled;
 	bool8	HacksFilter;
+	bool8	HacksAuto;	// Patch idle loops found while running
+	bool8	APUFastUpload;	// Take IPL ROM uploads without running the SPC700
+	bool8	ThreadedSA1;	// Run the SA-1 on a second thread
+	bool8	ThreadedSuperFX;	// Run the SuperFX on a second thread
+	bool8	PreDecodeTiles;	// Decode the tiles VRAM DMAs write before drawing
+	uint32	RenderThreads;	// Draw screen updates in bands on this many threads
+	bool8	RenderPipeline;	// Draw each frame while the next one is emulated
+	bool8	LineRenderer;	// Compose lines as palette indices, then blend them
 };
 
 struct SSNESGameFixes
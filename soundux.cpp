@@ -83,6 +83,7 @@ if ((v) > 127) \
 #include "memmap.h"
 #include "cpuexec.h"
 #include "misc.h"
+#include "profile.h"
 
 
 static int wave[SOUND_BUFFER_SIZE];
@@ -926,6 +927,8 @@ void S9xMixSamples(signed short *buffer, int sample_count)
 		return;
 	}
 
+	PROFILE_ENTER(PROFILE_MIX);
+
 	memset32 (MixBuffer, 0, sample_count);
 	if (SoundData.echo_enable)
 		memset32 (EchoBuffer, 0, sample_count);
@@ -1091,6 +1094,8 @@ void S9xMixSamples(signed short *buffer, int sample_count)
 			}
 		}
 	}
+
+	PROFILE_LEAVE();
 }
 
 void S9xResetSound (bool8 full)
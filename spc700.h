@@ -41,6 +41,8 @@
 #ifndef _SPC700_H_
 #define _SPC700_H_
 
+#include "profile.h"
+
 #ifdef SPCTOOL
 #define NO_CHANNEL_STRUCT
 #include "spctool/dsp.h"
@@ -160,10 +162,13 @@ if (CPU.APU_APUExecuting == mode) \
 }
 
 #define APU_EXECUTE(x) \
-if (CPU.APU_APUExecuting) \
+if (CPU.APU_APUExecuting && CPU.APU_Cycles <= CPU.Cycles) \
 {\
-    while (CPU.APU_Cycles <= CPU.Cycles) \
+    PROFILE_ENTER(PROFILE_APU); \
+    do { \
 	APU_EXECUTE1(); \
+    } while (CPU.APU_Cycles <= CPU.Cycles); \
+    PROFILE_LEAVE(); \
 }
 
 #endif // ASM_SPC700
@@ -46,6 +46,22 @@
 #include "gfx.h"
 #include "tile.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#ifdef CONF_RENDER_THREADS
+// Bands drawn at once can both decode a tile; it only counts as decoded once
+// its pixels are in the cache
+#define TILE_BUFFERED(n) __atomic_load_n (&BG.Buffered [n], __ATOMIC_ACQUIRE)
+#define TILE_SET_BUFFERED(n, b) __atomic_store_n (&BG.Buffered [n], b, __ATOMIC_RELEASE)
+#else
+#define TILE_BUFFERED(n) BG.Buffered [n]
+#define TILE_SET_BUFFERED(n, b) BG.Buffered [n] = (b)
+#endif
+
 #define TILE_PREAMBLE \
     uint8 *pCache; \
 \
@@ -58,10 +74,14 @@
     uint32 TileNumber; \
     pCache = &BG.Buffer[(TileNumber = (TileAddr >> BG.TileShift)) << 6]; \
 \
-    if (!BG.Buffered [TileNumber]) \
-	BG.Buffered[TileNumber] = ConvertTile (pCache, TileAddr); \
+    uint8 Buffered = TILE_BUFFERED (TileNumber); \
+    if (!Buffered) \
+    { \
+	Buffered = ConvertTile (pCache, TileAddr); \
+	TILE_SET_BUFFERED (TileNumber, Buffered); \
+    } \
 \
-    if (BG.Buffered [TileNumber] == BLANK_TILE) \
+    if (Buffered == BLANK_TILE) \
 	return; \
 \
     register uint32 l; \
@@ -360,10 +380,104 @@
 
 extern uint32 HeadMask [4];
 extern uint32 TailMask [5];
+extern uint8 BitShifts [8][4];
+extern uint8 TileShifts [8][4];
+extern uint8 Depths [8][4];
+
+/* The vector decoders spread each bitplane byte over the 8 pixels it covers,
+ * compare each pixel with its bit, and OR the plane's value into the pixels
+ * that have it set. Planes come in pairs: the 16 bytes at tp, tp + 16 and so
+ * on hold planes 0/1, 2/3... for the 8 lines, interleaved. */
+
+#if defined(__SSE2__)
+
+uint8 ConvertTile (uint8 *pCache, uint32 TileAddr)
+{
+    const uint8 *tp = &GFX.VRAM[TileAddr];
+    const __m128i pixel = _mm_set_epi8 (1, 2, 4, 8, 16, 32, 64, -128,
+					1, 2, 4, 8, 16, 32, 64, -128);
+    const __m128i low = _mm_set1_epi16 (0x00ff);
+    __m128i line [4];
+    __m128i non_zero;
+    int pair, i;
+
+    line [0] = line [1] = line [2] = line [3] = _mm_setzero_si128 ();
+
+    for (pair = 0; pair < BG.BitShift >> 1; pair++, tp += 16)
+    {
+	__m128i v = _mm_loadu_si128 ((const __m128i *) tp);
+	__m128i planes [2];
+
+	planes [0] = _mm_packus_epi16 (_mm_and_si128 (v, low), v);
+	planes [1] = _mm_packus_epi16 (_mm_srli_epi16 (v, 8), v);
+
+	for (i = 0; i < 2; i++)
+	{
+	    // Lines 0-3 and 4-7 with each byte repeated 4 times, then 8
+	    __m128i b = _mm_unpacklo_epi8 (planes [i], planes [i]);
+	    __m128i b03 = _mm_unpacklo_epi16 (b, b);
+	    __m128i b47 = _mm_unpackhi_epi16 (b, b);
+	    __m128i value = _mm_set1_epi8 (1 << ((pair << 1) + i));
+
+#define PLANE_LINES(n, bytes) \
+	    line [n] = _mm_or_si128 (line [n], _mm_and_si128 (value, \
+		_mm_cmpeq_epi8 (_mm_and_si128 (bytes, pixel), pixel)));
+
+	    PLANE_LINES (0, _mm_unpacklo_epi32 (b03, b03))
+	    PLANE_LINES (1, _mm_unpackhi_epi32 (b03, b03))
+	    PLANE_LINES (2, _mm_unpacklo_epi32 (b47, b47))
+	    PLANE_LINES (3, _mm_unpackhi_epi32 (b47, b47))
+#undef PLANE_LINES
+	}
+    }
+
+    for (i = 0; i < 4; i++)
+	_mm_storeu_si128 ((__m128i *) pCache + i, line [i]);
+
+    non_zero = _mm_or_si128 (_mm_or_si128 (line [0], line [1]),
+			     _mm_or_si128 (line [2], line [3]));
+    non_zero = _mm_cmpeq_epi8 (non_zero, _mm_setzero_si128 ());
+    return (_mm_movemask_epi8 (non_zero) != 0xffff ? TRUE : BLANK_TILE);
+}
+
+#elif defined(__ARM_NEON__)
+
+uint8 ConvertTile (uint8 *pCache, uint32 TileAddr)
+{
+    static const uint8 bits [8] = { 128, 64, 32, 16, 8, 4, 2, 1 };
+    const uint8 *tp = &GFX.VRAM[TileAddr];
+    const uint8x8_t pixel = vld1_u8 (bits);
+    uint8x8_t line [8];
+    uint8x8_t non_zero;
+    int plane, i;
+
+    for (i = 0; i < 8; i++)
+	line [i] = vdup_n_u8 (0);
+
+    for (plane = 0; plane < BG.BitShift; plane++)
+    {
+	const uint8 *pp = tp + ((plane >> 1) << 4) + (plane & 1);
+	uint8x8_t value = vdup_n_u8 (1 << plane);
+
+	for (i = 0; i < 8; i++)
+	    line [i] = vorr_u8 (line [i], vand_u8 (value,
+				vtst_u8 (vdup_n_u8 (pp [i << 1]), pixel)));
+    }
+
+    non_zero = vdup_n_u8 (0);
+    for (i = 0; i < 8; i++)
+    {
+	vst1_u8 (pCache + (i << 3), line [i]);
+	non_zero = vorr_u8 (non_zero, line [i]);
+    }
+    return (vget_lane_u64 (vreinterpret_u64_u8 (non_zero), 0) ? TRUE : BLANK_TILE);
+}
+
+#else
 
 uint8 ConvertTile (uint8 *pCache, uint32 TileAddr)
 {
-    register uint8 *tp = &Memory.VRAM[TileAddr];
+    register uint8 *tp = &GFX.VRAM[TileAddr];
     uint32 *p = (uint32 *) pCache;
     uint32 non_zero = 0;
     uint8 line;
@@ -476,7 +590,169 @@ uint8 ConvertTile (uint8 *pCache, uint32 TileAddr)
     return (non_zero ? TRUE : BLANK_TILE);
 }
 
-INLINE void WRITE_4PIXELS (uint32 Offset, uint8 *Pixels)
+#endif
+
+/* Returns the decoded pixels of Tile in the BG set up, the way TILE_PREAMBLE
+ * finds them, or NULL if the tile is blank. */
+uint8 *GetCachedTile (uint32 Tile)
+{
+    uint32 TileAddr = BG.TileAddress + ((Tile & 0x3ff) << BG.TileShift);
+    if ((Tile & 0x1ff) >= 256)
+	TileAddr += BG.NameSelect;
+
+    TileAddr &= 0xffff;
+
+    uint32 TileNumber = TileAddr >> BG.TileShift;
+    uint8 *pCache = &BG.Buffer[TileNumber << 6];
+
+    uint8 Buffered = TILE_BUFFERED (TileNumber);
+    if (!Buffered)
+    {
+	Buffered = ConvertTile (pCache, TileAddr);
+	TILE_SET_BUFFERED (TileNumber, Buffered);
+    }
+
+    return (Buffered == BLANK_TILE ? NULL : pCache);
+}
+
+/* VRAM DMAs drop the decoded tiles they overwrite a range at a time. With
+ * Settings.PreDecodeTiles the ranges are also queued, and S9xUpdateScreen
+ * decodes the tiles in them that the enabled layers can show before it
+ * starts drawing, rather than leaving them to the first tile drawn. The
+ * queue is per thread: the render pipeline's thread draws with a tile cache
+ * of its own, and finds nothing queued in it. */
+
+#define TILE_QUEUE_SIZE 16
+
+static GFX_THREAD_LOCAL struct {
+    uint32 Start;
+    uint32 End;
+} TileQueue [TILE_QUEUE_SIZE];
+static GFX_THREAD_LOCAL int TileQueued = 0;
+
+static void QueueTiles (uint32 start, uint32 end)
+{
+    int i;
+
+    for (i = 0; i < TileQueued; i++)
+    {
+	if (start <= TileQueue [i].End && end >= TileQueue [i].Start)
+	{
+	    if (start < TileQueue [i].Start)
+		TileQueue [i].Start = start;
+	    if (end > TileQueue [i].End)
+		TileQueue [i].End = end;
+	    return;
+	}
+    }
+    if (TileQueued == TILE_QUEUE_SIZE)
+    {
+	// Too scattered to be worth keeping apart
+	TileQueue [0].Start = 0;
+	TileQueue [0].End = 0x10000;
+	TileQueued = 1;
+	return;
+    }
+    TileQueue [TileQueued].Start = start;
+    TileQueue [TileQueued].End = end;
+    TileQueued++;
+}
+
+void S9xInvalidateTiles (uint32 address, uint32 bytes)
+{
+    int depth;
+
+    address &= 0xffff;
+    if (bytes >= 0x10000)
+    {
+	address = 0;
+	bytes = 0x10000;
+    }
+    else
+    if (address + bytes > 0x10000)
+    {
+	S9xInvalidateTiles (0, address + bytes - 0x10000);
+	bytes = 0x10000 - address;
+    }
+
+    for (depth = TILE_2BIT; depth <= TILE_8BIT; depth++)
+    {
+	uint32 first = address >> (4 + depth);
+	uint32 last = (address + bytes - 1) >> (4 + depth);
+	memset (IPPU.TileCached [depth] + first, 0, last - first + 1);
+    }
+
+    if (Settings.PreDecodeTiles)
+	QueueTiles (address, address + bytes);
+}
+
+// Decodes the queued tiles of the window of bytes VRAM holds at address
+static void DecodeTiles (int depth, uint32 address, uint32 bytes)
+{
+    uint32 size = 1 << BG.TileShift;
+    uint32 end = address + bytes;
+    int i;
+
+    if (end > 0x10000)
+    {
+	DecodeTiles (depth, 0, end - 0x10000);
+	end = 0x10000;
+    }
+
+    for (i = 0; i < TileQueued; i++)
+    {
+	uint32 a = TileQueue [i].Start > address ? TileQueue [i].Start : address;
+	uint32 e = TileQueue [i].End < end ? TileQueue [i].End : end;
+
+	for (a &= ~(size - 1); a < e; a += size)
+	{
+	    uint32 TileNumber = a >> BG.TileShift;
+	    if (!IPPU.TileCached [depth][TileNumber])
+		IPPU.TileCached [depth][TileNumber] =
+		    ConvertTile (&IPPU.TileCache [depth][TileNumber << 6], a);
+	}
+    }
+}
+
+void S9xDecodeQueuedTiles ()
+{
+    uint8 layers = GFX.r212c | GFX.r212d;
+    uint8 BitShift = BG.BitShift;
+    uint8 TileShift = BG.TileShift;
+    int bg;
+
+    // Nothing is drawn while the screen is blanked, which is when most of
+    // the DMAs happen; the layers to decode for are set up by the end of it
+    if (!TileQueued || PPU.ForcedBlanking)
+	return;
+
+    if (PPU.BGMode != 7)
+    {
+	for (bg = 0; bg < 4; bg++)
+	{
+	    if (!(layers & (1 << bg)) || !BitShifts [PPU.BGMode][bg])
+		continue;
+	    BG.BitShift = BitShifts [PPU.BGMode][bg];
+	    BG.TileShift = TileShifts [PPU.BGMode][bg];
+	    DecodeTiles (Depths [PPU.BGMode][bg], (PPU.BG[bg].NameBase << 1) & 0xffff,
+			 0x400 << BG.TileShift);
+	}
+    }
+    if (layers & 0x10)
+    {
+	BG.BitShift = 4;
+	BG.TileShift = 5;
+	DecodeTiles (TILE_4BIT, PPU.OBJNameBase & 0xffff, 0x2000);
+	DecodeTiles (TILE_4BIT, (PPU.OBJNameBase + 0x2000 + PPU.OBJNameSelect) & 0xffff,
+		     0x2000);
+    }
+
+    BG.BitShift = BitShift;
+    BG.TileShift = TileShift;
+    TileQueued = 0;
+}
+
+INLINE void WRITE_4PIXELS (int32 Offset, uint8 *Pixels)
 {
     register uint8 Pixel;
     uint8 *Screen = GFX.S + Offset;
@@ -496,7 +772,7 @@ INLINE void WRITE_4PIXELS (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-INLINE void WRITE_4PIXELS_FLIPPED (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELS_FLIPPED (int32 Offset, uint8 *Pixels)
 {
     register uint8 Pixel;
     uint8 *Screen = GFX.S + Offset;
@@ -516,7 +792,7 @@ INLINE void WRITE_4PIXELS_FLIPPED (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-inline void WRITE_4PIXELSHI16 (uint32 Offset, uint8 *Pixels)
+inline void WRITE_4PIXELSHI16 (int32 Offset, uint8 *Pixels)
 {
     uint32 Pixel;
     uint16 *Screen = (uint16 *) GFX.S + Offset;
@@ -536,7 +812,7 @@ inline void WRITE_4PIXELSHI16 (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-inline void WRITE_4PIXELSHI16_FLIPPED (uint32 Offset, uint8 *Pixels)
+inline void WRITE_4PIXELSHI16_FLIPPED (int32 Offset, uint8 *Pixels)
 {
     uint32 Pixel;
     uint16 *Screen = (uint16 *) GFX.S + Offset;
@@ -556,7 +832,7 @@ inline void WRITE_4PIXELSHI16_FLIPPED (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-INLINE void WRITE_4PIXELSx2 (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELSx2 (int32 Offset, uint8 *Pixels)
 {
     register uint8 Pixel;
     uint8 *Screen = GFX.S + Offset;
@@ -576,7 +852,7 @@ INLINE void WRITE_4PIXELSx2 (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-INLINE void WRITE_4PIXELS_FLIPPEDx2 (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELS_FLIPPEDx2 (int32 Offset, uint8 *Pixels)
 {
     register uint8 Pixel;
     uint8 *Screen = GFX.S + Offset;
@@ -596,7 +872,7 @@ INLINE void WRITE_4PIXELS_FLIPPEDx2 (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-INLINE void WRITE_4PIXELSx2x2 (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELSx2x2 (int32 Offset, uint8 *Pixels)
 {
     register uint8 Pixel;
     uint8 *Screen = GFX.S + Offset;
@@ -618,7 +894,7 @@ INLINE void WRITE_4PIXELSx2x2 (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-INLINE void WRITE_4PIXELS_FLIPPEDx2x2 (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELS_FLIPPEDx2x2 (int32 Offset, uint8 *Pixels)
 {
     register uint8 Pixel;
     uint8 *Screen = GFX.S + Offset;
@@ -715,7 +991,7 @@ void DrawLargePixel (uint32 Tile, uint32 Offset,
     RENDER_TILE_LARGE (((uint8) GFX.ScreenColors [pixel]), PLOT_PIXEL)
 }
 
-INLINE void WRITE_4PIXELS16 (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELS16 (int32 Offset, uint8 *Pixels)
 {
     register uint32 Pixel;
     uint16 *Screen = (uint16 *) GFX.S + Offset;
@@ -735,7 +1011,7 @@ INLINE void WRITE_4PIXELS16 (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-INLINE void WRITE_4PIXELS16_FLIPPED (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELS16_FLIPPED (int32 Offset, uint8 *Pixels)
 {
     register uint32 Pixel;
     uint16 *Screen = (uint16 *) GFX.S + Offset;
@@ -755,7 +1031,7 @@ INLINE void WRITE_4PIXELS16_FLIPPED (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-INLINE void WRITE_4PIXELS16x2 (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELS16x2 (int32 Offset, uint8 *Pixels)
 {
     register uint32 Pixel;
     uint16 *Screen = (uint16 *) GFX.S + Offset;
@@ -775,7 +1051,7 @@ INLINE void WRITE_4PIXELS16x2 (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-INLINE void WRITE_4PIXELS16_FLIPPEDx2 (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELS16_FLIPPEDx2 (int32 Offset, uint8 *Pixels)
 {
     register uint32 Pixel;
     uint16 *Screen = (uint16 *) GFX.S + Offset;
@@ -795,7 +1071,7 @@ INLINE void WRITE_4PIXELS16_FLIPPEDx2 (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-INLINE void WRITE_4PIXELS16x2x2 (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELS16x2x2 (int32 Offset, uint8 *Pixels)
 {
     register uint32 Pixel;
     uint16 *Screen = (uint16 *) GFX.S + Offset;
@@ -817,7 +1093,7 @@ INLINE void WRITE_4PIXELS16x2x2 (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-INLINE void WRITE_4PIXELS16_FLIPPEDx2x2 (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELS16_FLIPPEDx2x2 (int32 Offset, uint8 *Pixels)
 {
     register uint32 Pixel;
     uint16 *Screen = (uint16 *) GFX.S + Offset;
@@ -912,7 +1188,7 @@ void DrawLargePixel16 (uint32 Tile, uint32 Offset,
     RENDER_TILE_LARGE (GFX.ScreenColors [pixel], PLOT_PIXEL)
 }
 
-INLINE void WRITE_4PIXELS16_ADD (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELS16_ADD (int32 Offset, uint8 *Pixels)
 {
     register uint32 Pixel;
     uint16 *Screen = (uint16 *) GFX.S + Offset;
@@ -944,7 +1220,7 @@ INLINE void WRITE_4PIXELS16_ADD (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-INLINE void WRITE_4PIXELS16_FLIPPED_ADD (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELS16_FLIPPED_ADD (int32 Offset, uint8 *Pixels)
 {
     register uint32 Pixel;
     uint16 *Screen = (uint16 *) GFX.S + Offset;
@@ -976,7 +1252,7 @@ INLINE void WRITE_4PIXELS16_FLIPPED_ADD (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-INLINE void WRITE_4PIXELS16_ADD1_2 (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELS16_ADD1_2 (int32 Offset, uint8 *Pixels)
 {
     register uint32 Pixel;
     uint16 *Screen = (uint16 *) GFX.S + Offset;
@@ -1008,7 +1284,7 @@ INLINE void WRITE_4PIXELS16_ADD1_2 (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-INLINE void WRITE_4PIXELS16_FLIPPED_ADD1_2 (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELS16_FLIPPED_ADD1_2 (int32 Offset, uint8 *Pixels)
 {
     register uint32 Pixel;
     uint16 *Screen = (uint16 *) GFX.S + Offset;
@@ -1040,7 +1316,7 @@ INLINE void WRITE_4PIXELS16_FLIPPED_ADD1_2 (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-INLINE void WRITE_4PIXELS16_SUB (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELS16_SUB (int32 Offset, uint8 *Pixels)
 {
     register uint32 Pixel;
     uint16 *Screen = (uint16 *) GFX.S + Offset;
@@ -1072,7 +1348,7 @@ INLINE void WRITE_4PIXELS16_SUB (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-INLINE void WRITE_4PIXELS16_FLIPPED_SUB (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELS16_FLIPPED_SUB (int32 Offset, uint8 *Pixels)
 {
     register uint32 Pixel;
     uint16 *Screen = (uint16 *) GFX.S + Offset;
@@ -1104,7 +1380,7 @@ INLINE void WRITE_4PIXELS16_FLIPPED_SUB (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-INLINE void WRITE_4PIXELS16_SUB1_2 (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELS16_SUB1_2 (int32 Offset, uint8 *Pixels)
 {
     register uint32 Pixel;
     uint16 *Screen = (uint16 *) GFX.S + Offset;
@@ -1136,7 +1412,7 @@ INLINE void WRITE_4PIXELS16_SUB1_2 (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-INLINE void WRITE_4PIXELS16_FLIPPED_SUB1_2 (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELS16_FLIPPED_SUB1_2 (int32 Offset, uint8 *Pixels)
 {
     register uint32 Pixel;
     uint16 *Screen = (uint16 *) GFX.S + Offset;
@@ -1249,7 +1525,7 @@ void DrawClippedTile16Sub1_2 (uint32 Tile, uint32 Offset,
     RENDER_CLIPPED_TILE(WRITE_4PIXELS16_SUB1_2, WRITE_4PIXELS16_FLIPPED_SUB1_2, 4)
 }
 
-INLINE void WRITE_4PIXELS16_ADDF1_2 (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELS16_ADDF1_2 (int32 Offset, uint8 *Pixels)
 {
     register uint32 Pixel;
     uint16 *Screen = (uint16 *) GFX.S + Offset;
@@ -1275,7 +1551,7 @@ INLINE void WRITE_4PIXELS16_ADDF1_2 (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-INLINE void WRITE_4PIXELS16_FLIPPED_ADDF1_2 (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELS16_FLIPPED_ADDF1_2 (int32 Offset, uint8 *Pixels)
 {
     register uint32 Pixel;
     uint16 *Screen = (uint16 *) GFX.S + Offset;
@@ -1301,7 +1577,7 @@ INLINE void WRITE_4PIXELS16_FLIPPED_ADDF1_2 (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-INLINE void WRITE_4PIXELS16_SUBF1_2 (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELS16_SUBF1_2 (int32 Offset, uint8 *Pixels)
 {
     register uint32 Pixel;
     uint16 *Screen = (uint16 *) GFX.S + Offset;
@@ -1327,7 +1603,7 @@ INLINE void WRITE_4PIXELS16_SUBF1_2 (uint32 Offset, uint8 *Pixels)
 #undef FN
 }
 
-INLINE void WRITE_4PIXELS16_FLIPPED_SUBF1_2 (uint32 Offset, uint8 *Pixels)
+INLINE void WRITE_4PIXELS16_FLIPPED_SUBF1_2 (int32 Offset, uint8 *Pixels)
 {
     register uint32 Pixel;
     uint16 *Screen = (uint16 *) GFX.S + Offset;
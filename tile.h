@@ -144,4 +144,6 @@ void DrawHiResClippedTile16 (uint32 Tile, uint32 Offset,
 void DrawHiResTile16 (uint32 Tile, uint32 Offset,
 			uint32 StartLine, uint32 LineCount);
 
+uint8 *GetCachedTile (uint32 Tile);
+
 #endif